@@ -27,6 +27,7 @@ const static struct audio_resolution {
 
 ConferenceManager::ConferenceManager()
 {
+  conferenceList.EnableIndex();
   maxConferenceCount = 0;
   monitor  = new ConferenceMonitor(*this);
 }
@@ -90,7 +91,7 @@ BOOL ConferenceManager::CheckJoinConference(const PString & room)
     conference->Unlock();
     return TRUE;
   }
-  return GetConferenceParam(room, RoomAutoCreateWhenConnectingKey, TRUE);
+  return MCUConfigSnapshot::GetConferenceConfig(room).autoCreateWhenConnecting;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -103,7 +104,7 @@ Conference * ConferenceManager::MakeConferenceWithLock(const PString & room, PSt
   {
     if(room.Find(MCU_INTERNAL_CALL_PREFIX) == 0)
       ignoreRestriction = TRUE;
-    if(ignoreRestriction == FALSE && GetConferenceParam(room, RoomAutoCreateWhenConnectingKey, TRUE) == FALSE)
+    if(ignoreRestriction == FALSE && MCUConfigSnapshot::GetConferenceConfig(room).autoCreateWhenConnecting == FALSE)
     {
       PTRACE(1, "error");
       return NULL;
@@ -333,17 +334,34 @@ void ConferenceManager::OnCreateConference(Conference * conference)
 {
   if(MCUConfig("Export Parameters").GetBoolean("Enable export", FALSE) == TRUE)
   {
+#ifndef _WIN32
+    if(MCUConfig("Export Parameters").GetString(ExportModeKey, ExportModePipe) == ExportModeShm)
+      conference->pipeMember = new ConferenceShmMember(conference);
+    else
+#endif
     conference->pipeMember = new ConferencePipeMember(conference);
     conference->AddMember(conference->pipeMember);
   }
 
   // add file recorder member
-  if(GetConferenceParam(conference->GetNumber(), RoomAllowRecordKey, TRUE))
+  if(MCUConfigSnapshot::GetConferenceConfig(conference->GetNumber()).allowRecord)
   {
     conference->conferenceRecorder = new ConferenceRecorder(conference);
     conference->AddMember(conference->conferenceRecorder);
   }
 
+  // HLS live output, starts on the first request
+  if(MCUConfig("Export Parameters").GetBoolean(LiveStreamKey, FALSE) == TRUE)
+  {
+    conference->conferenceStreamer = new ConferenceStreamer(conference);
+    conference->AddMember(conference->conferenceStreamer);
+  }
+
+  // music on hold or announcement
+  PString playerFile = MCUConfigSnapshot::GetConferenceConfig(conference->GetNumber()).mediaPlayerFile;
+  if(playerFile != "" && conference->GetNumber().Find(MCU_INTERNAL_CALL_PREFIX) != 0)
+    conference->AddMember(new ConferenceFilePlayer(conference, playerFile));
+
   if(!conference->GetForceScreenSplit())
   {
     PTRACE(1,"Conference\tOnCreateConference: \"Force split screen video\" unchecked, " << conference->GetNumber() << " skipping members.conf");
@@ -365,7 +383,7 @@ void ConferenceManager::OnCreateConference(Conference * conference)
   if(membersConf.Left(1)!="\n") membersConf="\n"+membersConf;
 
   // recall last template
-  if(!GetConferenceParam(conference->GetNumber(), RoomRecallLastTemplateKey, FALSE)) return;
+  if(!MCUConfigSnapshot::GetConferenceConfig(conference->GetNumber()).recallLastTemplate) return;
 
   PINDEX dp=membersConf.Find("\nLAST_USED ");
   if(dp!=P_MAX_INDEX)
@@ -453,7 +471,7 @@ Conference * ConferenceManager::CreateConference(long _id, const OpalGloballyUni
   }
 #endif
 
-  BOOL forceScreenSplit = GetConferenceParam(_number, ForceSplitVideoKey, TRUE);
+  BOOL forceScreenSplit = MCUConfigSnapshot::GetConferenceConfig(_number).forceSplitVideo;
 
   if(!forceScreenSplit)
   {
@@ -508,6 +526,116 @@ void ConferenceManager::ClearConferenceList()
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+MCUOverloadController::MCUOverloadController()
+{
+  level = OVERLOAD_LEVEL_NONE;
+  audioLate = 0;
+  videoLate = 0;
+  lastAudioLate = 0;
+  lastVideoLate = 0;
+  lastCpuUsage = -1;
+  raiseCounter = 0;
+  lowerCounter = 0;
+  cpuTotal = 0;
+  cpuIdle = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int MCUOverloadController::ReadCpuUsage()
+{
+#ifndef _WIN32
+  PTextFile file("/proc/stat", PFile::ReadOnly);
+  PString line;
+  if(!file.IsOpen() || !file.ReadLine(line))
+    return -1;
+
+  // cpu user nice system idle iowait irq softirq steal
+  PStringArray fields = line.Tokenise(" ", FALSE);
+  if(fields.GetSize() < 5 || fields[0] != "cpu")
+    return -1;
+  uint64_t total = 0;
+  for(PINDEX i = 1; i < fields.GetSize() && i <= 8; ++i)
+    total += fields[i].AsUnsigned64();
+  uint64_t idle = fields[4].AsUnsigned64();
+  if(fields.GetSize() > 5)
+    idle += fields[5].AsUnsigned64();
+
+  int usage = -1;
+  if(cpuTotal != 0 && total > cpuTotal)
+    usage = (int)(100 - 100 * (idle - cpuIdle) / (total - cpuTotal));
+  cpuTotal = total;
+  cpuIdle = idle;
+  return usage;
+#else
+  return -1;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUOverloadController::Update()
+{
+  PWaitAndSignal m(mutex);
+
+  lastAudioLate = audioLate;
+  lastVideoLate = videoLate;
+  audioLate = 0;
+  videoLate = 0;
+  lastCpuUsage = ReadCpuUsage();
+
+  BOOL overload = (lastAudioLate > OVERLOAD_AUDIO_LATE_HIGH || lastVideoLate > OVERLOAD_VIDEO_LATE_HIGH || lastCpuUsage > OVERLOAD_CPU_HIGH);
+  BOOL quiet = (lastAudioLate < OVERLOAD_AUDIO_LATE_LOW && lastVideoLate < OVERLOAD_VIDEO_LATE_LOW && lastCpuUsage < OVERLOAD_CPU_LOW);
+
+  raiseCounter = (overload ? raiseCounter + 1 : 0);
+  lowerCounter = (quiet ? lowerCounter + 1 : 0);
+
+  int newLevel = level;
+  if(raiseCounter >= OVERLOAD_RAISE_PERIODS && level < OVERLOAD_LEVEL_MAX)
+    newLevel = level + 1;
+  else if(lowerCounter >= OVERLOAD_LOWER_PERIODS && level > OVERLOAD_LEVEL_NONE)
+    newLevel = level - 1;
+  else
+    return;
+
+  raiseCounter = 0;
+  lowerCounter = 0;
+  MCUTRACE(1, "MCUOverloadController\tLevel " << level << " -> " << newLevel
+              << ", audio late " << lastAudioLate << "us, video late " << lastVideoLate << "us, cpu " << lastCpuUsage << "%");
+  level = newLevel;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int MCUOverloadController::GetScaleFilterType(int type) const
+{
+  // встроенный масштаб (0) не заменяется
+  if(type == 0 || level < OVERLOAD_LEVEL_FAST_SCALE)
+    return type;
+#if USE_LIBYUV
+  return 1; // kFilterNone
+#elif USE_SWSCALE
+  return 8; // SWS_POINT
+#else
+  return type;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PString MCUOverloadController::GetMonitorText()
+{
+  PWaitAndSignal m(mutex);
+  PStringStream msg;
+  msg << "Overload Level: " << level << "\n"
+      << "Audio Tick Late: " << lastAudioLate << " us\n"
+      << "Video Tick Late: " << lastVideoLate << " us\n"
+      << "CPU Usage: " << lastCpuUsage << " %\n";
+  return msg;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void ConferenceMonitor::Main()
 {
   running = TRUE;
@@ -517,6 +645,8 @@ void ConferenceMonitor::Main()
     if(!running)
       break;
 
+    OpenMCU::Current().GetOverloadController().Update();
+
     MCUConferenceList & conferenceList = manager.GetConferenceList();
     for(MCUConferenceList::shared_iterator it = conferenceList.begin(); it != conferenceList.end(); ++it)
     {
@@ -540,39 +670,48 @@ int ConferenceMonitor::Perform(Conference * conference)
   if(now < conference->GetStartTime() + 1000)
     return 0;
 
+  MCUConferenceConfig config = MCUConfigSnapshot::GetConferenceConfig(conference->GetNumber());
+
   // time limit
-  int timeLimit = GetConferenceParam(conference->GetNumber(), RoomTimeLimitKey, 0);
+  int timeLimit = config.timeLimit;
   if(timeLimit > 0 && now >= conference->GetStartTime() + timeLimit*1000)
   {
     return 1; // delete conference
   }
 
   // auto delete empty room
-  BOOL autoDeleteEmpty = GetConferenceParam(conference->GetNumber(), RoomAutoDeleteEmptyKey, FALSE);
+  BOOL autoDeleteEmpty = config.autoDeleteEmpty;
   if(autoDeleteEmpty && !conference->GetOnlineMemberCount())
   {
     return 1; // delete conference
   }
 
   // recorder
-  BOOL allowRecord = GetConferenceParam(conference->GetNumber(), RoomAllowRecordKey, TRUE);
+  BOOL allowRecord = config.allowRecord;
   if(!allowRecord)
   {
     conference->StopRecorder();
   }
   else
   {
-    PString autoRecordStart = GetConferenceParam(conference->GetNumber(), RoomAutoRecordStartKey, "Disable");
-    PString autoRecordStop = GetConferenceParam(conference->GetNumber(), RoomAutoRecordStopKey, "Disable");
+    int autoRecordStart = config.autoRecordStart;
+    int autoRecordStop = config.autoRecordStop;
 
     PINDEX onlineMembers = conference->GetOnlineMemberCount();
 
-    if(autoRecordStop != "Disable" && onlineMembers <= autoRecordStop.AsInteger())
+    if(autoRecordStop >= 0 && onlineMembers <= autoRecordStop)
       conference->StopRecorder();
-    else if(autoRecordStart != "Disable" && autoRecordStart.AsInteger() > autoRecordStop.AsInteger() && onlineMembers >= autoRecordStart.AsInteger())
+    else if(autoRecordStart >= 0 && autoRecordStart > PMAX(autoRecordStop, 0) && onlineMembers >= autoRecordStart)
       conference->StartRecorder();
   }
 
+  // live streaming
+  if(conference->conferenceStreamer && conference->conferenceStreamer->IsRunning() && conference->conferenceStreamer->IsIdle())
+  {
+    PTRACE(1, "Conference\tLive streaming stopped, no clients: " << conference->GetNumber());
+    conference->conferenceStreamer->Stop();
+  }
+
   // autodial
   if(OpenMCU::Current().autoDialDelay != 999999) //disable
   {
@@ -583,11 +722,27 @@ int ConferenceMonitor::Perform(Conference * conference)
       {
         ConferenceMember *member = *it;
         PWaitAndSignal m(member->GetDialMutex());
-        if(!member->autoDial || member->IsSystem() || member->IsOnline())
+        if(!member->autoDial || member->IsSystem())
           continue;
+        if(member->IsOnline())
+        {
+          member->dialFailures = 0;
+          continue;
+        }
         MCUH323EndPoint & ep = OpenMCU::Current().GetEndpoint();
         if(member->dialToken != "" && ep.HasConnection(member->dialToken))
           continue;
+        // the unavailable camera is dialed with the growing interval
+        if(member->GetName().Find("rtsp://") != P_MAX_INDEX)
+        {
+          uint64_t now = MCUTime::GetMonoTimestampUsec();
+          if(now < member->dialNextTime)
+            continue;
+          if(member->dialToken != "")
+            member->dialFailures++;
+          unsigned delay = PMIN((unsigned)PMAX(OpenMCU::Current().autoDialDelay, 1) << PMIN(member->dialFailures, 8), RTSP_RECONNECT_MAX_DELAY);
+          member->dialNextTime = now + (uint64_t)delay * 1000000;
+        }
         member->dialToken = ep.Invite(conference->GetNumber(), member->GetName());
       }
       conference->dialCountdown = OpenMCU::Current().autoDialDelay;
@@ -613,15 +768,19 @@ Conference::Conference(ConferenceManager & _manager, long _listID,
 )
   : manager(_manager), listID(_listID), guid(_guid), number(_number), name(_name)
 {
+  memberList.EnableIndex();
   stopping = FALSE;
   trace_section = "Conference "+number+": ";
 #if MCU_VIDEO
+  sharedVideoMixer = NULL;
   if(mixer)
   {
     mixer->SetID(videoMixerList.GetNextID());
     mixer->SetConference(this);
     videoMixerList.Insert(mixer, mixer->GetID());
   }
+  else
+    sharedVideoMixer = new MCUSimpleVideoMixer();
 #endif
   onlineMemberCount = 0;
   visibleMemberCount = 0;
@@ -633,11 +792,14 @@ Conference::Conference(ConferenceManager & _manager, long _listID,
   VAlevel = 100;
   echoLevel = 0;
   conferenceRecorder = NULL;
-  forceScreenSplit = GetConferenceParam(number, ForceSplitVideoKey, TRUE);
-  lockedTemplate = GetConferenceParam(number, LockTemplateKey, FALSE);
+  conferenceStreamer = NULL;
+  MCUConferenceConfig config = MCUConfigSnapshot::GetConferenceConfig(number);
+  forceScreenSplit = config.forceSplitVideo;
+  lockedTemplate = config.lockTemplate;
   muteNewUsers = FALSE;
   pipeMember = NULL;
   dialCountdown = OpenMCU::Current().autoDialDelay;
+  audioLevelFlushTime = 0;
   PTRACE(3, "Conference\tNew conference started: ID=" << guid << ", number = " << number);
 }
 
@@ -652,6 +814,8 @@ Conference::~Conference()
     if(videoMixerList.Erase(it))
       delete mixer;
   }
+  if(sharedVideoMixer)
+    delete sharedVideoMixer;
 #endif
 }
 
@@ -808,7 +972,8 @@ BOOL Conference::AddMember(ConferenceMember * memberToAdd, BOOL addToList)
 
   // counter members
   visibleMemberCount++;
-  if(memberToAdd->IsOnline())
+  // the player does not keep the room
+  if(memberToAdd->IsOnline() && memberToAdd->GetType() != MEMBER_TYPE_PLAYER)
   {
     onlineMemberCount++;
     maxMemberCount = PMAX(maxMemberCount, onlineMemberCount);
@@ -854,6 +1019,8 @@ BOOL Conference::AddMember(ConferenceMember * memberToAdd, BOOL addToList)
         member->AddVideoSource(memberToAdd->GetID(), *memberToAdd);
       }
     }
+    if(sharedVideoMixer)
+      sharedVideoMixer->AddVideoSource(memberToAdd->GetID(), *memberToAdd);
   }
 
   // update the statistics
@@ -902,7 +1069,7 @@ BOOL Conference::RemoveMember(ConferenceMember * memberToRemove, BOOL removeFrom
     return TRUE;
 
   // counter members
-  if(memberToRemove->IsOnline())
+  if(memberToRemove->IsOnline() && memberToRemove->GetType() != MEMBER_TYPE_PLAYER)
     onlineMemberCount--;
 
   // remove ConferenceConnection
@@ -940,6 +1107,8 @@ BOOL Conference::RemoveMember(ConferenceMember * memberToRemove, BOOL removeFrom
           memberToRemove->RemoveVideoSource(member->GetID(), *member);
       }
     }
+    if(sharedVideoMixer)
+      sharedVideoMixer->RemoveVideoSource(memberToRemove->GetID(), *memberToRemove);
   }
 
 
@@ -1016,6 +1185,55 @@ void Conference::WriteMemberAudio(ConferenceMember * member, const uint64_t & ti
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+BOOL Conference::GetAudioFormat(ConferenceMember * exclude, int & sampleRate, int & channels)
+{
+  int maxSampleRate = 0, maxChannels = 0;
+  for(MCUAudioConnectionList::shared_iterator it = audioConnectionList.begin(); it != audioConnectionList.end(); ++it)
+  {
+    ConferenceAudioConnection * conn = it.GetObject();
+    if(exclude && conn->GetID() == exclude->GetID())
+      continue;
+    maxSampleRate = PMAX(maxSampleRate, conn->GetSampleRate());
+    maxChannels = PMAX(maxChannels, conn->GetChannels());
+  }
+  if(maxSampleRate == 0)
+    return FALSE;
+  sampleRate = maxSampleRate;
+  channels = maxChannels;
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// уровни всех участников отправляются одним сообщением не чаще AUDIO_LEVEL_FLUSH_INTERVAL_MS
+void Conference::FlushAudioLevels()
+{
+# define AUDIO_LEVEL_FLUSH_INTERVAL_MS 500
+  uint64_t now = MCUTime::GetMonoTimestampUsec();
+  if(now - audioLevelFlushTime < AUDIO_LEVEL_FLUSH_INTERVAL_MS * 1000)
+    return;
+
+  PStringArray cmds;
+  {
+    PWaitAndSignal m(audioLevelMutex);
+    if(now - audioLevelFlushTime < AUDIO_LEVEL_FLUSH_INTERVAL_MS * 1000)
+      return;
+    audioLevelFlushTime = now;
+    if(audioLevelQueue.size() == 0)
+      return;
+    // nobody is watching - nothing to format
+    if(OpenMCU::Current().HttpHasSubscribers(number))
+    {
+      for(std::map<long, int>::iterator it = audioLevelQueue.begin(); it != audioLevelQueue.end(); ++it)
+        cmds.AppendString("audio(" + PString(it->first) + "," + PString(it->second) + ")");
+    }
+    audioLevelQueue.clear();
+  }
+  OpenMCU::Current().HttpWriteCmdRoom(cmds, number);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 // tint - time interval since last call in msec
 void Conference::WriteMemberAudioLevel(ConferenceMember * member, int audioLevel, int tint)
 {
@@ -1026,14 +1244,14 @@ void Conference::WriteMemberAudioLevel(ConferenceMember * member, int audioLevel
     if (member->audioLevelIndicator < 64) member->audioLevelIndicator = 0;
     if((member->previousAudioLevel != member->audioLevelIndicator)||((member->audioLevelIndicator!=0) && ((member->audioCounter&255)==0)))
     {
-      PStringStream msg;
-      msg << "audio(" << (long)member->GetID() << "," << member->audioLevelIndicator << ")";
-      OpenMCU::Current().HttpWriteCmdRoom(msg,number);
+      PWaitAndSignal m(audioLevelMutex);
+      audioLevelQueue[(long)member->GetID()] = member->audioLevelIndicator;
       member->previousAudioLevel=member->audioLevelIndicator;
     }
     member->audioCounter=0;
     member->audioLevelIndicator=0;
   }
+  FlushAudioLevels();
 #if MCU_VIDEO
   if(UseSameVideoForAllMembers())
   {
@@ -1090,7 +1308,7 @@ void Conference::ReadMemberVideo(ConferenceMember * member, void * buffer, int w
     return;
 
   long mixerNumber;
-  if(member == NULL)
+  if(member == NULL || (UseSameVideoForAllMembers() && OpenMCU::Current().GetOverloadController().UseSharedLayout()))
     mixerNumber = 0;
   else
     mixerNumber = member->GetVideoMixerNumber();
@@ -1117,15 +1335,22 @@ BOOL Conference::WriteMemberVideo(ConferenceMember * member, const void * buffer
   if(UseSameVideoForAllMembers())
   {
     bool writeResult = FALSE;
+    // при перегрузке все участники получают первую раскладку, остальные не обновляются
+    BOOL shared = OpenMCU::Current().GetOverloadController().UseSharedLayout();
     for(MCUVideoMixerList::shared_iterator it = videoMixerList.begin(); it != videoMixerList.end(); ++it)
     {
       MCUSimpleVideoMixer *mixer = it.GetObject();
       writeResult |= mixer->WriteFrame(member->GetID(), buffer, width, height);
+      if(shared)
+        break;
     }
     return writeResult;
   }
   else
   {
+    // при перегрузке кадр только в общую раскладку, персональные микшеры не обновляются
+    if(sharedVideoMixer && OpenMCU::Current().GetOverloadController().UseSharedLayout())
+      return sharedVideoMixer->WriteFrame(member->GetID(), buffer, width, height);
     for(MCUMemberList::shared_iterator it = memberList.begin(); it != memberList.end(); ++it)
       it->OnExternalSendVideo(member->GetID(), buffer, width, height);
   }
@@ -1311,6 +1536,8 @@ ConferenceMember::ConferenceMember(Conference * _conference)
   rxFrameWidth = 0; rxFrameHeight = 0;
   vad = 0;
   autoDial = FALSE;
+  dialFailures = 0;
+  dialNextTime = 0;
   muteMask = 0;
   disableVAD = FALSE;
   chosenVan = 0;
@@ -1447,25 +1674,25 @@ void ConferenceMember::SendRoomControl(int state)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-MCUJSON * ConferenceMember::AsJSON(int state)
+void ConferenceMember::AsJSON(MCUJSONWriter & json, int state)
 {
-  MCUJSON *json = new MCUJSON(MCUJSON::JSON_ARRAY);
-  json->Insert("online", (state && IsOnline()));
-  json->Insert("id", id);
-  json->Insert("name", name);
-  json->Insert("muteMask", muteMask);
-  json->Insert("disableVad", disableVAD);
-  json->Insert("chosenVan", chosenVan);
-  json->Insert("audioLevel", GetAudioLevel());
-  json->Insert("videoMixerMumber", GetVideoMixerNumber());
-  json->Insert("nameID", GetNameID());
-  json->Insert("channelMask", channelMask);
-  json->Insert("kManualGainDB", kManualGainDB);
-  json->Insert("kOutputGainDB", kOutputGainDB);
-  json->Insert("mixer", "[]");
-  json->Insert("memberType", memberType);
-  json->Insert("autoDial", autoDial);
-  return json;
+  json.BeginArray();
+  json.Value("online", (state && IsOnline()));
+  json.Value("id", id);
+  json.Value("name", name);
+  json.Value("muteMask", muteMask);
+  json.Value("disableVad", disableVAD);
+  json.Value("chosenVan", chosenVan);
+  json.Value("audioLevel", GetAudioLevel());
+  json.Value("videoMixerMumber", GetVideoMixerNumber());
+  json.Value("nameID", GetNameID());
+  json.Value("channelMask", channelMask);
+  json.Value("kManualGainDB", kManualGainDB);
+  json.Value("kOutputGainDB", kOutputGainDB);
+  json.Value("mixer", "[]");
+  json.Value("memberType", (int)memberType);
+  json.Value("autoDial", autoDial);
+  json.End();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1566,19 +1793,39 @@ void ConferenceMember::WriteAudio(const uint64_t & timestamp, const void * buffe
     // Записать аудио в буфер // Write to buffer
     conference->WriteMemberAudio(this, timestamp, buffer, amount, sampleRate, channels);
 
+    WriteAudioLevel(amount, sampleRate, channels);
+  }
+}
 
-    // Индикатор уровня, VAD // Level indication, VAD
-#   define MINIMUM_VAD_INTERVAL_MS 250
-    write_audio_time_microseconds += amount*1000000/2/channels/sampleRate;
-    write_audio_average_level += audioLevel;
-    write_audio_write_counter++;
-    if(write_audio_time_microseconds >= MINIMUM_VAD_INTERVAL_MS * 1000)
-    {
-      conference->WriteMemberAudioLevel(this, write_audio_average_level/write_audio_write_counter, write_audio_time_microseconds/1000);
-      write_audio_average_level = 0;
-      write_audio_time_microseconds = 0;
-      write_audio_write_counter = 0;
-    }
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ConferenceMember::WriteSilence(int level, PINDEX amount, unsigned sampleRate, unsigned channels)
+{
+  if(conference != NULL)
+  {
+    // -dBov в средний уровень сигнала, без декодирования
+    unsigned signalLevel = (unsigned)(32767.0 * pow(10.0, -level/20.0));
+    audioLevel = ((signalLevel * 2) + audioLevel) / 3;
+
+    WriteAudioLevel(amount, sampleRate, channels);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ConferenceMember::WriteAudioLevel(PINDEX amount, unsigned sampleRate, unsigned channels)
+{
+  // Индикатор уровня, VAD // Level indication, VAD
+# define MINIMUM_VAD_INTERVAL_MS 250
+  write_audio_time_microseconds += amount*1000000/2/channels/sampleRate;
+  write_audio_average_level += audioLevel;
+  write_audio_write_counter++;
+  if(write_audio_time_microseconds >= MINIMUM_VAD_INTERVAL_MS * 1000)
+  {
+    conference->WriteMemberAudioLevel(this, write_audio_average_level/write_audio_write_counter, write_audio_time_microseconds/1000);
+    write_audio_average_level = 0;
+    write_audio_time_microseconds = 0;
+    write_audio_write_counter = 0;
   }
 }
 
@@ -1635,6 +1882,8 @@ void ConferenceMember::ReadVideo(void * buffer, int width, int height, PINDEX &
   {
     if(conference->UseSameVideoForAllMembers())
       conference->ReadMemberVideo(this, buffer, width, height, amount);
+    else if(conference->GetSharedVideoMixer() != NULL && OpenMCU::Current().GetOverloadController().UseSharedLayout())
+      conference->GetSharedVideoMixer()->ReadFrame(*this, buffer, width, height, amount);
     else if(videoMixer != NULL)
       videoMixer->ReadFrame(*this, buffer, width, height, amount);
   }
@@ -1772,6 +2021,8 @@ void ConferenceAudioConnection::WriteAudio(const uint64_t & srcTimestamp, const
 
   // копия
   int srcTimeIndex = timeIndex;
+  // пропущенный интервал, ms
+  int lostTime = 0;
 
   if(startTimestamp == 0)
     // константа, не меняется
@@ -1782,6 +2033,8 @@ void ConferenceAudioConnection::WriteAudio(const uint64_t & srcTimestamp, const
     if(writeTimestamp + PCM_BUFFER_LAG_MS*1000 < srcTimestamp)
     {
       srcTimeIndex = srcTimestamp/1000 - startTimestamp/1000 - frameTime;
+      // тишина (RFC 6464) или потери, в буфере остались старые данные
+      lostTime = PMIN(srcTimeIndex - timeIndex, PCM_BUFFER_LEN_MS);
       PTRACE(6, "ConferenceAudioConnection\tWriter has lost " << srcTimestamp - writeTimestamp << " us"
                 << ", start=" << startTimestamp << " write=" << writeTimestamp  << " src=" << srcTimestamp
                 << " index=" << timeIndex << " frame=" << frameTime);
@@ -1798,6 +2051,20 @@ void ConferenceAudioConnection::WriteAudio(const uint64_t & srcTimestamp, const
       continue;
     AudioResampler * resampler = s->second;
 
+    // заполнить пропущенный интервал нулями, иначе чтение вернет звук с прошлого круга
+    if(lostTime > 0)
+    {
+      int zeroIndex = ((srcTimeIndex - lostTime) % PCM_BUFFER_LEN_MS) * audioBuffer->GetTimeSize();
+      int zeroLeft = lostTime * audioBuffer->GetTimeSize();
+      if(zeroIndex + zeroLeft > audioBuffer->GetSize())
+      {
+        memset(audioBuffer->GetPointer() + zeroIndex, 0, audioBuffer->GetSize() - zeroIndex);
+        zeroLeft -= audioBuffer->GetSize() - zeroIndex;
+        zeroIndex = 0;
+      }
+      memset(audioBuffer->GetPointer() + zeroIndex, 0, zeroLeft);
+    }
+
     int dstBufferSize = frameTime * audioBuffer->GetTimeSize();
     MCUBuffer dstBuffer(dstBufferSize);
 
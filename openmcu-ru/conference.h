@@ -14,6 +14,7 @@ enum MemberTypes
   MEMBER_TYPE_NONE       = 0,
   MEMBER_TYPE_CONN       = 2,
   MEMBER_TYPE_STREAM     = 4,
+  MEMBER_TYPE_PLAYER     = 6,
   //
   MEMBER_TYPE_GSYSTEM    = 1, // MEMBER_TYPE_PIPE|MEMBER_TYPE_CACHE|MEMBER_TYPE_RECORDER
   MEMBER_TYPE_PIPE       = 1,
@@ -222,6 +223,13 @@ class ConferenceMember : public PObject
       */
     virtual void WriteAudio(const uint64_t & timestamp, const void * buffer, PINDEX amount, unsigned sampleRate, unsigned channels);
 
+    /**
+      *  Called instead of WriteAudio when the terminal reports no voice (RFC 6464),
+      *  level in -dBov. Only the level indicator and VAD are updated
+      */
+    void WriteSilence(int level, PINDEX amount, unsigned sampleRate, unsigned channels);
+
+    void WriteAudioLevel(PINDEX amount, unsigned sampleRate, unsigned channels);
     void WriteAudioAutoGainControl(const short * pcm, unsigned samplesPerFrame, unsigned codecChannels, unsigned sampleRate, unsigned level, float* currVolCoef, unsigned* signalLevel, float kManual);
 
     /**
@@ -351,6 +359,8 @@ class ConferenceMember : public PObject
     BOOL autoDial;
     PString dialToken;
     PMutex dialMutex;
+    unsigned dialFailures;  // autodial of the RTSP camera, the next attempt is delayed after each failure
+    uint64_t dialNextTime;  // usec, monotonic
 
     unsigned muteMask;
     unsigned channelMask;
@@ -382,7 +392,7 @@ class ConferenceMember : public PObject
     };
 
     void SendRoomControl(int state);
-    MCUJSON * AsJSON(int state = 1);
+    void AsJSON(MCUJSONWriter & writer, int state = 1);
 
 #if MCU_VIDEO
     int resizerRule; //0=cut, 1=stripes
@@ -517,7 +527,11 @@ class Conference : public PObject
 
     virtual void WriteMemberAudio(ConferenceMember * member, const uint64_t & timestamp, const void * buffer, int amount, int sampleRate, int channels);
 
+    // the highest rate and channels of the members audio, FALSE without audio
+    BOOL GetAudioFormat(ConferenceMember * exclude, int & sampleRate, int & channels);
+
     virtual void WriteMemberAudioLevel(ConferenceMember * member, int audioLevel, int tint);
+    void FlushAudioLevels();
 
 #if MCU_VIDEO
     virtual void ReadMemberVideo(ConferenceMember * member, void * buffer, int width, int height, PINDEX & amount);
@@ -527,6 +541,10 @@ class Conference : public PObject
     virtual BOOL UseSameVideoForAllMembers()
     { return videoMixerList.GetSize() > 0; }
 
+    // общая раскладка комнаты с персональными микшерами, при перегрузке
+    MCUSimpleVideoMixer * GetSharedVideoMixer()
+    { return sharedVideoMixer; }
+
     virtual void FreezeVideo(ConferenceMemberId id);
     virtual BOOL PutChosenVan();
 #endif
@@ -553,6 +571,7 @@ class Conference : public PObject
     virtual BOOL RewriteMembersConf();
 
     ConferenceRecorder * conferenceRecorder;
+    ConferenceStreamer * conferenceStreamer;
     ConferenceMember * pipeMember;
 
     BOOL GetForceScreenSplit() { return forceScreenSplit; }
@@ -582,6 +601,8 @@ class Conference : public PObject
     MCUAudioConnectionList audioConnectionList;
 
     MCUVideoMixerList videoMixerList;
+    // все видимые участники, кадры пишутся и читаются только при перегрузке
+    MCUSimpleVideoMixer * sharedVideoMixer;
 
     PINDEX onlineMemberCount;
     PINDEX visibleMemberCount;
@@ -598,6 +619,81 @@ class Conference : public PObject
     int vidmembernum;
     PMutex membersConfMutex;
     BOOL forceScreenSplit;
+
+    // level indication for the web control panel, batched
+    PMutex audioLevelMutex;
+    std::map<long, int> audioLevelQueue;
+    uint64_t volatile audioLevelFlushTime;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+enum OverloadLevels
+{
+  OVERLOAD_LEVEL_NONE       = 0,
+  OVERLOAD_LEVEL_FRAME_RATE = 1, // половинная частота кадров исходящего видео
+  OVERLOAD_LEVEL_FAST_SCALE = 2, // самый дешёвый фильтр масштабирования окон раскладки
+  OVERLOAD_LEVEL_SHARED     = 3, // общая раскладка вместо персональных
+  OVERLOAD_LEVEL_REJECT     = 4, // новые вызовы отклоняются
+  OVERLOAD_LEVEL_MAX        = 4,
+};
+
+#define OVERLOAD_AUDIO_LATE_HIGH  20000  // usec, опоздание такта звука
+#define OVERLOAD_AUDIO_LATE_LOW   5000
+#define OVERLOAD_VIDEO_LATE_HIGH  200000 // usec, опоздание такта кодера видео
+#define OVERLOAD_VIDEO_LATE_LOW   50000
+#define OVERLOAD_CPU_HIGH         90     // %
+#define OVERLOAD_CPU_LOW          70
+#define OVERLOAD_RAISE_PERIODS    2      // секунд перегрузки до повышения уровня
+#define OVERLOAD_LOWER_PERIODS    10     // секунд без перегрузки до понижения уровня
+
+// Контроль перегрузки. Уровень меняется на одну ступень раз в секунду из
+// ConferenceMonitor, ступени сначала ухудшают видео, звук не трогается.
+class MCUOverloadController
+{
+  public:
+    MCUOverloadController();
+
+    // опоздание такта из потоков каналов, максимум за интервал
+    void OnAudioTick(uint64_t lateUsec)
+    { if(lateUsec > audioLate) audioLate = (unsigned)PMIN(lateUsec, 0xffffffff); }
+
+    void OnVideoTick(uint64_t lateUsec)
+    { if(lateUsec > videoLate) videoLate = (unsigned)PMIN(lateUsec, 0xffffffff); }
+
+    void Update();
+
+    int GetLevel() const
+    { return level; }
+
+    unsigned GetFrameRateDivisor() const
+    { return (level >= OVERLOAD_LEVEL_FRAME_RATE ? 2 : 1); }
+
+    int GetScaleFilterType(int type) const;
+
+    BOOL UseSharedLayout() const
+    { return (level >= OVERLOAD_LEVEL_SHARED); }
+
+    BOOL RejectCalls() const
+    { return (level >= OVERLOAD_LEVEL_REJECT); }
+
+    PString GetMonitorText();
+
+  protected:
+    // загрузка процессора в процентах, -1 неизвестно
+    int ReadCpuUsage();
+
+    PMutex mutex;
+    volatile int level;
+    volatile unsigned audioLate;
+    volatile unsigned videoLate;
+    unsigned lastAudioLate;
+    unsigned lastVideoLate;
+    int lastCpuUsage;
+    unsigned raiseCounter;
+    unsigned lowerCounter;
+    uint64_t cpuTotal;
+    uint64_t cpuIdle;
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
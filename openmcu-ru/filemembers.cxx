@@ -187,6 +187,9 @@ ConferenceCacheMember::ConferenceCacheMember(Conference * _conference, unsigned
   format = _format;
   cacheName = _cacheName;
 
+  status = CACHE_SUSPENDED;
+  cap = NULL;
+  conn = NULL;
   codec = NULL;
   cache = CreateCacheRTP(cacheName);
 
@@ -222,19 +225,13 @@ void ConferenceCacheMember::Close()
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-void ConferenceCacheMember::CacheThread(PThread &, INT)
+void ConferenceCacheMember::OpenEncoder()
 {
-  MCUTRACE(1, "CacheRTP " << cacheName << " Thread starting");
-
   MCUH323EndPoint & ep = OpenMCU::Current().GetEndpoint();
 
-  MCUCapability *cap = MCUCapability::Create(format);
-  OpalMediaFormat & wf = cap->GetWritableMediaFormat();
-  wf = format;
   codec = MCUCapability::CreateCodec(cap, MCUCodec::Encoder);
-  isAudio = (cap->GetMainType() == MCUCapability::e_Audio);
 
-  MCUH323Connection * conn = new MCUH323Connection(ep, 0, NULL);
+  conn = new MCUH323Connection(ep, 0, NULL);
   if(isAudio)
   {
     conn->SetupCacheConnection(cacheName, conference, this);
@@ -244,68 +241,106 @@ void ConferenceCacheMember::CacheThread(PThread &, INT)
     conn->SetupCacheConnection(cacheName, conference, this);
     conn->OpenVideoChannel(TRUE, (H323VideoCodec &)*codec);
   }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ConferenceCacheMember::CloseEncoder()
+{
+  // must destroy videograbber and videochanell here? fix it
+  delete(conn); conn = NULL;
+  delete(codec); codec = NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ConferenceCacheMember::CacheThread(PThread &, INT)
+{
+  MCUTRACE(1, "CacheRTP " << cacheName << " Thread starting");
+
+  // the encoder parameters are kept while the cache is suspended
+  cap = MCUCapability::Create(format);
+  OpalMediaFormat & wf = cap->GetWritableMediaFormat();
+  wf = format;
+  isAudio = (cap->GetMainType() == MCUCapability::e_Audio);
+
+  OpenEncoder();
 
   RTP_DataFrame frame;
   unsigned length = 0;
-  status = 1;
+  status = CACHE_ACTIVE;
 
   // from here we are ready to call codec->Read in cicle
   while(running)
   {
-    while(running && GetCacheUsersNumber() == 0)
+    if(GetCacheUsersNumber() == 0)
     {
-      if(status == 1)
+      if(status == CACHE_ACTIVE)
       {
-        status = 0;
+        status = CACHE_IDLE;
+        idleTime = PTime();
         totalVideoFramesSent = 0;
         MCUTRACE(1, "CacheRTP " << cacheName << " Down to sleep");
       }
-      MCUTime::Sleep(1000);
+      if(status == CACHE_IDLE && (PTime() - idleTime).GetMilliSeconds() > CACHE_SUSPEND_DELAY && cache->Suspend())
+      {
+        CloseEncoder();
+        status = CACHE_SUSPENDED;
+        MCUTRACE(1, "CacheRTP " << cacheName << " Suspended");
+      }
+      MCUTime::Sleep(CACHE_WAKEUP_INTERVAL);
+      continue;
     }
-    if(running && status == 0)
+    if(status != CACHE_ACTIVE)
     {
-      status = 1;
+      if(status == CACHE_SUSPENDED)
+      {
+        // the users get the kept keyframe from the cache meanwhile
+        OpenEncoder();
+        if(!isAudio)
+          ((H323VideoCodec *)codec)->OnFastUpdatePicture();
+      }
       // restart channel
-      if(isAudio)
+      else if(isAudio)
       {
         int channels = format.GetOptionInteger(OPTION_ENCODER_CHANNELS, 1);
         codec->AttachChannel(new OutgoingAudio(*conn, wf.GetTimeUnits()*1000, channels), TRUE);
       } else
         conn->RestartGrabber();
+      status = CACHE_ACTIVE;
       firstFrameSendTime = PTime();
       MCUTRACE(1, "CacheRTP " << cacheName << " Wake up");
     }
-    if(running)
+
+    unsigned flags = 0;
+    if(!isAudio)
     {
-      unsigned flags = 0;
-      if(!isAudio)
-      {
-        cache->GetFastUpdate(flags);
-        if(flags & PluginCodec_CoderForceIFrame)
-          ((H323VideoCodec *)codec)->OnFastUpdatePicture();
-      }
+      cache->GetFastUpdate(flags);
+      if(flags & PluginCodec_CoderForceIFrame)
+        ((H323VideoCodec *)codec)->OnFastUpdatePicture();
+      ((MCUVideoCodec *)codec)->SetTargetBitRate(cache->GetTargetBitRate());
+    }
 
-      if(isAudio)
-        codec->Read(frame.GetPayloadPtr(), length, frame);
-      else
-        ((MCUVideoCodec *)codec)->Read(frame.GetPayloadPtr(), length, frame, flags);
+    if(isAudio)
+      codec->Read(frame.GetPayloadPtr(), length, frame);
+    else
+      ((MCUVideoCodec *)codec)->Read(frame.GetPayloadPtr(), length, frame, flags);
 
-      PutCacheRTP(cache, frame, length, flags);
-    }
+    PutCacheRTP(cache, frame, length, flags);
   }
 
   MCUTRACE(1, "CacheRTP " << cacheName << " Wait before deleting cache " << cacheName << ", active users " << GetCacheUsersNumber());
   while(GetCacheUsersNumber() != 0)
   {
+    if(codec == NULL)
+      OpenEncoder();
     unsigned flags = 0;
     codec->Read(frame.GetPayloadPtr(), length, frame);
     PutCacheRTP(cache, frame, length, flags);
     MCUTime::Sleep(1);
   }
 
-  // must destroy videograbber and videochanell here? fix it
-  delete(conn); conn = NULL;
-  delete(codec); codec = NULL;
+  CloseEncoder();
   delete(cap); cap = NULL;
 
   MCUTRACE(1, "CacheRTP " << cacheName << " Thread stop");
@@ -569,3 +604,526 @@ void ConferencePipeMember::VideoThread(PThread &, INT)
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WIN32
+
+MCUShmWriter::MCUShmWriter()
+{
+  fd = -1;
+  map_size = 0;
+  header = NULL;
+  seq = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCUShmWriter::~MCUShmWriter()
+{
+  Close();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL MCUShmWriter::Open(const PString & _name, const MCUShmHeader & params, unsigned frame_size, unsigned slot_count)
+{
+  Close();
+
+  // shm name: one slash and no other, the hash of the room name after the replaced characters
+  char shm_name[MCU_SHM_NAME_SIZE];
+  mcu_shm_make_name(shm_name, _name);
+  name = "/" + PString(shm_name);
+
+  unsigned slot_size = MCU_SHM_SLOT_SIZE(frame_size);
+  map_size = MCU_SHM_HEADER_SIZE + (size_t)slot_size * slot_count;
+
+  // the old ring stays with its readers, they see a new file after reopen
+  shm_unlink(name);
+  fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+  if(fd < 0)
+  {
+    PTRACE(1, "MCUShmWriter\tshm_open " << name << " failed: " << strerror(errno));
+    return FALSE;
+  }
+  if(ftruncate(fd, map_size) < 0)
+  {
+    PTRACE(1, "MCUShmWriter\tftruncate " << name << " failed: " << strerror(errno));
+    Close();
+    return FALSE;
+  }
+  void *map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if(map == MAP_FAILED)
+  {
+    PTRACE(1, "MCUShmWriter\tmmap " << name << " failed: " << strerror(errno));
+    Close();
+    return FALSE;
+  }
+
+  header = (MCUShmHeader *)map;
+  *header = params;
+  header->magic = MCU_SHM_MAGIC;
+  header->version = MCU_SHM_VERSION;
+  header->header_size = MCU_SHM_HEADER_SIZE;
+  header->slot_size = slot_size;
+  header->slot_count = slot_count;
+  header->writer_pid = getpid();
+  header->write_seq = 0;
+  seq = 0;
+  MCU_SHM_BARRIER();
+  header->state = MCU_SHM_STATE_RUNNING;
+
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUShmWriter::Write(const void * data, unsigned size, uint64_t timestamp)
+{
+  if(header == NULL || size > header->slot_size - sizeof(MCUShmSlot))
+    return;
+
+  MCUShmSlot *slot = mcu_shm_slot(header, ++seq);
+  slot->seq = 0;
+  MCU_SHM_BARRIER();
+  memcpy((BYTE *)slot + sizeof(MCUShmSlot), data, size);
+  slot->size = size;
+  slot->timestamp = timestamp;
+  MCU_SHM_BARRIER();
+  slot->seq = seq;
+  MCU_SHM_BARRIER();
+  header->write_seq = seq;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUShmWriter::Close()
+{
+  if(header)
+  {
+    header->state = MCU_SHM_STATE_CLOSED;
+    munmap(header, map_size);
+    header = NULL;
+  }
+  if(fd >= 0)
+  {
+    close(fd);
+    fd = -1;
+    shm_unlink(name);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ConferenceShmMember::ConferenceShmMember(Conference * _conference)
+  : ConferenceMember(_conference)
+{
+  memberType = MEMBER_TYPE_PIPE;
+  running = FALSE;
+  audio_thread = NULL;
+  video_thread = NULL;
+
+  if(conference == NULL)
+    return;
+  roomName = conference->GetNumber();
+
+  trace_section = "ConferenceShmMember "+roomName+": ";
+
+  running = TRUE;
+
+  audio_thread = PThread::Create(PCREATE_NOTIFIER(AudioThread), 0, PThread::NoAutoDeleteThread, PThread::NormalPriority, "shm_audio:%0x");
+  video_thread = PThread::Create(PCREATE_NOTIFIER(VideoThread), 0, PThread::NoAutoDeleteThread, PThread::NormalPriority, "shm_video:%0x");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ConferenceShmMember::~ConferenceShmMember()
+{
+  // the threads never block on the readers
+  running = FALSE;
+  if(audio_thread)
+  {
+    audio_thread->WaitForTermination();
+    delete audio_thread;
+    audio_thread = NULL;
+  }
+  if(video_thread)
+  {
+    video_thread->WaitForTermination();
+    delete video_thread;
+    video_thread = NULL;
+  }
+  PTRACE(5, trace_section << "terminated");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ConferenceShmMember::Close()
+{
+  running = FALSE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ConferenceShmMember::AudioThread(PThread &, INT)
+{
+  MCUConfig cfg("Export Parameters");
+  unsigned sampleRate = cfg.GetInteger(AudioSampleRateKey, 16000);
+  if(sampleRate < 2000 || sampleRate > 1000000) sampleRate = 16000;
+
+  unsigned channels = cfg.GetInteger(AudioChannelsKey, 1);
+  if(channels < 1 || channels > 8) channels = 1;
+
+  PINDEX amountBytes = channels * 2 * sampleRate * AUDIO_EXPORT_PCM_BUFFER_SIZE_MS / 1000;
+  PBYTEArray pcmData(amountBytes);
+
+  MCUShmHeader params;
+  memset(&params, 0, sizeof(params));
+  params.media = MCU_SHM_MEDIA_AUDIO;
+  params.format = MCU_SHM_FORMAT_S16LE;
+  params.sample_rate = sampleRate;
+  params.channels = channels;
+
+  MCUShmWriter writer;
+  if(!writer.Open("openmcu_audio_" + roomName, params, amountBytes, SHM_EXPORT_AUDIO_SLOTS))
+    return;
+  PTRACE(1, trace_section << "Start export audio thread " << sampleRate << "x" << channels << " -> " << writer.GetName());
+
+  MCUDelay audioDelay;
+  while(running)
+  {
+    uint64_t timestamp = audioDelay.GetDelayTimestampUsec();
+    ReadAudio(timestamp, pcmData.GetPointer(), amountBytes, sampleRate, channels);
+    writer.Write(pcmData.GetPointer(), amountBytes, timestamp);
+    audioDelay.Delay(AUDIO_EXPORT_PCM_BUFFER_SIZE_MS);
+  }
+
+  writer.Close();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ConferenceShmMember::VideoThread(PThread &, INT)
+{
+  MCUConfig cfg("Export Parameters");
+  int width = cfg.GetInteger(VideoFrameWidthKey, 704);
+  int height = cfg.GetInteger(VideoFrameHeightKey, 576);
+  int framerate = cfg.GetInteger(VideoFrameRateKey, 10);
+
+  if(width<176 || width>1920) width=704;
+  if(height<144 || height>1152) height=576;
+  if(framerate<1 || framerate>100) framerate=10;
+  width &= ~1;
+  height &= ~1;
+
+  PINDEX amount = width*height*3/2;
+  PBYTEArray videoData(amount);
+
+  MCUShmHeader params;
+  memset(&params, 0, sizeof(params));
+  params.media = MCU_SHM_MEDIA_VIDEO;
+  params.format = MCU_SHM_FORMAT_I420;
+  params.width = width;
+  params.height = height;
+  params.frame_rate = framerate;
+
+  MCUShmWriter writer;
+  if(!writer.Open("openmcu_video_" + roomName, params, amount, SHM_EXPORT_VIDEO_SLOTS))
+    return;
+  PTRACE(1, trace_section << "Start export video thread " << width << "x" << height << "x" << framerate << " -> " << writer.GetName());
+
+  MCUDelay videoDelay;
+  while(running)
+  {
+    if(videoMixer!=NULL) videoMixer->ReadFrame(*this,videoData.GetPointer(),width,height,amount);
+    else conference->ReadMemberVideo(this,videoData.GetPointer(),width,height,amount);
+    writer.Write(videoData.GetPointer(), amount, MCUTime::GetMonoTimestampUsec());
+    videoDelay.DelayUsec(1000000/framerate);
+  }
+
+  writer.Close();
+}
+
+#endif // _WIN32
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCUMediaFileCache::CacheMap MCUMediaFileCache::cacheList;
+PMutex MCUMediaFileCache::cacheListMutex;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCUMediaFileCache::MCUMediaFileCache(const PString & _key)
+  : key(_key), users(0), fileTime(0), fileSize(0), loading(FALSE), loaded(FALSE)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCUMediaFileCache * MCUMediaFileCache::Acquire(const PString & filename, int sampleRate, int channels)
+{
+  PString key = filename + "@" + PString(sampleRate) + "x" + PString(channels);
+  MCUMediaFileCache * cache = NULL;
+  BOOL load = FALSE;
+  {
+    PWaitAndSignal m(cacheListMutex);
+
+    CacheMap::iterator it = cacheList.find(key);
+    if(it != cacheList.end() && (it->second->loading || !it->second->IsChanged(filename)))
+    {
+      cache = it->second;
+    }
+    else
+    {
+      if(it != cacheList.end())
+      {
+        // the players of the old entry release it
+        PTRACE(3, "MCUMediaFileCache\tfile changed " << key);
+        cacheList.erase(it);
+      }
+      // the placeholder, the other users wait for the load
+      cache = new MCUMediaFileCache(key);
+      cache->loading = TRUE;
+      cache->loadMutex.Wait();
+      cacheList.insert(CacheMap::value_type(key, cache));
+      load = TRUE;
+    }
+    cache->users++;
+  }
+
+  if(load)
+  {
+    BOOL ok = cache->Load(filename, sampleRate, channels);
+    {
+      PWaitAndSignal m(cacheListMutex);
+      cache->loaded = ok;
+      cache->loading = FALSE;
+      // the failed entry is not found any more, its users release it
+      CacheMap::iterator it = cacheList.find(key);
+      if(!ok && it != cacheList.end() && it->second == cache)
+        cacheList.erase(it);
+    }
+    cache->loadMutex.Signal();
+  }
+  else
+  {
+    cache->loadMutex.Wait();
+    cache->loadMutex.Signal();
+  }
+
+  if(!cache->loaded)
+  {
+    Release(cache);
+    return NULL;
+  }
+  return cache;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUMediaFileCache::Release(MCUMediaFileCache * cache)
+{
+  PWaitAndSignal m(cacheListMutex);
+
+  if(--cache->users > 0)
+    return;
+  CacheMap::iterator it = cacheList.find(cache->key);
+  if(it != cacheList.end() && it->second == cache)
+    cacheList.erase(it);
+  PTRACE(3, "MCUMediaFileCache\tdelete " << cache->key);
+  delete cache;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL MCUMediaFileCache::IsChanged(const PString & filename) const
+{
+  PFileInfo info;
+  if(!PFile::GetInfo(filename, info))
+    return FALSE; // removed, the cached copy is played
+  return (info.modified != fileTime || info.size != fileSize);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL MCUMediaFileCache::Load(const PString & filename, int sampleRate, int channels)
+{
+  PFileInfo info;
+  if(PFile::GetInfo(filename, info))
+  {
+    fileTime = info.modified;
+    fileSize = info.size;
+  }
+
+  if(!MCU_AVDecodeMediaFile(filename, data, CIF_WIDTH, CIF_HEIGHT, MEDIA_PLAYER_MAX_FRAME_RATE, MEDIA_CACHE_MAX_SIZE))
+    return FALSE;
+
+  if(data.audio.size() == 0 || (data.sample_rate == sampleRate && data.channels == channels))
+    return TRUE;
+
+  // to the player format once, not in every room
+  AudioResampler * resampler = AudioResampler::Create(data.sample_rate, data.channels, sampleRate, channels);
+  if(resampler == NULL)
+  {
+    PTRACE(1, "MCUMediaFileCache\tcould not resample " << filename);
+    return FALSE;
+  }
+
+  uint64_t srcSamples = data.audio.size() / data.channels;
+  std::vector<short> audio((size_t)(srcSamples * sampleRate / data.sample_rate) * channels);
+
+  // by the frames, the resampler is made for them
+  uint64_t chunk = PMAX(data.sample_rate * MEDIA_PLAYER_FRAME_MS / 1000, 1);
+  uint64_t srcPos = 0, dstPos = 0;
+  while(srcPos < srcSamples)
+  {
+    uint64_t srcEnd = PMIN(srcPos + chunk, srcSamples);
+    uint64_t dstEnd = srcEnd * sampleRate / data.sample_rate;
+    if(dstEnd > dstPos)
+      resampler->Resample((const BYTE *)&data.audio[srcPos * data.channels], (int)(srcEnd - srcPos) * data.channels * 2,
+                          (BYTE *)&audio[dstPos * channels], (int)(dstEnd - dstPos) * channels * 2);
+    srcPos = srcEnd;
+    dstPos = dstEnd;
+  }
+  delete resampler;
+
+  data.audio.swap(audio);
+  data.sample_rate = sampleRate;
+  data.channels = channels;
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ConferenceFilePlayer::ConferenceFilePlayer(Conference * _conference, const PString & _filename)
+  : ConferenceMember(_conference)
+{
+  memberType = MEMBER_TYPE_PLAYER;
+  visible = TRUE;
+  filename = _filename;
+  if(!PFile::Exists(filename) && PFile::Exists(PString(SYS_RESOURCE_DIR) + PATH_SEPARATOR + filename))
+    filename = PString(SYS_RESOURCE_DIR) + PATH_SEPARATOR + filename;
+  name = "player " + PFilePath(filename).GetFileName();
+  callToken = "player:" + conference->GetNumber();
+  trace_section = "ConferenceFilePlayer " + conference->GetNumber() + ": ";
+
+  running = TRUE;
+  thread = PThread::Create(PCREATE_NOTIFIER(PlayThread), 0, PThread::NoAutoDeleteThread, PThread::NormalPriority, "player:%0x");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ConferenceFilePlayer::~ConferenceFilePlayer()
+{
+  running = FALSE;
+  if(thread)
+  {
+    thread->WaitForTermination();
+    delete thread;
+    thread = NULL;
+  }
+  PTRACE(5, trace_section << "terminated");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ConferenceFilePlayer::Close()
+{
+  running = FALSE;
+  if(thread)
+    thread->WaitForTermination();
+
+  // as a connection on the call end: out of the mixers, offline in the member list
+  if(conference)
+    conference->RemoveMember(this, FALSE);
+  SetCallToken("");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ConferenceFilePlayer::PlayThread(PThread &, INT)
+{
+  // the format of the room audio, known with the audio of the first members
+  int sampleRate = MEDIA_PLAYER_SAMPLE_RATE, channels = MEDIA_PLAYER_CHANNELS;
+  unsigned waitAudio = 1000; // ms, the member is online before its audio
+  while(running)
+  {
+    if(conference->GetOnlineMemberCount() != 0)
+    {
+      if(conference->GetAudioFormat(this, sampleRate, channels) || waitAudio == 0)
+        break;
+      waitAudio -= 100;
+    }
+    MCUTime::Sleep(100);
+  }
+  if(!running)
+    return;
+
+  MCUMediaFileCache * cache = MCUMediaFileCache::Acquire(filename, sampleRate, channels);
+  if(cache == NULL)
+  {
+    MCUTRACE(1, trace_section << "could not play " << filename);
+    return;
+  }
+  const MCUAVMediaData & data = cache->GetData();
+  PTRACE(1, trace_section << "playing " << filename << ", " << data.sample_rate << " Hz, " << data.channels << " channels");
+
+  PINDEX frameSamples = data.sample_rate * MEDIA_PLAYER_FRAME_MS / 1000 * data.channels;
+  std::vector<short> frame(PMAX(frameSamples, 1));
+
+  unsigned position = 0; // ms from the file start
+  PINDEX videoIndex = 0;
+  PINDEX videoWritten = P_MAX_INDEX;
+  BOOL paused = TRUE;
+  MCUDelay delay;
+
+  while(running)
+  {
+    // nobody to play for, the position is kept
+    if(conference->GetOnlineMemberCount() == 0)
+    {
+      paused = TRUE;
+      MCUTime::Sleep(100);
+      continue;
+    }
+    if(paused)
+    {
+      paused = FALSE;
+      delay.Restart();
+    }
+
+    if(frameSamples)
+    {
+      // the copy, WriteAudio applies the gain control in place
+      size_t audioPos = (size_t)position * data.sample_rate / 1000 * data.channels;
+      for(PINDEX i = 0; i < frameSamples; ++i)
+        frame[i] = (audioPos + i < data.audio.size() ? data.audio[audioPos + i] : 0);
+      WriteAudio(delay.GetDelayTimestampUsec(), &frame[0], frameSamples * 2, data.sample_rate, data.channels);
+    }
+
+#if MCU_VIDEO
+    if(data.video.size())
+    {
+      while(videoIndex + 1 < (PINDEX)data.video.size() && data.video_time[videoIndex + 1] <= position)
+        videoIndex++;
+      if(videoIndex != videoWritten && data.video_time[videoIndex] <= position)
+      {
+        WriteVideo((const BYTE *)data.video[videoIndex], data.width, data.height);
+        videoWritten = videoIndex;
+      }
+    }
+#endif
+
+    position += MEDIA_PLAYER_FRAME_MS;
+    if(position >= data.duration)
+    {
+      position = 0;
+      videoIndex = 0;
+      videoWritten = P_MAX_INDEX;
+    }
+
+    delay.Delay(MEDIA_PLAYER_FRAME_MS);
+  }
+
+  MCUMediaFileCache::Release(cache);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
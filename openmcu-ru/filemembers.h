@@ -7,6 +7,9 @@
 #include "utils.h"
 #include "conference.h"
 #include "mcu_rtp.h"
+#include "mcu_shm.h"
+
+class MCUCapability;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -75,6 +78,13 @@ class ConferenceFileMember : public ConferenceMember
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#define CACHE_SUSPEND_DELAY    30000 // ms without users before the encoder is released
+#define CACHE_WAKEUP_INTERVAL  20    // ms, users check of the idle cache
+
+// The cache without users is idle, the encoder stays open for a fast wake up.
+// After CACHE_SUSPEND_DELAY the cache is suspended: the encoder and the buffer are released,
+// the capability with the encoder parameters and the last keyframe are kept,
+// a new user gets the keyframe at once while the encoder is opened again.
 class ConferenceCacheMember : public ConferenceMember
 {
   PCLASSINFO(ConferenceCacheMember, ConferenceMember);
@@ -84,6 +94,13 @@ class ConferenceCacheMember : public ConferenceMember
 
     virtual void Close();
 
+    enum CacheStates
+    {
+      CACHE_SUSPENDED = 0,
+      CACHE_IDLE,
+      CACHE_ACTIVE
+    };
+
     virtual PString GetName() const
     { return "cache"; }
 
@@ -96,6 +113,9 @@ class ConferenceCacheMember : public ConferenceMember
     PString GetMediaFormat()
     { return format; }
 
+    const OpalMediaFormat & GetCacheFormat() const
+    { return format; }
+
     int GetStatus()
     { return status; }
 
@@ -105,6 +125,9 @@ class ConferenceCacheMember : public ConferenceMember
     int GetCacheUsersNumber() const
     { return (cache ? cache->GetUsersNumber() : 0); }
 
+    MCUKeyFrameArbiter * GetKeyFrameArbiter()
+    { return (cache ? &cache->GetKeyFrameArbiter() : NULL); }
+
     const H323Codec * GetCodec() const
     { return codec; }
 
@@ -114,13 +137,19 @@ class ConferenceCacheMember : public ConferenceMember
     PDECLARE_NOTIFIER(PThread, ConferenceCacheMember, CacheThread);
 
   protected:
+    void OpenEncoder();
+    void CloseEncoder();
+
     OpalMediaFormat format;
     PString cacheName;
     PString roomName;
     int status;
+    PTime idleTime;
 
     bool isAudio;
 
+    MCUCapability * cap;
+    MCUH323Connection * conn;
     H323Codec * codec;
     CacheRTP *cache;
 
@@ -163,15 +192,133 @@ class ConferencePipeMember : public ConferenceMember
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-class ConferenceFilePlayer : public ConferenceFileMember
+#ifndef _WIN32
+
+#define SHM_EXPORT_AUDIO_SLOTS  50 // 1.5 sec of 30 ms frames
+#define SHM_EXPORT_VIDEO_SLOTS  8
+
+// the writer side of the ring from mcu_shm.h
+class MCUShmWriter
+{
+  public:
+    MCUShmWriter();
+    ~MCUShmWriter();
+
+    BOOL Open(const PString & _name, const MCUShmHeader & params, unsigned frame_size, unsigned slot_count);
+    void Write(const void * data, unsigned size, uint64_t timestamp);
+    void Close();
+
+    const PString & GetName() const
+    { return name; }
+
+  protected:
+    PString name;
+    int fd;
+    size_t map_size;
+    MCUShmHeader *header;
+    uint64_t seq;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Export to shared memory rings instead of the named pipes: no system call per frame,
+// the slow reader loses frames but never stops the MCU.
+class ConferenceShmMember : public ConferenceMember
 {
-  PCLASSINFO(ConferenceFilePlayer, ConferenceFileMember);
+  PCLASSINFO(ConferenceShmMember, ConferenceMember);
+
   public:
-    ConferenceFilePlayer();
+    ConferenceShmMember(Conference * conference);
+    ~ConferenceShmMember();
+
+    virtual void Close();
+
+    virtual PString GetName() const
+    { return PString("shared memory export"); }
 
-    void Unlisten();
+    void OnReceivedUserInputIndication(const PString & str)
+    { cout << "Received user input indication " << str << endl; }
 
-    PDECLARE_NOTIFIER(PThread, ConferenceFilePlayer, Thread);
+    PDECLARE_NOTIFIER(PThread, ConferenceShmMember, AudioThread);
+    PDECLARE_NOTIFIER(PThread, ConferenceShmMember, VideoThread);
+
+  protected:
+    PString roomName;
+    PString trace_section;
+    BOOL running;
+    PThread * audio_thread;
+    PThread * video_thread;
+};
+
+#endif // _WIN32
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define MEDIA_PLAYER_SAMPLE_RATE     16000 // the room without audio connections
+#define MEDIA_PLAYER_CHANNELS        1
+#define MEDIA_PLAYER_FRAME_MS        20
+#define MEDIA_PLAYER_MAX_FRAME_RATE  10
+#define MEDIA_CACHE_MAX_SIZE         (256*1024*1024) // decoded media of one file
+
+// The file is decoded once for all the players with the same audio format,
+// the rooms share the samples and the frames and keep the own positions.
+// The entry is deleted with the last player. A changed file is decoded
+// again, the old entry stays with its players.
+// The file is decoded outside the list mutex, the users of the same entry
+// wait for the loading entry only.
+class MCUMediaFileCache
+{
+  public:
+    static MCUMediaFileCache * Acquire(const PString & filename, int sampleRate, int channels);
+    static void Release(MCUMediaFileCache * cache);
+
+    const MCUAVMediaData & GetData() const
+    { return data; }
+
+  protected:
+    MCUMediaFileCache(const PString & _key);
+
+    BOOL Load(const PString & filename, int sampleRate, int channels);
+    BOOL IsChanged(const PString & filename) const;
+
+    PString key;
+    MCUAVMediaData data;
+    int users;
+    PTime fileTime;
+    PInt64 fileSize;
+
+    BOOL loading;             // under cacheListMutex
+    BOOL loaded;
+    PMutex loadMutex;         // held by the loading thread
+
+    typedef std::map<PString, MCUMediaFileCache *> CacheMap;
+    static CacheMap cacheList;
+    static PMutex cacheListMutex;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Music on hold or announcement from a compressed audio/video file, loops while
+// the room has online members. Visible member: mixed and shown in the layout.
+class ConferenceFilePlayer : public ConferenceMember
+{
+  PCLASSINFO(ConferenceFilePlayer, ConferenceMember);
+  public:
+    ConferenceFilePlayer(Conference * conference, const PString & _filename);
+    ~ConferenceFilePlayer();
+
+    virtual void Close();
+
+    virtual PString GetName() const
+    { return name; }
+
+    PDECLARE_NOTIFIER(PThread, ConferenceFilePlayer, PlayThread);
+
+  protected:
+    PString filename;
+    PString trace_section;
+    BOOL running;
+    PThread * thread;
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -167,6 +167,7 @@ window.l_name_auto_delete_empty        = 'Auto eliminação';
 window.l_name_auto_record_start        = 'Auto gravação';
 window.l_name_recall_last_template     = 'Recarrega último modelo';
 window.l_name_time_limit               = 'Limite de tempo';
+window.l_name_media_player             = 'Media player file';
 
 window.l_name_display_name                         = 'Sobrepõe o nome mostrado';
 window.l_name_frame_rate_from_mcu                  = 'Frame rate da MCU';
@@ -293,6 +294,7 @@ window.l_encoding_threads                          = "Encoding threads";
 window.l_encoding_cpu_used                         = "Encoding CPU used";
 ///
 window.l_enable_export                             = "Enable export";
+window.l_export_mode                               = "Export mode";
 window.l_video_frame_rate                          = "Video frame rate";
 window.l_video_frame_width                         = "Video frame width";
 window.l_video_frame_height                        = "Video frame height";
@@ -321,6 +323,14 @@ window.l_server_list                               = "Server list";
 window.l_directory                                 = "Directory";
 window.l_rtp_input_timeout                         = "RTP Input Timeout";
 window.l_received_vfu_delay                        = "Limitation VFU, r/s";
+window.l_video_nack                                = "Video NACK/RTX";
+window.l_audio_dtx                                 = "Audio DTX";
+window.l_recorder_remux                            = "Remux room cache";
+window.l_recorder_segment                          = "Segment duration";
+window.l_recorder_write_queue                      = "Write queue";
+window.l_recorder_direct_io                        = "Direct I/O";
+window.l_live_streaming                            = "Live streaming (HLS)";
+window.l_live_segment_duration                     = "Live segment duration";
 window.l_video_cache                               = "Video cache";
 window.l_interval                                  = "interval";
 window.l_internal_call_processing                  = "Internal call processing";
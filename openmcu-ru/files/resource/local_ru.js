@@ -177,6 +177,7 @@ window.l_name_auto_record_stop         = 'Автоматическая запи
 window.l_lock_tpl_default              = "Отключать терминалы, отсутствующие в шаблоне (запереть конференцию)";
 window.l_name_recall_last_template     = 'Создать с последним шаблоном';
 window.l_name_time_limit               = 'Ограничение по времени';
+window.l_name_media_player             = 'Файл проигрывателя';
 
 window.l_name_display_name                         = 'Отображаемое имя';
 window.l_name_frame_rate_from_mcu                  = 'Частота кадров от MCU';
@@ -306,6 +307,7 @@ window.l_encoding_threads                          = "Количество по
 window.l_encoding_cpu_used                         = "Использование процессора для кодирования";
 ///
 window.l_enable_export                             = "Включить экспорт";
+window.l_export_mode                               = "Способ экспорта";
 window.l_video_frame_rate                          = "Видео частота кадров";
 window.l_video_frame_width                         = "Видео ширина кадра";
 window.l_video_frame_height                        = "Видео высота кадра";
@@ -334,6 +336,14 @@ window.l_server_list                               = "Список сервер
 window.l_directory                                 = "Директория";
 window.l_rtp_input_timeout                         = "RTP таймаут";
 window.l_received_vfu_delay                        = "Ограничение VFU, з/с";
+window.l_video_nack                                = "Повтор пакетов (NACK)";
+window.l_audio_dtx                                 = "Прерывистая передача звука (DTX)";
+window.l_recorder_remux                            = "Запись из кэша комнаты без перекодирования";
+window.l_recorder_segment                          = "Длительность сегмента";
+window.l_recorder_write_queue                      = "Очередь записи";
+window.l_recorder_direct_io                        = "Прямой ввод-вывод";
+window.l_live_streaming                            = "Трансляция (HLS)";
+window.l_live_segment_duration                     = "Длительность сегмента трансляции";
 window.l_video_cache                               = "Видео кэширование";
 window.l_interval                                  = "интервал";
 window.l_internal_call_processing                  = "Внутренние звонки";
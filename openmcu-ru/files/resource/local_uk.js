@@ -175,6 +175,7 @@ window.l_name_auto_delete_empty        = 'Автоматичне видален
 window.l_name_auto_record_start        = 'Автоматичний запис';
 window.l_name_recall_last_template     = 'Створити з останнім шаблоном';
 window.l_name_time_limit               = 'Обмежити за часом';
+window.l_name_media_player             = 'Файл програвача';
 
 window.l_name_display_name                         = "Ім'я, що відображається";
 window.l_name_frame_rate_from_mcu                  = 'Частота кадрів від MCU';
@@ -301,6 +302,7 @@ window.l_encoding_threads                          = "Кількість пот
 window.l_encoding_cpu_used                         = "Використання процесора для кодування";
 ///
 window.l_enable_export                             = "Включити експорт";
+window.l_export_mode                               = "Спосіб експорту";
 window.l_video_frame_rate                          = "Відео частота кадрів";
 window.l_video_frame_width                         = "Відео ширина кадрів";
 window.l_video_frame_height                        = "Відео висота кадрів";
@@ -329,6 +331,14 @@ window.l_server_list                               = "Список серверi
 window.l_directory                                 = "Директорія";
 window.l_rtp_input_timeout                         = "RTP таймаут";
 window.l_received_vfu_delay                        = "Обмеження VFU (запит/сек)";
+window.l_video_nack                                = "Повтор пакетів (NACK)";
+window.l_audio_dtx                                 = "Переривчаста передача звуку (DTX)";
+window.l_recorder_remux                            = "Запис з кешу кімнати без перекодування";
+window.l_recorder_segment                          = "Тривалість сегмента";
+window.l_recorder_write_queue                      = "Черга запису";
+window.l_recorder_direct_io                        = "Прямий ввід-вивід";
+window.l_live_streaming                            = "Трансляція (HLS)";
+window.l_live_segment_duration                     = "Тривалість сегмента трансляції";
 window.l_video_cache                               = "Відео кешування";
 window.l_interval                                  = "інтервал";
 window.l_internal_call_processing                  = "Внутрішні дзвінки";
@@ -209,13 +209,25 @@ function member_get_nice_codecs(m)
   if(!m[0]) return "-";
   if(m[1]==RECORDER_NAME) return "-";
   if(m[1]==FILE_RECORDER_NAME) return "-";
-  if(m[1]==CACHE_NAME && m[27] == 0) return "<nobr><b>" + VIDEO_OUT_STR + ":</b> " + m[14] + "</nobr>";
+  if(m[1]==CACHE_NAME && m[27] == 0) return "<nobr><b>" + VIDEO_OUT_STR + ":</b> " + m[14] + "</nobr>" + member_get_nice_keyframes(m);
   if(m[1]==CACHE_NAME && m[27] == 1) return "<nobr><b>" + AUDIO_OUT_STR + ":</b> " + m[14] + "</nobr>";
 
   return member_get_nice_stream(1,0         ,AUDIO_IN_STR ,m[ 9], AI_NEG_ERR ) + "<br>" +
          member_get_nice_stream(1,0         ,AUDIO_OUT_STR,m[10], AO_NEG_ERR) + "<br>" +
          member_get_nice_stream(0,0         ,VIDEO_IN_STR ,m[11], VI_NEG_ERR ) + "<br>" +
-         member_get_nice_stream(0,(m[13]==2),VIDEO_OUT_STR,m[12],VO_NEG_ERR);
+         member_get_nice_stream(0,(m[13]==2),VIDEO_OUT_STR,m[12],VO_NEG_ERR) +
+         member_get_nice_keyframes(m);
+}
+
+function member_get_nice_keyframes(m)
+{
+  // key frames sent / requests received, requests by source in title
+  var k=m[28];
+  if(!k) return "";
+  var t="";
+  for(var s in k.sources) t+=s+": "+k.sources[s]+"\n";
+  t=t.replace(/&/g,"&amp;").replace(/'/g,"&#39;").replace(/</g,"&lt;");
+  return "<br><nobr title='" + t + "'>I: " + k.keyframes + "/" + k.requests + "</nobr>";
 }
 
 function member_get_nice_packets(m)
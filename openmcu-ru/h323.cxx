@@ -133,6 +133,7 @@ void H323CallThread::Main()
 MCUH323EndPoint::MCUH323EndPoint(ConferenceManager & _conferenceManager)
   : conferenceManager(_conferenceManager)
 {
+  connectionList.EnableIndex();
   rsCaps = NULL;
   tsCaps = NULL;
   rvCaps = NULL;
@@ -909,26 +910,24 @@ void MCUH323EndPoint::TranslateTCPAddress(PIPSocket::Address &localAddr, const P
 
 PString MCUH323EndPoint::GetRoomStatusJS()
 {
-  PString str = "Array(";
+  MCUJSONWriter c;
+  c.Reserve(4096);
   PTime now;
 
-  BOOL firstConference = TRUE;
+  c.BeginArray();
   MCUConferenceList & conferenceList = conferenceManager.GetConferenceList();
   for(MCUConferenceList::shared_iterator it = conferenceList.begin(); it != conferenceList.end(); ++it)
   {
     Conference *conference = it.GetObject();
-    PStringStream c;
 
-    c << "Array("
-        << JsQuoteScreen(conference->GetNumber())                              // c[r][0]: room name
-        << "," << conference->GetMemberList().GetSize()                        // c[r][1]: memberList size
-        << "," << conference->GetMemberList().GetSize()                        // c[r][2]: profileList size
-        << "," << PString((now - conference->GetStartTime()).GetMilliSeconds())// c[r][3]: duration
-        << ",Array("                                                           // c[r][4]: member descriptors
-    ;
+    c.BeginArray();
+    c.Value(conference->GetNumber());                                          // c[r][0]: room name
+    c.Value(conference->GetMemberList().GetSize());                            // c[r][1]: memberList size
+    c.Value(conference->GetMemberList().GetSize());                            // c[r][2]: profileList size
+    c.Value((now - conference->GetStartTime()).GetMilliSeconds());             // c[r][3]: duration
+    c.BeginArray();                                                            // c[r][4]: member descriptors
 
     {
-      BOOL firstMember = TRUE;
       MCUMemberList & memberList = conference->GetMemberList();
       for(MCUMemberList::shared_iterator it2 = memberList.begin(); it2 != memberList.end(); ++it2)
       {
@@ -936,13 +935,11 @@ PString MCUH323EndPoint::GetRoomStatusJS()
         if(!member->IsSystem() && !member->IsOnline())
           continue;
 
-        if(!firstMember) c << ",";
-        c << "Array("                                                          // c[r][4][m]: member m descriptor
-          << (long)member->GetID()                                             // c[r][4][m][0]: member id
-          << "," << JsQuoteScreen(member->GetName())                           // c[r][4][m][1]: member name
-          << "," << (member->IsOnline() ? "1" : "0")                           // c[r][4][m][2]: is member visible: 1/0
-          << "," << PString(member->GetType())                                 // c[r][4][m][3]: 0-NONE, 1-MCU ...
-        ;
+        c.BeginArray();                                                        // c[r][4][m]: member m descriptor
+        c.Value((long)member->GetID());                                        // c[r][4][m][0]: member id
+        c.Value(member->GetName());                                            // c[r][4][m][1]: member name
+        c.Value(member->IsOnline() ? true : false);                            // c[r][4][m][2]: is member visible: 1/0
+        c.Value((int)member->GetType());                                       // c[r][4][m][3]: 0-NONE, 1-MCU ...
 
         PTimeInterval duration;
         PString formatString, audioCodecR, audioCodecT, videoCodecR, videoCodecT, ra;
@@ -950,6 +947,7 @@ PString MCUH323EndPoint::GetRoomStatusJS()
         MCUH323Connection * conn = NULL;
         DWORD orx=0, otx=0, vorx=0, votx=0, prx=0, ptx=0, vprx=0, vptx=0, plost=0, vplost=0, plostTx=0, vplostTx=0;
         bool isAudioCache = false;
+        MCUJSONWriter keyFrames;
         if(member->GetType() == MEMBER_TYPE_PIPE)
         {
           duration = now - member->GetStartTime();
@@ -958,6 +956,10 @@ PString MCUH323EndPoint::GetRoomStatusJS()
         {
           duration = PTime() - member->GetStartTime();
         }
+        else if(member->GetType() == MEMBER_TYPE_PLAYER)
+        {
+          duration = now - member->GetStartTime();
+        }
         else if(member->GetType() == MEMBER_TYPE_STREAM)
         {
           duration = PTime() - member->GetStartTime();
@@ -987,6 +989,8 @@ PString MCUH323EndPoint::GetRoomStatusJS()
             {
               codecCacheMode = conn->GetVideoTransmitChannel()->GetCacheMode();
               formatString = conn->GetVideoTransmitChannel()->GetCacheName();
+              if(codecCacheMode != 2)
+                conn->GetVideoTransmitChannel()->GetKeyFrameArbiter().WriteStatus(keyFrames);
             }
             conn->GetChannelsMutex().Signal();
 #endif
@@ -1003,6 +1007,8 @@ PString MCUH323EndPoint::GetRoomStatusJS()
             formatString = cacheMember->GetCacheName();
             cacheUsersNumber = cacheMember->GetCacheUsersNumber();
             codecCacheMode = 1;
+            if(!isAudioCache && cacheMember->GetKeyFrameArbiter())
+              cacheMember->GetKeyFrameArbiter()->WriteStatus(keyFrames);
           }
           duration = now - member->GetStartTime();
         }
@@ -1037,6 +1043,8 @@ PString MCUH323EndPoint::GetRoomStatusJS()
                 {
                   codecCacheMode = conn->GetVideoTransmitChannel()->GetCacheMode();
                   formatString = conn->GetVideoTransmitChannel()->GetCacheName();
+                  if(codecCacheMode != 2)
+                    conn->GetVideoTransmitChannel()->GetKeyFrameArbiter().WriteStatus(keyFrames);
                 }
                 conn->GetChannelsMutex().Signal();
 
@@ -1046,33 +1054,31 @@ PString MCUH323EndPoint::GetRoomStatusJS()
           }
         }
 
-        c << "," << duration.GetMilliSeconds()                                 // c[r][4][m][4]: member duration
-          << "," << orx << "," << otx << "," << vorx << "," << votx            // c[r][4][m][5-8]: orx, otx, vorx, votx
-          << "," << JsQuoteScreen(audioCodecR)                                 // c[r][4][m][9]: audio receive codec name
-          << "," << JsQuoteScreen(audioCodecT)                                 // c[r][4][m][10]: audio transmit codec name
-          << "," << JsQuoteScreen(videoCodecR)                                 // c[r][4][m][11]: video receive codec name
-          << "," << JsQuoteScreen(videoCodecT)                                 // c[r][4][m][12]: video transmit codec name
-          << "," << codecCacheMode << "," << JsQuoteScreen(formatString)       // c[r][4][m][13,14]: codecCacheMode, formatString
-          << "," << member->GetVideoRxFrameRate()                              // c[r][4][m][15]: video rx frame rate
-          << "," << member->GetVideoTxFrameRate()                              // c[r][4][m][16]: video tx frame rate
-          << "," << cacheUsersNumber                                           // c[r][4][m][17]: cache users number
-          << "," << prx << "," << ptx << "," << vprx << "," << vptx            // c[r][4][m][18-21]: prx, ptx, vprx, vptx
-          << "," << JsQuoteScreen(ra)                                          // c[r][4][m][22]: remote application name
-          << "," << plost << "," << vplost << "," << plostTx << "," << vplostTx// c[r][4][m][23-26]: rx & tx_from_RTCP packets lost (audio, video)
-          << "," << isAudioCache                                               // c[r][4][m][27]: audio cache
-          << ")";
-        firstMember = FALSE;
+        c.Value(duration.GetMilliSeconds());                                   // c[r][4][m][4]: member duration
+        c.Value(orx).Value(otx).Value(vorx).Value(votx);                       // c[r][4][m][5-8]: orx, otx, vorx, votx
+        c.Value(audioCodecR);                                                  // c[r][4][m][9]: audio receive codec name
+        c.Value(audioCodecT);                                                  // c[r][4][m][10]: audio transmit codec name
+        c.Value(videoCodecR);                                                  // c[r][4][m][11]: video receive codec name
+        c.Value(videoCodecT);                                                  // c[r][4][m][12]: video transmit codec name
+        c.Value(codecCacheMode).Value(formatString);                           // c[r][4][m][13,14]: codecCacheMode, formatString
+        c.Value(member->GetVideoRxFrameRate());                                // c[r][4][m][15]: video rx frame rate
+        c.Value(member->GetVideoTxFrameRate());                                // c[r][4][m][16]: video tx frame rate
+        c.Value(cacheUsersNumber);                                             // c[r][4][m][17]: cache users number
+        c.Value(prx).Value(ptx).Value(vprx).Value(vptx);                       // c[r][4][m][18-21]: prx, ptx, vprx, vptx
+        c.Value(ra);                                                           // c[r][4][m][22]: remote application name
+        c.Value(plost).Value(vplost).Value(plostTx).Value(vplostTx);           // c[r][4][m][23-26]: rx & tx_from_RTCP packets lost (audio, video)
+        c.Value(isAudioCache);                                                 // c[r][4][m][27]: audio cache
+        if(keyFrames.GetString().empty()) c.Null();                            // c[r][4][m][28]: key frame requests
+        else                              c.Raw("", keyFrames.GetString());
+        c.End();
       }
-      c << "))";
     }
 
-    if(!firstConference) str += ",";
-    firstConference = FALSE;
-    str += c;
+    c.End().End();
   }
 
-  str += ")";
-  return str;
+  c.End();
+  return c.GetString();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1342,9 +1348,9 @@ PString MCUH323EndPoint::GetConferenceOptsJavascript(Conference & c)
   for(MCUVideoMixerList::shared_iterator it = videoMixerList.begin(); it != videoMixerList.end(); ++it)
   {
     MCUSimpleVideoMixer *mixer = it.GetObject();
-    MCUJSON* vmc=GetVideoMixerConfiguration(mixer, it.GetIndex());
-    r << "," << vmc->AsString();
-    delete vmc; //FIXME? Delete structure?
+    MCUJSONWriter vmc;
+    WriteVideoMixerConfiguration(vmc, mixer, it.GetIndex());
+    r << "," << vmc.GetString();
   }
 
   r << "];"; //l1 close
@@ -1353,97 +1359,103 @@ PString MCUH323EndPoint::GetConferenceOptsJavascript(Conference & c)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-MCUJSON* MCUH323EndPoint::GetVideoMixerConfiguration(MCUVideoMixer * mixer, int number)
+void MCUH323EndPoint::WriteVideoMixerConfiguration(MCUJSONWriter & a, MCUVideoMixer * mixer, int number)
 {
-  MCUJSON* a = new MCUJSON(MCUJSON::JSON_ARRAY);
-  if(mixer == NULL) return a;
+  a.BeginArray();
+  if(mixer == NULL)
+  {
+    a.End();
+    return;
+  }
   unsigned n = mixer->GetPositionSet();
   VMPCfgSplitOptions & split=OpenMCU::vmcfg.vmconf[n].splitcfg;
   VMPCfgOptions      * p    =OpenMCU::vmcfg.vmconf[n].vmpcfg;
-  
-  MCUJSON* b = new MCUJSON(MCUJSON::JSON_ARRAY);
-  b->Insert(split.mockup_width);
-  b->Insert(split.mockup_height);   //   a[0][0-1] = mw * mh
-  b->Insert(n);                     //   a[0][2]   = position set (layout)
-  b->Insert(number);                //   a[0][3]   = number
 
-  a->Insert(b);
-  
-  MCUJSON* c=new MCUJSON(MCUJSON::JSON_ARRAY); // a[1]: frame geometry for each position i:
+  a.BeginArray();
+  a.Value(split.mockup_width);
+  a.Value(split.mockup_height);     //   a[0][0-1] = mw * mh
+  a.Value(n);                       //   a[0][2]   = position set (layout)
+  a.Value(number);                  //   a[0][3]   = number
+  a.End();
+
+  a.BeginArray();                   // a[1]: frame geometry for each position i:
   for(unsigned i=0;i<split.vidnum;i++)
   {
-    MCUJSON* b = new MCUJSON(MCUJSON::JSON_ARRAY);
-    b->Insert(p[i].posx); // a[1][i][0-1]= posx & posy
-    b->Insert(p[i].posy);
-    b->Insert(p[i].width);  // a[1][i][2-3]= width & height
-    b->Insert(p[i].height);
-    b->Insert(p[i].border);  // a[1][i][4]  = border
-    c->Insert(b);
+    a.BeginArray();
+    a.Value(p[i].posx); // a[1][i][0-1]= posx & posy
+    a.Value(p[i].posy);
+    a.Value(p[i].width);  // a[1][i][2-3]= width & height
+    a.Value(p[i].height);
+    a.Value(p[i].border);  // a[1][i][4]  = border
+    a.End();
   }
-  a->Insert(c);
-  
-  a->Insert(mixer->VMPListScanJS()); // a[2], a[3]: members' ids & types
+  a.End();
+
+  mixer->VMPListScanJS(a); // a[2], a[3]: members' ids & types
 
-  return a;
+  a.End();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-MCUJSON* MCUH323EndPoint::GetMemberDataJS(ConferenceMember * member)
+void MCUH323EndPoint::WriteMemberDataJS(MCUJSONWriter & a, ConferenceMember * member)
 {
-  MCUJSON* a = new MCUJSON(MCUJSON::JSON_ARRAY);
-  if(!member) return a;
-  a->Insert(member->IsOnline()); //0: 1=online
-  a->Insert((long)member->GetID()); //1: long id
-  a->Insert(member->GetName()); //2: name [ip]
-  a->Insert(member->muteMask); //3: mute
-  a->Insert(member->disableVAD); //4
-  a->Insert(member->chosenVan); //5
-  a->Insert(member->GetAudioLevel()); //6: audio level
-  a->Insert(member->GetVideoMixerNumber()); //7: number of mixer member receiving
-  a->Insert(member->GetNameID()); //8: memberName id
-  a->Insert(member->channelMask); //9: RTP channels check bit mask 0000vVaA
-  a->Insert(member->kManualGainDB); //10: Audio level gain for manual tune, integer: -20..60
-  a->Insert(member->kOutputGainDB); //11: Output audio gain, integer: -20..60
-  a->Insert(GetVideoMixerConfiguration(member->videoMixer, 0)); //12: mixer configuration
-  a->Insert(member->GetType()); //13
-  a->Insert(member->autoDial); //14
-  a->Insert(member->resizerRule); //15
-  return a;
+  a.BeginArray();
+  if(!member)
+  {
+    a.End();
+    return;
+  }
+  a.Value(member->IsOnline()); //0: 1=online
+  a.Value((long)member->GetID()); //1: long id
+  a.Value(member->GetName()); //2: name [ip]
+  a.Value(member->muteMask); //3: mute
+  a.Value(member->disableVAD); //4
+  a.Value(member->chosenVan); //5
+  a.Value(member->GetAudioLevel()); //6: audio level
+  a.Value(member->GetVideoMixerNumber()); //7: number of mixer member receiving
+  a.Value(member->GetNameID()); //8: memberName id
+  a.Value(member->channelMask); //9: RTP channels check bit mask 0000vVaA
+  a.Value(member->kManualGainDB); //10: Audio level gain for manual tune, integer: -20..60
+  a.Value(member->kOutputGainDB); //11: Output audio gain, integer: -20..60
+  WriteVideoMixerConfiguration(a, member->videoMixer, 0); //12: mixer configuration
+  a.Value((int)member->GetType()); //13
+  a.Value(member->autoDial); //14
+  a.Value(member->resizerRule); //15
+  a.End();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 PString MCUH323EndPoint::GetMemberListOptsJavascript(Conference & conference)
 {
-  MCUJSON a(MCUJSON::JSON_ARRAY);
+  MCUJSONWriter a;
+  a.Reserve(1024);
+  a.BeginArray();
   MCUMemberList & memberList = conference.GetMemberList();
   for(MCUMemberList::shared_iterator it = memberList.begin(); it != memberList.end(); ++it)
   {
     ConferenceMember *member = *it;
     if(member->IsSystem())
       continue;
-    a.Insert(GetMemberDataJS(member));
+    WriteMemberDataJS(a, member);
   }
+  a.End();
 
-  return "members=" + a.AsString();
+  return "members=" + a.GetString();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 PString MCUH323EndPoint::GetAddressBookOptsJavascript()
 {
-  PString msg = "addressbook=Array(";
+  MCUJSONWriter json(false, false);
+  json.BeginArray();
   MCUAbookList & abookList = OpenMCU::Current().GetRegistrar()->GetAbookList();
-  int i = 0;
-  for(MCUAbookList::shared_iterator it = abookList.begin(); it != abookList.end(); ++it, ++i)
-  {
-    if(i > 0)
-      msg += ",";
-    msg += it->AsJsArray();
-  }
-  msg += ");";
-  return msg;
+  for(MCUAbookList::shared_iterator it = abookList.begin(); it != abookList.end(); ++it)
+    it->AsJSON(json);
+  json.End();
+  return "addressbook=" + json.GetString() + ";";
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1624,7 +1636,8 @@ PString MCUH323EndPoint::GetMonitorText()
   MCUConferenceList & conferenceList = conferenceManager.GetConferenceList();
 
   output << "Room Count: " << conferenceList.GetSize() << "\n"
-         << "Max Room Count: " << conferenceManager.GetMaxConferenceCount() << "\n";
+         << "Max Room Count: " << conferenceManager.GetMaxConferenceCount() << "\n"
+         << OpenMCU::Current().GetOverloadController().GetMonitorText();
 
   PINDEX confNum = 0;
 
@@ -1672,7 +1685,7 @@ PString MCUH323EndPoint::GetMonitorText()
         {
           output << hdr << "Format: " << cacheMember->GetMediaFormat() << "\n";
           output << hdr << "IsVisible: " << cacheMember->IsVisible() << "\n";
-          output << hdr << "Status: " << (cacheMember->GetStatus()?"Awake":"Sleeping") << "\n";
+          output << hdr << "Status: " << (cacheMember->GetStatus() == ConferenceCacheMember::CACHE_ACTIVE ? "Awake" : (cacheMember->GetStatus() == ConferenceCacheMember::CACHE_IDLE ? "Sleeping" : "Suspended")) << "\n";
         }
       }
       if(member->videoMixer!=NULL)
@@ -1753,8 +1766,10 @@ PString MCUH323EndPoint::Invite(PString room, PString memberName)
   }
   else if(url.GetScheme() == "rtsp")
   {
+    // a room of this MCU can be received as a camera
+    BOOL allowLoopbackCalls = MCUConfig("Parameters").GetBoolean(AllowLoopbackCallsKey, FALSE);
     MCURtspServer *rtsp = OpenMCU::Current().GetRtspServer();
-    if(rtsp->HasListener(url.GetHostName(), url.GetPort()))
+    if(!allowLoopbackCalls && rtsp->HasListener(url.GetHostName(), url.GetPort()))
     {
       msg << "failed, Loopback call rejected";
       goto end;
@@ -2633,6 +2648,12 @@ H323Connection::AnswerCallResponse MCUH323Connection::OnAnswerCall(const PString
   if(requestedRoom.IsEmpty())
     return AnswerCallDenied;
 
+  if(OpenMCU::Current().GetOverloadController().RejectCalls())
+  {
+    PTRACE(1, trace_section << "overload, call rejected");
+    return AnswerCallDenied;
+  }
+
   // redirect to registrar
   Registrar *registrar = OpenMCU::Current().GetRegistrar();
   return registrar->OnReceivedH323Invite(this);
@@ -2705,9 +2726,9 @@ BOOL MCUH323Connection::OnH245_MiscellaneousCommand(const H245_MiscellaneousComm
       return TRUE;
 
     PWaitAndSignal m(channelsMutex);
-    if(videoTransmitChannel && videoTransmitChannel->GetCacheMode() != 0)
+    if(videoTransmitChannel)
     {
-      videoTransmitChannel->OnFastUpdatePicture();
+      videoTransmitChannel->OnFastUpdatePicture(memberName);
       return TRUE;
     }
   }
@@ -2874,6 +2895,12 @@ BOOL MCUH323Connection::OpenAudioChannel(BOOL isEncoding, unsigned /* bufferSize
       audioTransmitChannel->SetCacheName(audioTransmitCodecName);
       audioTransmitChannel->SetCacheMode(2);
     }
+    else if(GetEndpointParam(AudioDtxKey, DisableKey) == EnableKey)
+    {
+      // DTX: кадры тишины после микширования не кодируются и не передаются,
+      // порог по шкале uLaw (~-60dBov), начало речи 10ms, конец через 400ms
+      codec.SetSilenceDetectionMode(H323AudioCodec::FixedSilenceDetection, 16, sampleRate/100, sampleRate*2/5);
+    }
 
     codec.AttachChannel(new OutgoingAudio(*this, sampleRate, channels), TRUE);
 
@@ -2926,7 +2953,7 @@ BOOL MCUH323Connection::OpenVideoChannel(BOOL isEncoding, H323VideoCodec & codec
     if(conference)
       forceScreenSplit = conference->GetForceScreenSplit();
     else
-      forceScreenSplit = GetConferenceParam(requestedRoom, ForceSplitVideoKey, TRUE);
+      forceScreenSplit = MCUConfigSnapshot::GetConferenceConfig(requestedRoom).forceSplitVideo;
     int cacheMode = 0;
     if(forceScreenSplit)
     {
@@ -2956,6 +2983,13 @@ BOOL MCUH323Connection::OpenVideoChannel(BOOL isEncoding, H323VideoCodec & codec
     if(cacheMode == 0 || cacheMode == 2)
       SetEndpointDefaultVideoParams(codec);
 
+    // потоки кодера из общего запаса, настройка кодека имеет приоритет,
+    // с кэшем кодер работает только до перехода на кадры из кэша
+    unsigned threads = codec.GetMediaFormat().GetOptionInteger(OPTION_ENCODING_THREADS, 0);
+    if(cacheMode == 2)
+      threads = 1;
+    ((MCUVideoCodec &)codec).SetThreads(threads);
+
     // get frame rate from codec
     const OpalMediaFormat & mf = codec.GetMediaFormat();
     unsigned frameRate;
@@ -3023,6 +3057,9 @@ BOOL MCUH323Connection::OpenVideoChannel(BOOL isEncoding, H323VideoCodec & codec
     videoReceiveChannel = ((MCUVideoCodec &)codec).GetLogicalChannel();
     videoReceiveCodecName = codec.GetMediaFormat();
 
+    // потоки декодера из общего запаса
+    ((MCUVideoCodec &)codec).SetThreads(0);
+
     if(conference && conference->IsModerated() == "+" && conferenceMember)
       conference->FreezeVideo(conferenceMember->GetID());
 
@@ -3550,6 +3587,16 @@ BOOL MCUH323Connection::OnIncomingAudio(const uint64_t & timestamp, const void *
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+BOOL MCUH323Connection::OnIncomingSilence(int level, PINDEX amount, unsigned sampleRate, unsigned channels)
+{
+  if(conferenceMember != NULL)
+    conferenceMember->WriteSilence(level, amount, sampleRate, channels);
+
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 BOOL MCUH323Connection::OnOutgoingAudio(const uint64_t & timestamp, void * buffer, PINDEX amount, unsigned sampleRate, unsigned channels)
 {
 /*
@@ -4004,6 +4051,7 @@ BOOL OutgoingAudio::Read(void * buffer, PINDEX amount)
   {
     unsigned delay_us = 1000000 * amount / (sampleRate * channels * 2);
     delay.DelayUsec(delay_us);
+    OpenMCU::Current().GetOverloadController().OnAudioTick(delay.GetLateUsec());
   }
 
   if(!conn.OnOutgoingAudio(delay.GetDelayTimestampUsec(), buffer, amount, sampleRate, channels))
@@ -4060,6 +4108,29 @@ BOOL IncomingAudio::Write(const void * buffer, PINDEX amount)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+BOOL IncomingAudio::WriteSilence(PINDEX amount, int level)
+{
+  PWaitAndSignal mutexW(audioChanMutex);
+
+  if(!IsOpen())
+    return FALSE;
+
+  if(lastWriteCount == 0)
+    delay.Restart();
+
+  // темп записи тот же, что и для декодированного звука
+  unsigned delay_us = 1000000 * amount / (sampleRate * channels * 2);
+
+  conn.OnIncomingSilence(level, amount, sampleRate, channels);
+
+  delay.DelayUsec(delay_us);
+
+  lastWriteCount = amount;
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 BOOL IncomingAudio::Close()
 {
   if (!IsOpen())
@@ -4123,6 +4194,9 @@ int ConnectionMonitor::Perform(MCUH323Connection * conn)
   if((ret = RTPTimeoutMonitor(conn)) != 0)
     return ret;
 
+  if((ret = RtspKeepaliveMonitor(conn)) != 0)
+    return ret;
+
   return 0;
 }
 
@@ -4158,6 +4232,17 @@ int ConnectionMonitor::RTPTimeoutMonitor(MCUH323Connection * conn)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+int ConnectionMonitor::RtspKeepaliveMonitor(MCUH323Connection * conn)
+{
+  // the RTSP server closes the session without requests
+  if(conn->GetConnectionType() == CONNECTION_TYPE_RTSP)
+    ((MCURtspConnection *)conn)->SendKeepalive();
+
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void GatekeeperMonitor::Main()
 {
   for(;;)
@@ -52,8 +52,8 @@ class MCUH323EndPoint : public H323EndPoint
     PString GetRoomStatus(const PString & block);
     PString GetRoomStatusJS();
     PString GetRoomStatusJSStart();
-    MCUJSON* GetVideoMixerConfiguration(MCUVideoMixer * mixer, int number);
-    MCUJSON* GetMemberDataJS(ConferenceMember * member);
+    void WriteVideoMixerConfiguration(MCUJSONWriter & writer, MCUVideoMixer * mixer, int number);
+    void WriteMemberDataJS(MCUJSONWriter & writer, ConferenceMember * member);
     PString GetConferenceOptsJavascript(Conference & c);
     PString GetMemberListOptsJavascript(Conference & conference);
     PString GetAddressBookOptsJavascript();
@@ -182,6 +182,8 @@ class IncomingAudio : public PChannel
     IncomingAudio(MCUH323Connection & conn, unsigned int _sampleRate, unsigned _channels);
 
     BOOL Write(const void * buffer, PINDEX amount);
+    // интервал без голоса длиной amount байт, level в -dBov
+    BOOL WriteSilence(PINDEX amount, int level);
     BOOL Close();
 
   protected:
@@ -305,6 +307,7 @@ class MCUH323Connection : public H323Connection
     virtual void SendUserInput(const PString & value);
 
     virtual BOOL OnIncomingAudio(const uint64_t & timestamp, const void * buffer, PINDEX amount, unsigned sampleRate, unsigned channels);
+    virtual BOOL OnIncomingSilence(int level, PINDEX amount, unsigned sampleRate, unsigned channels);
     virtual BOOL OnOutgoingAudio(const uint64_t & timestamp, void * buffer, PINDEX amount, unsigned sampleRate, unsigned channels);
 
     void SetRemoteName(const H323SignalPDU & pdu);
@@ -703,7 +706,7 @@ class MCUPVideoInputDevice : public PVideoInputDevice
     virtual BOOL TestAllFormats()
       { return TRUE; }
       
-    void Restart() { grabDelay.Restart(); }
+    void Restart() { grabDelay.Restart(); grabTime = 0; }
 
   protected:
     MCUH323Connection & mcuConnection;
@@ -711,6 +714,7 @@ class MCUPVideoInputDevice : public PVideoInputDevice
     PINDEX   videoFrameSize;
     PINDEX   scanLineWidth;
     PAdaptiveDelay grabDelay;
+    uint64_t grabTime;
 };
 
 
@@ -807,6 +811,7 @@ class ConnectionMonitor : public PThread
   protected:
     int Perform(MCUH323Connection * conn);
     int RTPTimeoutMonitor(MCUH323Connection * conn);
+    int RtspKeepaliveMonitor(MCUH323Connection * conn);
 
     MCUH323EndPoint & ep;
     MCUConnectionList monitorList;
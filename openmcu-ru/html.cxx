@@ -325,6 +325,10 @@ GeneralPConfigPage::GeneralPConfigPage(PHTTPServiceProcess & app,const PString &
 
   s << StringField(RecorderFfmpegDirKey, JsLocal("param_record")+": "+JsLocal("directory"), mcu.vr_ffmpegDir, 250, dirInfo);
   s << SelectField(RecorderVideoCodecKey, JsLocal("param_record")+": "+JsLocal("name_video_codec"), cfg.GetString(RecorderVideoCodecKey, RecorderDefaultVideoCodec), GetRecorderCodecs(1));
+  s << BoolField(RecorderRemuxKey, JsLocal("param_record")+": "+JsLocal("recorder_remux"), cfg.GetBoolean(RecorderRemuxKey, FALSE), "H.264/VP8 and Opus/G.722 from the room cache without re-encoding");
+  s << IntegerField(RecorderSegmentKey, JsLocal("param_record")+": "+JsLocal("recorder_segment"), cfg.GetInteger(RecorderSegmentKey, 0), 0, RECORDER_SEGMENT_MAX, 0, "sec, 0 - single file; segments with a manifest are joined when recording stops");
+  s << IntegerField(RecorderWriteQueueKey, JsLocal("param_record")+": "+JsLocal("recorder_write_queue"), cfg.GetInteger(RecorderWriteQueueKey, RECORDER_WRITE_QUEUE_DEFAULT), 0, RECORDER_WRITE_QUEUE_MAX, 0, "MiB, 0 - synchronous write; when it fills up the video is dropped");
+  s << BoolField(RecorderDirectIOKey, JsLocal("param_record")+": "+JsLocal("recorder_direct_io"), cfg.GetBoolean(RecorderDirectIOKey, FALSE), "O_DIRECT, bypass the page cache");
 
   // bak 2014.10.20 ////////////////////////////////////
   PString RecorderFrameWidthKey  = "Video Recorder frame width";
@@ -386,6 +390,7 @@ ConferencePConfigPage::ConferencePConfigPage(PHTTPServiceProcess & app,const PSt
   s << ColumnItem(JsLocal("name_recall_last_template"));
   s << ColumnItem(JsLocal("lock_tpl_default"));
   s << ColumnItem(JsLocal("name_time_limit"));
+  s << ColumnItem(JsLocal("name_media_player"));
   optionNames.AppendString(RoomAutoCreateKey);
   optionNames.AppendString(RoomAutoCreateWhenConnectingKey);
   optionNames.AppendString(ForceSplitVideoKey);
@@ -395,6 +400,7 @@ ConferencePConfigPage::ConferencePConfigPage(PHTTPServiceProcess & app,const PSt
   optionNames.AppendString(RoomRecallLastTemplateKey);
   optionNames.AppendString(LockTemplateKey);
   optionNames.AppendString(RoomTimeLimitKey);
+  optionNames.AppendString(RoomMediaPlayerKey);
 
   sectionPrefix = "Conference ";
   PStringList sect = cfg.GetSectionsPrefix(sectionPrefix);
@@ -448,6 +454,8 @@ ConferencePConfigPage::ConferencePConfigPage(PHTTPServiceProcess & app,const PSt
     else            s << SelectItem(name, scfg.GetString(LockTemplateKey, ""), ",Enable,Disable");
     // time limit
     s << IntegerItem(name, scfg.GetString(RoomTimeLimitKey, ""), 0, 86400);
+    // media player, the file name is absolute or relative to the resource directory
+    s << StringItem(name, scfg.GetString(RoomMediaPlayerKey, ""));
   }
 
   s << EndTable();
@@ -709,6 +717,10 @@ VideoPConfigPage::VideoPConfigPage(PHTTPServiceProcess & app,const PString & tit
   int scaleFilterType = OpenMCU::Current().GetScaleFilterType();
   s << SelectField(VideoScaleFilterKey, VideoScaleFilterKey, OpenMCU::GetScaleFilterName(scaleFilterType), MCUScaleFilterNames);
 
+  s << IntegerField(KeyFrameRequestWindowKey, KeyFrameRequestWindowKey, cfg.GetInteger(KeyFrameRequestWindowKey, DefaultKeyFrameRequestWindow), 0, 5000, 0, "range: 0..5000 ms (requests from receivers of one encoder within the window are merged)");
+  s << IntegerField(KeyFrameMinIntervalKey, KeyFrameMinIntervalKey, cfg.GetInteger(KeyFrameMinIntervalKey, DefaultKeyFrameMinInterval), 0, 60000, 0, "range: 0..60000 ms (minimum interval between requested key frames)");
+  s << IntegerField(CodecThreadBudgetKey, CodecThreadBudgetKey, cfg.GetInteger(CodecThreadBudgetKey, 0), 0, 1024, 0, "range: 0..1024 (threads shared by all video encoders and decoders, 0 number of processors)");
+
   s << SeparatorField("H.263");
   s << IntegerField("H.263 Max Bit Rate", "H.263 "+JsLocal("max_bit_rate"), cfg.GetString("H.263 Max Bit Rate"), MCU_MIN_BIT_RATE/1000, MCU_MAX_BIT_RATE/1000, 0, "range "+PString(MCU_MIN_BIT_RATE/1000)+".."+PString(MCU_MAX_BIT_RATE/1000)+" kbit (for outgoing video, 0 disable)");
   s << IntegerField("H.263 Tx Key Frame Period", "H.263 "+JsLocal("tx_key_frame_period"), cfg.GetString("H.263 Tx Key Frame Period"), 0, 600, 0, "range 0..600 (for outgoing video, the number of pictures in a group of pictures, or 0 for intra_only)");
@@ -745,12 +757,18 @@ ExportPConfigPage::ExportPConfigPage(PHTTPServiceProcess & app,const PString & t
   s << BoolField("RESTORE DEFAULTS", JsLocal("restore_defaults"), FALSE);
 
   s << BoolField("Enable export", JsLocal("enable_export"), cfg.GetBoolean("Enable export", FALSE));
+#ifndef _WIN32
+  s << SelectField(ExportModeKey, JsLocal("export_mode"), cfg.GetString(ExportModeKey, ExportModePipe), PString(ExportModePipe)+","+ExportModeShm, 0, "shared memory: /dev/shm/openmcu_audio_ROOM, /dev/shm/openmcu_video_ROOM, ROOM_HASH for the room names with other characters than A-Z a-z 0-9 _ . -, see mcu_shm.h");
+#endif
   s << IntegerField(VideoFrameWidthKey, JsLocal("video_frame_width"), cfg.GetInteger(VideoFrameWidthKey, 704), 176, 1920);
   s << IntegerField(VideoFrameHeightKey, JsLocal("video_frame_height"), cfg.GetInteger(VideoFrameHeightKey, 576), 144, 1152);
   s << IntegerField(VideoFrameRateKey, JsLocal("video_frame_rate"), cfg.GetInteger(VideoFrameRateKey, 10), 1, 30);
   s << SelectField(AudioSampleRateKey, JsLocal("audio_sample_rate"), cfg.GetInteger(AudioSampleRateKey, 16000), "8000,16000,32000,48000");
   s << SelectField(AudioChannelsKey, JsLocal("audio_channels"), cfg.GetInteger(AudioChannelsKey, 1), "1,2,3,4,5,6,7,8");
 
+  s << BoolField(LiveStreamKey, JsLocal("live_streaming"), cfg.GetBoolean(LiveStreamKey, FALSE));
+  s << IntegerField(LiveSegmentDurationKey, JsLocal("live_segment_duration"), cfg.GetInteger(LiveSegmentDurationKey, STREAMER_SEGMENT_DEFAULT), 1, STREAMER_SEGMENT_MAX);
+
   s << EndTable();
   BuildHTML("");
   BeginPage(html_begin, "Export settings", "", "");
@@ -835,6 +853,7 @@ H323EndpointsPConfigPage::H323EndpointsPConfigPage(PHTTPServiceProcess & app,con
   optionNames.AppendString("H.323 call processing");
   optionNames.AppendString("Input Gain");
   optionNames.AppendString("Output Gain");
+  optionNames.AppendString(AudioDtxKey);
 
   optionNames.AppendString(HostKey);
   optionNames.AppendString(PortKey);
@@ -939,6 +958,7 @@ H323EndpointsPConfigPage::H323EndpointsPConfigPage(PHTTPServiceProcess & app,con
       s2 += RowArray()+JsLocal("internal_call_processing")+SelectItem(name, scfg.GetString("H.323 call processing", "direct"), "full,direct")+"</tr>";
       s2 += RowArray()+EmptyInputItem(name)+"</tr>";
       s2 += RowArray()+EmptyInputItem(name)+"</tr>";
+      s2 += RowArray()+JsLocal("audio_dtx")+SelectItem(name, scfg.GetString(AudioDtxKey, DisableKey), EnableSelect)+"</tr>";
       s2 += EndItemArray();
       s << s2;
     } else {
@@ -951,6 +971,7 @@ H323EndpointsPConfigPage::H323EndpointsPConfigPage(PHTTPServiceProcess & app,con
       s2 += RowArray()+JsLocal("internal_call_processing")+SelectItem(name, scfg.GetString("H.323 call processing", ""), ",full,direct")+"</tr>";
       s2 += RowArray(name, TRUE)+"Input Gain"+SelectItem(name, scfg.GetString("Input Gain"), ","+InputOutputGainSelect)+"</tr>";
       s2 += RowArray(name, TRUE)+"Output Gain"+SelectItem(name, scfg.GetString("Output Gain"), ","+InputOutputGainSelect)+"</tr>";
+      s2 += RowArray(name, TRUE)+JsLocal("audio_dtx")+SelectItem(name, scfg.GetString(AudioDtxKey), ","+EnableSelect)+"</tr>";
       s2 += EndItemArray();
       s << s2;
     }
@@ -1068,10 +1089,12 @@ RtspEndpointsPConfigPage::RtspEndpointsPConfigPage(PHTTPServiceProcess & app,con
   s << ColumnItem(JsLocal("name_user"));
   s << ColumnItem(JsLocal("name_password"));
   s << ColumnItem(JsLocal("name_display_name"));
+  s << ColumnItem(JsLocal("name_transport"));
 
   optionNames.AppendString(UserNameKey);
   optionNames.AppendString(PasswordKey);
   optionNames.AppendString(DisplayNameKey);
+  optionNames.AppendString(TransportKey);
 
   sectionPrefix = "RTSP Endpoint ";
   PStringList sect = cfg.GetSectionsPrefix(sectionPrefix);
@@ -1088,6 +1111,7 @@ RtspEndpointsPConfigPage::RtspEndpointsPConfigPage(PHTTPServiceProcess & app,con
     s << StringItem(name, scfg.GetString(UserNameKey), 120);
     s << StringItem(name, scfg.GetString(PasswordKey), 120);
     s << StringItem(name, scfg.GetString(DisplayNameKey), 120);
+    s << SelectItem(name, scfg.GetString(TransportKey), ",udp,tcp");
 
   }
   s << EndTable();
@@ -1125,6 +1149,7 @@ SipEndpointsPConfigPage::SipEndpointsPConfigPage(PHTTPServiceProcess & app,const
   optionNames.AppendString("SIP call processing");
   optionNames.AppendString("Input Gain");
   optionNames.AppendString("Output Gain");
+  optionNames.AppendString(AudioDtxKey);
 
   optionNames.AppendString(HostKey);
   optionNames.AppendString(PortKey);
@@ -1139,6 +1164,7 @@ SipEndpointsPConfigPage::SipEndpointsPConfigPage(PHTTPServiceProcess & app,const
   optionNames.AppendString(RTPInputTimeoutKey);
   optionNames.AppendString(VideoCacheKey);
   optionNames.AppendString(ReceivedVFUDelayKey);
+  optionNames.AppendString(VideoNackKey);
 
   optionNames.AppendString(AudioCodecKey);
   optionNames.AppendString(VideoCodecKey);
@@ -1238,6 +1264,7 @@ SipEndpointsPConfigPage::SipEndpointsPConfigPage(PHTTPServiceProcess & app,const
       s2 += RowArray()+JsLocal("internal_call_processing")+SelectItem(name, scfg.GetString("SIP call processing", "redirect"), "full,redirect")+"</tr>";
       s2 += RowArray()+EmptyInputItem(name)+"</tr>";
       s2 += RowArray()+EmptyInputItem(name)+"</tr>";
+      s2 += RowArray()+JsLocal("audio_dtx")+SelectItem(name, scfg.GetString(AudioDtxKey, DisableKey), EnableSelect)+"</tr>";
       s2 += EndItemArray();
       s << s2;
     } else {
@@ -1250,6 +1277,7 @@ SipEndpointsPConfigPage::SipEndpointsPConfigPage(PHTTPServiceProcess & app,const
       s2 += RowArray()+JsLocal("internal_call_processing")+SelectItem(name, scfg.GetString("SIP call processing", ""), ",full,redirect")+"</tr>";
       s2 += RowArray(name, TRUE)+"Input Gain"+SelectItem(name, scfg.GetString("Input Gain"), ","+InputOutputGainSelect)+"</tr>";
       s2 += RowArray(name, TRUE)+"Output Gain"+SelectItem(name, scfg.GetString("Output Gain"), ","+InputOutputGainSelect)+"</tr>";
+      s2 += RowArray(name, TRUE)+JsLocal("audio_dtx")+SelectItem(name, scfg.GetString(AudioDtxKey), ","+EnableSelect)+"</tr>";
       s2 += EndItemArray();
       s << s2;
     }
@@ -1300,6 +1328,9 @@ SipEndpointsPConfigPage::SipEndpointsPConfigPage(PHTTPServiceProcess & app,const
       // VFU delay
       if(name == "*") s2 += RowArray(name, TRUE)+JsLocal("received_vfu_delay")+SelectItem(name, scfg.GetString(ReceivedVFUDelayKey, DisableKey), ReceivedVFUDelaySelect, 70)+"</tr>";
       else            s2 += RowArray(name, TRUE)+JsLocal("received_vfu_delay")+SelectItem(name, scfg.GetString(ReceivedVFUDelayKey), ","+ReceivedVFUDelaySelect, 70)+"</tr>";
+      // NACK
+      if(name == "*") s2 += RowArray(name, TRUE)+JsLocal("video_nack")+SelectItem(name, scfg.GetString(VideoNackKey, DisableKey), EnableSelect, 70)+"</tr>";
+      else            s2 += RowArray(name, TRUE)+JsLocal("video_nack")+SelectItem(name, scfg.GetString(VideoNackKey), ","+EnableSelect, 70)+"</tr>";
       //
       s2 += EndItemArray();
       s << s2;
@@ -2474,6 +2505,89 @@ BOOL JpegFrameHTTP::OnGET (PHTTPServer & server, const PURL &url, const PMIMEInf
 
 ///////////////////////////////////////////////////////////////
 
+StreamHTTP::StreamHTTP(OpenMCU & _app, PHTTPAuthority & auth)
+  : PServiceHTTPString("Stream", "", "application/vnd.apple.mpegurl", auth),
+    app(_app)
+{
+}
+
+BOOL StreamHTTP::OnGET (PHTTPServer & server, const PURL &url, const PMIMEInfo & info, const PHTTPConnectionInfo & connectInfo)
+{
+  PHTTPRequest * req = CreateRequest(url, info, connectInfo.GetMultipartFormInfo(), server); // check authorization
+  if(!CheckAuthority(server, *req, connectInfo)) {delete req; return FALSE;}
+  delete req;
+
+  PString request=url.AsString();
+  PINDEX q;
+  if((q=request.Find("?"))==P_MAX_INDEX) return FALSE;
+
+  request=request.Mid(q+1,P_MAX_INDEX);
+  PStringToString data;
+  PURL::SplitQueryVars(request,data);
+
+  PString room=data("room"); if (room.GetLength()==0) return FALSE;
+
+  ConferenceManager *cm = app.GetConferenceManager();
+  Conference *conference = cm->FindConferenceWithLock(room);
+  if(conference == NULL)
+    return server.OnError(PHTTP::NotFound, room, connectInfo);
+
+  // the streamer member is captured, the conference is not locked while the streamer starts
+  ConferenceStreamer *streamer = NULL;
+  if(conference->conferenceStreamer)
+    streamer = (ConferenceStreamer *)conference->GetMemberList()((long)conference->conferenceStreamer->GetID());
+  conference->Unlock();
+  if(streamer == NULL)
+    return server.OnError(PHTTP::NotFound, room, connectInfo);
+  streamer->OnRequest();
+
+  BOOL result = FALSE;
+  PBYTEArray body;
+  PString contentType, cacheControl;
+  if(data.Contains("segment"))
+  {
+    // the segment does not change, the URL contains the streamer session
+    result = streamer->GetSegment(data("session"), data("segment").AsUnsigned(), body);
+    contentType = "video/mp2t";
+    cacheControl = "public, max-age=" + PString(STREAMER_SEGMENT_STORE * STREAMER_SEGMENT_MAX);
+  }
+  else
+  {
+    // the first client starts the streamer and waits for the first segment
+    PString playlist;
+    if(streamer->IsRunning() || streamer->Start())
+      result = (streamer->WaitSegment() && streamer->GetPlaylist(playlist, "Stream?room=" + PURL::TranslateString(room, PURL::QueryTranslation)));
+    body = PBYTEArray((const BYTE *)(const char *)playlist, playlist.GetLength());
+    contentType = "application/vnd.apple.mpegurl";
+    cacheControl = "no-cache";
+  }
+  streamer->Unlock();
+
+  if(!result)
+    return server.OnError(PHTTP::NotFound, room, connectInfo);
+
+  PTime now;
+  PStringStream message;
+  message << "HTTP/1.1 200 OK\r\n"
+          << "Date: " << now.AsString(PTime::RFC1123, PTime::GMT) << "\r\n"
+          << "Server: " << PRODUCT_NAME_TEXT << "\r\n"
+          << "MIME-Version: 1.0\r\n"
+          << "Cache-Control: " << cacheControl << "\r\n"
+          << "Access-Control-Allow-Origin: *\r\n"
+          << "Content-Type: " << contentType << "\r\n"
+          << "Content-Length: " << body.GetSize() << "\r\n"
+          << "Connection: Close\r\n"
+          << "\r\n";
+
+  server.Write((const char*)message,message.GetLength());
+  server.Write(body.GetPointer(),body.GetSize());
+  server.flush();
+
+  return TRUE;
+}
+
+///////////////////////////////////////////////////////////////
+
 InteractiveHTTP::InteractiveHTTP(OpenMCU & _app, PHTTPAuthority & auth)
   : PServiceHTTPString("Comm", "", "text/html; charset=utf-8", auth),
     app(_app)
@@ -2502,26 +2616,51 @@ BOOL InteractiveHTTP::OnGET (PHTTPServer & server, const PURL &url, const PMIMEI
 
   PString room=data("room");
 
+  // Server-Sent Events: "Accept: text/event-stream" or Comm?room=...&stream=sse
+  BOOL eventStream = (info("Accept").Find("text/event-stream") != P_MAX_INDEX || data("stream") == "sse");
+
+  // the history and the live events without duplicates
+  PString history;
+  MCUHttpSubscriber *subscriber = OpenMCU::Current().HttpSubscribe(room, history);
+  if(subscriber == NULL)
+  {
+    PTRACE(1,"WebCtrl\tComm flow rejected, too many subscribers");
+    return server.OnError(PHTTP::ServiceUnavailable, "Too many event subscribers", connectInfo);
+  }
+
   PStringStream message;
   PTime now;
-  int idx;
 
   message << "HTTP/1.1 200 OK\r\n"
           << "Date: " << now.AsString(PTime::RFC1123, PTime::GMT) << "\r\n"
           << "Server: " << PRODUCT_NAME_TEXT << "\r\n"
           << "MIME-Version: 1.0\r\n"
           << "Cache-Control: no-cache, must-revalidate\r\n"
-          << "Expires: Sat, 26 Jul 1997 05:00:00 GMT\r\n"
-          << "Content-Type: text/html;charset=utf-8\r\n"
-          << "Connection: Close\r\n"
+          << "Expires: Sat, 26 Jul 1997 05:00:00 GMT\r\n";
+  if(eventStream)
+    message << "Content-Type: text/event-stream;charset=utf-8\r\n";
+  else
+    message << "Content-Type: text/html;charset=utf-8\r\n";
+  message << "Connection: Close\r\n"
           << "\r\n";  //that's the last time we need to type \r\n instead of just \n
   server.Write((const char*)message,message.GetLength());
   server.flush();
 
   PTRACE(5,"WebCtrl\tComm flow headers sent");
 
+  if(eventStream)
+  {
+    message = "retry: 3000\n\n";
+    if(history != "")
+      message << InteractiveHTTP::EventStreamData(history);
+    InteractiveHTTP::EventStreamLoop(server, subscriber, message);
+    OpenMCU::Current().HttpUnsubscribe(subscriber);
+    PTRACE(5,"WebCtrl\tComm event stream stopped");
+    return FALSE;
+  }
+
   message="<html><body style='font-size:9px;font-family:Verdana,Arial;padding:0px;margin:1px;color:#000'><script>p=parent</script>\n";
-  message << OpenMCU::Current().HttpStartEventReading(idx,room);
+  message << history;
 
 //PTRACE(1,"!!!!!\tsha1('123')=" << PMessageDigestSHA1::Encode("123")); // sha1 works!! I'll try with websocket in future
 
@@ -2577,28 +2716,57 @@ BOOL InteractiveHTTP::OnGET (PHTTPServer & server, const PURL &url, const PMIMEI
     message << "<script>top.location.href='/';</script>\n";
     server.Write((const char*)message,message.GetLength());
     server.flush();
+    OpenMCU::Current().HttpUnsubscribe(subscriber);
     PTRACE(5,"WebCtrl\tComm flow not found, not locked, stopped");
     return FALSE;
   }
 
   PTRACE(5,"WebCtrl\tComm flow is ready");
 
+  // события приходят в очередь подписчика, опрос кольцевого буфера не нужен
+  std::deque<PString> events;
   while(server.Write((const char*)message,message.GetLength()))
   {
     server.flush();
-    int cnt=0;
-    message = OpenMCU::Current().HttpGetEvents(idx,room);
-    while (message.GetLength()==0 && cnt < 20)
+    message = "";
+    if(subscriber->Pop(events, 2000))
     {
-      cnt++;
-      MCUTime::Sleep(100);
-      message = OpenMCU::Current().HttpGetEvents(idx,room);
+      for(std::deque<PString>::iterator it = events.begin(); it != events.end(); ++it)
+        message << *it;
     }
     if(message.Find("<script>")==P_MAX_INDEX) message << "<script>p.alive()</script>\n";
   }
-  return FALSE;
 
+  OpenMCU::Current().HttpUnsubscribe(subscriber);
   PTRACE(5,"WebCtrl\tComm flow stopped");
+  return FALSE;
+}
+
+PString InteractiveHTTP::EventStreamData(const PString & evt)
+{
+  PStringStream result;
+  PStringArray lines = evt.Lines();
+  for(PINDEX i = 0; i < lines.GetSize(); ++i)
+    result << "data: " << lines[i] << "\n";
+  result << "\n";
+  return result;
+}
+
+void InteractiveHTTP::EventStreamLoop(PHTTPServer & server, MCUHttpSubscriber * subscriber, PString message)
+{
+  std::deque<PString> events;
+  while(server.Write((const char*)message,message.GetLength()))
+  {
+    server.flush();
+    message = "";
+    if(subscriber->Pop(events, 2000))
+    {
+      for(std::deque<PString>::iterator it = events.begin(); it != events.end(); ++it)
+        message += EventStreamData(*it);
+    }
+    else
+      message = ": alive\n\n";
+  }
 }
 
 ///////////////////////////////////////////////////////////////
@@ -2735,7 +2903,7 @@ BOOL SelectRoomPage::OnGET (PHTTPServer & server, const PURL &url, const PMIMEIn
       PString roomNumber = conference->GetNumber();
       //BOOL controlled = conference.GetForceScreenSplit();
       BOOL controlled = TRUE;
-      BOOL allowRecord = GetConferenceParam(roomNumber, RoomAllowRecordKey, TRUE);
+      BOOL allowRecord = MCUConfigSnapshot::GetConferenceConfig(roomNumber).allowRecord;
       BOOL moderated=FALSE; PString charModerated = "-";
       if(controlled) { charModerated = conference->IsModerated(); moderated=(charModerated=="+"); }
       if(charModerated=="-") charModerated = "<script type=\"text/javascript\">document.write(window.l_select_moderated_no);</script>";
@@ -962,11 +962,27 @@ class JpegFrameHTTP : public PServiceHTTPString
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// HLS live output: Stream?room=101 - playlist, Stream?room=101&segment=N - MPEG-TS segment
+class StreamHTTP : public PServiceHTTPString
+{
+  public:
+    StreamHTTP(OpenMCU & app, PHTTPAuthority & auth);
+    BOOL OnGET (PHTTPServer & server, const PURL &url, const PMIMEInfo & info, const PHTTPConnectionInfo & connectInfo);
+
+  private:
+    OpenMCU & app;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 class InteractiveHTTP : public PServiceHTTPString
 {
   public:
     InteractiveHTTP(OpenMCU & app, PHTTPAuthority & auth);
     BOOL OnGET (PHTTPServer & server, const PURL &url, const PMIMEInfo & info, const PHTTPConnectionInfo & connectInfo);
+  protected:
+    static PString EventStreamData(const PString & evt);
+    static void EventStreamLoop(PHTTPServer & server, MCUHttpSubscriber * subscriber, PString message);
   private:
     OpenMCU & app;
 };
@@ -69,6 +69,9 @@ OpenMCU::OpenMCU()
   httpBufferIndex = 0;
   httpBufferComplete = 0;
 
+  keyFrameRequestWindow = DefaultKeyFrameRequestWindow;
+  keyFrameMinInterval = DefaultKeyFrameMinInterval;
+
   uniqueMemberID = 1000;
 }
 
@@ -164,6 +167,8 @@ void OpenMCU::OnStop()
   delete manager;
   manager = NULL;
 
+  MCUConfigSnapshot::Clear();
+
 #ifndef _WIN32
   CommonDestruct(); // save config
 #endif
@@ -212,6 +217,9 @@ BOOL OpenMCU::Initialise(const char * initMsg)
   }
 #endif
 
+  // parsed copy of the configuration for the hot paths
+  MCUConfigSnapshot::Reload();
+
   MCUConfig cfg("Parameters");
 
   serverId = cfg.GetString(ServerIdKey, OpenMCU::Current().GetName() + " v" + OpenMCU::Current().GetVersion());
@@ -251,6 +259,13 @@ BOOL OpenMCU::Initialise(const char * initMsg)
 
 #endif
 
+  // key frame requests
+  keyFrameRequestWindow = MCUConfig("Video").GetInteger(KeyFrameRequestWindowKey, DefaultKeyFrameRequestWindow);
+  keyFrameMinInterval = MCUConfig("Video").GetInteger(KeyFrameMinIntervalKey, DefaultKeyFrameMinInterval);
+
+  // codec threads
+  codecThreadBudget.SetBudget(MCUConfig("Video").GetInteger(CodecThreadBudgetKey, 0));
+
 #if P_SSL
   // Secure HTTP
   BOOL enableSSL = cfg.GetBoolean(HTTPSecureKey, FALSE);
@@ -315,6 +330,7 @@ BOOL OpenMCU::Initialise(const char * initMsg)
   CreateHTTPResource("Select");
   CreateHTTPResource("Records");
   CreateHTTPResource("Jpeg");
+  CreateHTTPResource("Stream");
   CreateHTTPResource("Comm");
 
   CreateHTTPResource("welcome.html");
@@ -408,7 +424,8 @@ BOOL OpenMCU::Initialise(const char * initMsg)
     if(sect[i].Left(sectionPrefix.GetLength()) == sectionPrefix)
     {
       PString roomname = sect[i].Right(sect[i].GetLength()-sectionPrefix.GetLength());
-      if(GetConferenceParam(roomname, RoomAutoCreateKey, FALSE) && !GetConferenceParam(roomname, RoomAutoDeleteEmptyKey, FALSE))
+      MCUConferenceConfig config = MCUConfigSnapshot::GetConferenceConfig(roomname);
+      if(config.autoCreate && !config.autoDeleteEmpty)
       {
         Conference *conference = manager->MakeConferenceWithLock(roomname, "", TRUE);
         if(conference)
@@ -508,6 +525,8 @@ void OpenMCU::CreateHTTPResource(const PString & name)
     httpNameSpace.AddResource(new RecordsBrowserPage(*this, authConference), PHTTPSpace::Overwrite);
   else if(name == "Jpeg")
     httpNameSpace.AddResource(new JpegFrameHTTP(*this, authConference), PHTTPSpace::Overwrite);
+  else if(name == "Stream")
+    httpNameSpace.AddResource(new StreamHTTP(*this, authConference), PHTTPSpace::Overwrite);
   else if(name == "Comm")
     httpNameSpace.AddResource(new InteractiveHTTP(*this, authConference), PHTTPSpace::Overwrite);
 
@@ -636,6 +655,59 @@ void OpenMCU::LogMessageHTML(PString str)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+MCUHttpSubscriber * OpenMCU::HttpSubscribe(const PString & room, PString & history)
+{
+  MCUHttpSubscriber * subscriber = new MCUHttpSubscriber(room, httpBuffer);
+  // the history snapshot and the registration under the same lock as HttpWrite_
+  PWaitAndSignal m(httpBufferMutex);
+  if(httpSubscriberList.Insert(subscriber, (long)subscriber, room) == httpSubscriberList.end())
+  {
+    MCUTRACE(1, "WebCtrl\tToo many event subscribers, room " << room);
+    delete subscriber;
+    return NULL;
+  }
+  int idx;
+  history = HttpStartEventReading(idx, room);
+  return subscriber;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OpenMCU::HttpUnsubscribe(MCUHttpSubscriber * subscriber)
+{
+  MCUHttpSubscriberList::shared_iterator it = httpSubscriberList.Find(subscriber);
+  if(it != httpSubscriberList.end())
+  {
+    if(httpSubscriberList.Erase(it))
+      delete subscriber;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL OpenMCU::HttpHasSubscribers(const PString & room)
+{
+  for(MCUHttpSubscriberList::shared_iterator it = httpSubscriberList.begin(); it != httpSubscriberList.end(); ++it)
+  {
+    if(it->GetRoom() == "" || it->GetRoom() == room)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void OpenMCU::HttpPublish(const PString & evt, const PString & room)
+{
+  for(MCUHttpSubscriberList::shared_iterator it = httpSubscriberList.begin(); it != httpSubscriberList.end(); ++it)
+  {
+    if(room == "" || it->GetRoom() == "" || it->GetRoom() == room)
+      it->Push(evt);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 BOOL OpenMCU::MCUHTTPListenerCreate(const PString & ip, unsigned port)
 {
   if(httpListeningSocket)
@@ -892,19 +964,16 @@ BOOL OpenMCU::OTFControl(const PStringToString & data, PString & rdata)
   }
   if(action == OTFC_SHOW_REGISTRAR_ACCOUNTS)
   {
-    MCUJSON json(MCUJSON::JSON_ARRAY);
+    MCUJSONWriter json(!otfc_web, !otfc_web);
+    json.BeginArray();
     MCUAbookList & abookList = registrar->GetAbookList();
     for(MCUAbookList::shared_iterator it = abookList.begin(); it != abookList.end(); ++it)
     {
       if(it->is_account)
-        json.Insert(it->AsJSON());
+        it->AsJSON(json);
     }
-    std::string str;
-    if(otfc_web)
-      json.ToString(str, false, false);
-    else
-      json.ToString(str, true, true);
-    rdata = str;
+    json.End();
+    rdata = json.GetString();
     return TRUE;
   }
 
@@ -937,13 +1006,13 @@ BOOL OpenMCU::OTFControl(const PStringToString & data, PString & rdata)
 
   if(action == OTFC_ROOM_SHOW_MEMBERS)
   {
-    MCUJSON json(MCUJSON::JSON_ARRAY);
+    MCUJSONWriter json(true, true);
+    json.BeginArray();
     MCUMemberList & memberList = conference->GetMemberList();
     for(MCUMemberList::shared_iterator it = memberList.begin(); it != memberList.end(); ++it)
-      json.Insert(it->AsJSON());
-    std::string str;
-    json.ToString(str, true, true);
-    rdata = str;
+      it->AsJSON(json);
+    json.End();
+    rdata = json.GetString();
     return TRUE;
   }
   if(action == OTFC_REFRESH_VIDEO_MIXERS)
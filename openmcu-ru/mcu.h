@@ -73,6 +73,8 @@ static const char TelnetDefaultListener[]  = "*:1423";
 
 const unsigned int DefaultVideoFrameRate = 10;
 const unsigned int DefaultVideoQuality   = 10;
+const unsigned int DefaultKeyFrameRequestWindow = 100;  // ms
+const unsigned int DefaultKeyFrameMinInterval   = 1000; // ms
 
 static const char RecorderFfmpegDirKey[]   = "Video Recorder directory";
 static const char RecorderResolutionKey[] = "Video Recorder resolution";
@@ -84,6 +86,12 @@ static const char RecorderVideoCodecKey[]  = "Video Recorder video codec";
 static const char RecorderVideoResolutionKey[] = "Video Recorder video resolution";
 static const char RecorderAudioBitrateKey[] = "Video Recorder aduio bitrate";
 static const char RecorderVideoBitrateKey[] = "Video Recorder video bitrate";
+static const char RecorderRemuxKey[] = "Video Recorder remux cache";
+static const char RecorderSegmentKey[] = "Video Recorder segment duration";
+static const char RecorderWriteQueueKey[] = "Video Recorder write queue";
+static const char RecorderDirectIOKey[] = "Video Recorder direct I/O";
+static const char LiveStreamKey[] = "Live streaming";
+static const char LiveSegmentDurationKey[] = "Live segment duration";
 static const char RecorderDefaultAudioCodec[] = "ac3";
 static const char RecorderDefaultVideoCodec[] = "mpeg4";
 
@@ -92,6 +100,9 @@ static const char VideoFrameHeightKey[]       = "Video frame height";
 static const char VideoFrameRateKey[]         = "Video frame rate";
 static const char AudioSampleRateKey[]        = "Audio sample rate";
 static const char AudioChannelsKey[]          = "Audio channels";
+static const char ExportModeKey[]             = "Export mode";
+static const char ExportModePipe[]            = "Named pipe";
+static const char ExportModeShm[]             = "Shared memory";
 
 #ifdef RECORDS_DIR
 static const char DefaultRecordingDirectory[] = RECORDS_DIR;
@@ -115,6 +126,7 @@ static const char RoomAllowRecordKey[]          = "Allow record";
 static const char RoomRecallLastTemplateKey[]   = "Recall last template";
 static const char RoomTimeLimitKey[]            = "Room time limit";
 static const char LockTemplateKey[]             = "Template locks conference by default";
+static const char RoomMediaPlayerKey[]          = "Media player file";
 
 static PString InputOutputGainSelect            = "-20,-18,-16,-14,-12,-10,-8,-6,-4,-2,0,2,4,6,8,10,12,14,16,18,20,22,24,26,28,30,32,34,36,38,40,42,44,46,48,50,52,54,56,58,60";
 
@@ -183,18 +195,24 @@ static const char BandwidthFromKey[]       = "Bandwidth from MCU";
 static const char BandwidthToKey[]         = "Bandwidth to MCU";
 static const char FrameRateFromKey[]       = "Frame rate from MCU";
 static const char VideoCacheKey[]          = "Video cache";
+static const char VideoNackKey[]           = "Video NACK";
+static const char AudioDtxKey[]            = "Audio DTX";
 
 static const char OPTION_FRAME_TIME[] = "Frame Time";
 static const char OPTION_FRAME_RATE[] = "Frame Rate";
 static const char OPTION_FRAME_WIDTH[] = "Frame Width";
 static const char OPTION_FRAME_HEIGHT[] = "Frame Height";
 static const char OPTION_MAX_BIT_RATE[] = "Max Bit Rate";
+static const char OPTION_TARGET_BIT_RATE[] = "Target Bit Rate";
 static const char OPTION_ENCODER_QUALITY[] = "Encoding Quality";
 static const char OPTION_ENCODER_CHANNELS[] = "Encoder Channels";
 static const char OPTION_DECODER_CHANNELS[] = "Decoder Channels";
 static const char OPTION_TX_KEY_FRAME_PERIOD[] = "Tx Key Frame Period";
 
 static const char VideoScaleFilterKey[] = "Video scale filter";
+static const char KeyFrameRequestWindowKey[] = "Key frame request window";
+static const char KeyFrameMinIntervalKey[] = "Key frame min interval";
+static const char CodecThreadBudgetKey[] = "Codec thread budget";
 
 static PString MCUScaleFilterNames =
                                   "built-in"
@@ -348,6 +366,61 @@ class OpenMCUPreInit
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+class MCUHttpSubscriber
+{
+  public:
+    MCUHttpSubscriber(const PString & _room, PINDEX _maxEvents)
+      : room(_room), maxEvents(_maxEvents), dropped(0)
+    { }
+
+    const PString & GetRoom() const
+    { return room; }
+
+    PINDEX GetDropped() const
+    { return dropped; }
+
+    // очередь ограничена, медленный клиент теряет самые старые события
+    void Push(const PString & evt)
+    {
+      {
+        PWaitAndSignal m(mutex);
+        if((PINDEX)events.size() >= maxEvents)
+        {
+          events.pop_front();
+          dropped++;
+        }
+        events.push_back(evt);
+      }
+      eventsSync.Signal();
+    }
+
+    // ждать новых событий не дольше timeout мсек
+    BOOL Pop(std::deque<PString> & result, unsigned timeout)
+    {
+      mutex.Wait();
+      BOOL empty = events.empty();
+      mutex.Signal();
+      if(empty)
+        eventsSync.Wait(timeout);
+      PWaitAndSignal m(mutex);
+      if(events.empty())
+        return FALSE;
+      result.clear();
+      result.swap(events);
+      return TRUE;
+    }
+
+  protected:
+    PString room;
+    PINDEX maxEvents;
+    PINDEX dropped;
+    std::deque<PString> events;
+    PMutex mutex;
+    PSyncPoint eventsSync;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 class OpenMCU : public OpenMCUPreInit, public OpenMCUProcessAncestor
 {
   PCLASSINFO(OpenMCU, OpenMCUProcessAncestor)
@@ -402,36 +475,53 @@ class OpenMCU : public OpenMCUPreInit, public OpenMCUProcessAncestor
 
     int GetHttpBuffer() const { return httpBuffer; }
 
-    virtual void HttpWrite_(PString evt) {
-      httpBufferMutex.Wait();
-      httpBufferedEvents[httpBufferIndex]=evt; httpBufferIndex++;
+    // history of the log lines, sent to the new clients;
+    // stored and published under one lock with HttpSubscribe, the line is either in the history or live
+    virtual void HttpWrite_(PString evt, PString room) {
+      PWaitAndSignal m(httpBufferMutex);
+      if(room == "") httpBufferedEvents[httpBufferIndex]=evt+"<br>\n";
+      else httpBufferedEvents[httpBufferIndex]=room+"\t"+evt+"<br>\n";
+      httpBufferIndex++;
       if(httpBufferIndex>=httpBuffer){ httpBufferIndex=0; httpBufferComplete=1; }
-      httpBufferMutex.Signal();
+      HttpPublish(evt+"<br>\n", room);
     }
     virtual void HttpWriteEvent(PString evt) {
       PString evt0; PTime now;
       evt0 += now.AsString("h:mm:ss. ", PTime::Local) + evt;
-      HttpWrite_(evt0+"<br>\n");
+      HttpWrite_(evt0, "");
       if(copyWebLogToLog) LogMessageHTML(evt0);
     }
     virtual void HttpWriteEventRoom(PString evt, PString room){
       PString evt0; PTime now;
-      evt0 += room + "\t" + now.AsString("h:mm:ss. ", PTime::Local) + evt;
-      HttpWrite_(evt0+"<br>\n");
-      if(copyWebLogToLog) LogMessageHTML(evt0);
+      evt0 += now.AsString("h:mm:ss. ", PTime::Local) + evt;
+      HttpWrite_(evt0, room);
+      if(copyWebLogToLog) LogMessageHTML(room+"\t"+evt0);
     }
+    // commands are not stored in the history, only delivered to the subscribers of the room
     virtual void HttpWriteCmdRoom(PString evt, PString room){
       PStringStream evt0;
-      evt0 << room << "\t<script>p." << evt << "</script>\n";
-      HttpWrite_(evt0);
+      evt0 << "<script>p." << evt << "</script>\n";
+      HttpPublish(evt0, room);
+    }
+    virtual void HttpWriteCmdRoom(const PStringArray & cmds, PString room){
+      if(cmds.GetSize() == 0)
+        return;
+      PStringStream evt0;
+      evt0 << "<script>";
+      for(PINDEX i = 0; i < cmds.GetSize(); ++i)
+        evt0 << "p." << cmds[i] << ";";
+      evt0 << "</script>\n";
+      HttpPublish(evt0, room);
     }
     virtual void HttpWriteCmd(PString evt){
       PStringStream evt0;
       evt0 << "<script>p." << evt << "</script>\n";
-      HttpWrite_(evt0);
+      HttpPublish(evt0, "");
     }
-    virtual PString HttpGetEvents(int &idx, PString room){
+    // called with httpBufferMutex locked
+    virtual PString HttpStartEventReading(int &idx, PString room){
       PStringStream result;
+      if(httpBufferComplete){idx=httpBufferIndex+1; if(idx>=httpBuffer)idx=0;} else idx=0;
       while (idx!=httpBufferIndex){
         PINDEX pos=httpBufferedEvents[idx].Find("\t",0);
         if(pos==P_MAX_INDEX)result << httpBufferedEvents[idx];
@@ -442,21 +532,13 @@ class OpenMCU : public OpenMCUPreInit, public OpenMCUProcessAncestor
       }
       return result;
     }
-    virtual PString HttpStartEventReading(int &idx, PString room){
-      PStringStream result;
-      if(httpBufferComplete){idx=httpBufferIndex+1; if(idx>httpBuffer)idx=0;} else idx=0;
-      while (idx!=httpBufferIndex){
-        if(httpBufferedEvents[idx].Find("<script>",0)==P_MAX_INDEX){
-          PINDEX pos=httpBufferedEvents[idx].Find("\t",0);
-          if(pos==P_MAX_INDEX)result << httpBufferedEvents[idx];
-          else if(room=="")result << httpBufferedEvents[idx].Mid(pos+1,P_MAX_INDEX);
-          else if(httpBufferedEvents[idx].Left(pos)==room) result << httpBufferedEvents[idx].Mid(pos+1,P_MAX_INDEX);
-        }
-        idx++;
-        if(idx>=httpBuffer)idx=0;
-      }
-      return result;
-    }
+
+    // per-room push subscribers (Comm page, event-stream)
+    // NULL if the subscribers limit is reached
+    MCUHttpSubscriber * HttpSubscribe(const PString & room, PString & history);
+    void HttpUnsubscribe(MCUHttpSubscriber * subscriber);
+    BOOL HttpHasSubscribers(const PString & room);
+    void HttpPublish(const PString & evt, const PString & room);
 
     PString GetHtmlCopyright()
     {
@@ -497,6 +579,18 @@ class OpenMCU : public OpenMCUPreInit, public OpenMCUProcessAncestor
       return scaleFilterType;
     }
 
+    unsigned GetKeyFrameRequestWindow() const
+    { return keyFrameRequestWindow; }
+
+    unsigned GetKeyFrameMinInterval() const
+    { return keyFrameMinInterval; }
+
+    MCUCodecThreadBudget & GetCodecThreadBudget()
+    { return codecThreadBudget; }
+
+    MCUOverloadController & GetOverloadController()
+    { return overloadController; }
+
     static PINDEX GetScaleFilterType(const PString & name)
     {
       return MCUScaleFilterNames.Tokenise(",").GetStringsIndex(name);
@@ -635,11 +729,16 @@ class OpenMCU : public OpenMCUPreInit, public OpenMCUProcessAncestor
     BOOL       httpBufferComplete;
 
     PMutex     httpBufferMutex;
+    MCUHttpSubscriberList httpSubscriberList;
     PMutex otfcMutex;
 
 #if MCU_VIDEO
     int scaleFilterType;
 #endif
+    unsigned keyFrameRequestWindow;
+    unsigned keyFrameMinInterval;
+    MCUCodecThreadBudget codecThreadBudget;
+    MCUOverloadController overloadController;
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
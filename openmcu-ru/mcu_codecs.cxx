@@ -17,6 +17,8 @@ extern "C" {
 MCUFramedAudioCodec::MCUFramedAudioCodec(const OpalMediaFormat & fmt, Direction direction, PluginCodec_Definition * _codec)
   : H323AudioCodec(fmt, direction), codec(_codec)
 {
+  silenceLevel = -1;
+
   if(codec != NULL && codec->createCodec != NULL)
     context = (*codec->createCodec)(codec);
   else
@@ -351,6 +353,15 @@ BOOL MCUFramedAudioCodec::Write(const BYTE * buffer, unsigned length, const RTP_
   unsigned bytesDecoded = samplesPerFrame * channels * 2;
   PTRACE(9,"MCUFramedAudioCodec\tWrite: length " << length << ", channels " << channels << ", samplesPerFrame " << samplesPerFrame << ", bytesDecoded " << bytesDecoded);
 
+  // Без голоса: не декодировать и не микшировать, только уровень для VAD
+  if(length != 0 && silenceLevel >= 0 && rawDataChannel != NULL && PIsDescendant(rawDataChannel, IncomingAudio))
+  {
+    written = (length > bytesPerFrame) ? bytesPerFrame : length;
+    if(IsRawDataHeld)
+      return TRUE;
+    return ((IncomingAudio *)rawDataChannel)->WriteSilence(bytesDecoded, silenceLevel);
+  }
+
   if(length != 0)
   {
     if(length > bytesPerFrame)
@@ -709,6 +720,72 @@ short MCUStreamedAudioCodec::Decode(int sample) const
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+MCUCodecThreadBudget::MCUCodecThreadBudget()
+{
+  budget = 0;
+  used = 0;
+  SetBudget(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUCodecThreadBudget::SetBudget(unsigned threads)
+{
+  PWaitAndSignal m(mutex);
+  if(threads == 0)
+  {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    threads = info.dwNumberOfProcessors;
+#else
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = (cpus > 0 ? cpus : 1);
+#endif
+  }
+  budget = threads;
+  PTRACE(3, "MCUCodecThreadBudget\tBudget " << budget << " threads, used " << used);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned MCUCodecThreadBudget::Acquire(unsigned width, unsigned height)
+{
+  PWaitAndSignal m(mutex);
+  unsigned pixels = width * height;
+  unsigned threads = CODEC_THREADS_MAX;
+  if(pixels <= CODEC_THREADS_SD_PIXELS)
+    threads = 1;
+  else if(pixels <= CODEC_THREADS_HD_PIXELS)
+    threads = 2;
+
+  // при нехватке остаток запаса, кодек всегда работает хотя бы в одном потоке
+  unsigned available = (budget > used ? budget - used : 0);
+  if(threads > available)
+    threads = PMAX(available, 1);
+
+  used += threads;
+  return threads;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUCodecThreadBudget::Reserve(unsigned threads)
+{
+  PWaitAndSignal m(mutex);
+  used += threads;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUCodecThreadBudget::Release(unsigned threads)
+{
+  PWaitAndSignal m(mutex);
+  used = (used > threads ? used - threads : 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 MCUVideoCodec::MCUVideoCodec(const OpalMediaFormat & fmt, Direction direction, PluginCodec_Definition * _codec)
   : H323VideoCodec(fmt, direction), codec(_codec)
 {
@@ -726,6 +803,10 @@ MCUVideoCodec::MCUVideoCodec(const OpalMediaFormat & fmt, Direction direction, P
   lastFrameTimeRTP = 0;
   sendIntra = true;
   converter = NULL;
+  maxBitRate = 0;
+  targetBitRate = 0;
+  appliedBitRate = 0;
+  codecThreads = 0;
 
   // Need to allocate buffer to the maximum framesize statically
   // and clear the memory in the destructor to avoid segfault in destructor
@@ -772,6 +853,8 @@ MCUVideoCodec::MCUVideoCodec(const OpalMediaFormat & fmt, Direction direction, P
   mediaFormat.SetOptionInteger(OPTION_FRAME_WIDTH, frameWidth);
   mediaFormat.SetOptionInteger(OPTION_FRAME_HEIGHT, frameHeight);
 
+  maxBitRate = mediaFormat.GetOptionInteger(OPTION_MAX_BIT_RATE);
+
 #if PTRACING
   PTRACE(6,"Codec Options");
   OpalMediaFormat::DebugOptionList(mediaFormat);
@@ -794,6 +877,62 @@ MCUVideoCodec::~MCUVideoCodec()
 
   if(converter != NULL)
     delete converter;
+
+  OpenMCU::Current().GetCodecThreadBudget().Release(codecThreads);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUVideoCodec::SetThreads(unsigned threads)
+{
+  PWaitAndSignal mutex(videoHandlerActive);
+
+  MCUCodecThreadBudget & threadBudget = OpenMCU::Current().GetCodecThreadBudget();
+  threadBudget.Release(codecThreads);
+  if(threads == 0)
+  {
+    // один раз при открытии канала по согласованному размеру, у декодера H.264
+    // смена числа потоков пересоздает контекст и теряет кадры до следующего IDR
+    codecThreads = threadBudget.Acquire(mediaFormat.GetOptionInteger(OpalVideoFormat::FrameWidthOption, frameWidth),
+                                        mediaFormat.GetOptionInteger(OpalVideoFormat::FrameHeightOption, frameHeight));
+  }
+  else
+  {
+    threadBudget.Reserve(threads);
+    codecThreads = threads;
+  }
+
+  if(codec == NULL || context == NULL)
+    return;
+
+  PluginCodec_ControlDefn * ctl = GetCodecControl(codec, SET_CODEC_OPTIONS_CONTROL);
+  if(ctl == NULL)
+    return;
+
+  // сохраняется в формате, опции передаются повторно при смене битрейта
+  PString threadsOption = (direction == Encoder) ? OPTION_ENCODING_THREADS : OPTION_DECODING_THREADS;
+  mediaFormat.SetOptionInteger(threadsOption, codecThreads);
+
+  // полный список опций, часть кодеков сбрасывает отсутствующие (профиль H.264)
+  PStringArray list;
+  for(PINDEX i = 0; i < mediaFormat.GetOptionCount(); i++)
+  {
+    const OpalMediaOption & option = mediaFormat.GetOption(i);
+    list += option.GetName();
+    list += option.AsString();
+  }
+  if(!mediaFormat.HasOption(threadsOption))
+  {
+    list += threadsOption;
+    list += PString(codecThreads);
+  }
+  char ** _options = list.ToCharArray();
+  unsigned int optionsLen = sizeof(_options);
+  (*ctl->control)(codec, context, SET_CODEC_OPTIONS_CONTROL, _options, &optionsLen);
+  free(_options);
+
+  PTRACE(3, "MCUVideoCodec\t" << mediaFormat << " " << frameWidth << "x" << frameHeight << " threads " << codecThreads
+            << ", used " << threadBudget.GetUsed() << "/" << threadBudget.GetBudget());
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -837,6 +976,10 @@ BOOL MCUVideoCodec::Read(BYTE * buffer, unsigned & length, RTP_DataFrame & dst,
 
   if(lastPacketSent)
   {
+    // новый кадр, можно менять битрейт
+    if(targetBitRate != appliedBitRate)
+      ApplyTargetBitRate();
+
     videoIn->RestrictAccess();
 
     if(!videoIn->IsGrabberOpen())
@@ -918,6 +1061,68 @@ BOOL MCUVideoCodec::Read(BYTE * buffer, unsigned & length, RTP_DataFrame & dst,
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void MCUVideoCodec::ApplyTargetBitRate()
+{
+  if(codec == NULL || context == NULL)
+    return;
+
+  unsigned bitRate = targetBitRate;
+  if(bitRate == 0 || bitRate > maxBitRate)
+    bitRate = maxBitRate;
+  if(bitRate == 0 || bitRate == appliedBitRate)
+    return;
+  if(appliedBitRate == 0)
+    appliedBitRate = maxBitRate;
+
+  // изменения меньше 5% не применяются, кроме возврата к максимуму
+  unsigned delta = (bitRate > appliedBitRate ? bitRate - appliedBitRate : appliedBitRate - bitRate);
+  if(bitRate != maxBitRate && delta * 20 < appliedBitRate)
+    return;
+
+  // только битрейт, кодер не переоткрывается и не формирует ключевой кадр (x264 reconfig)
+  PluginCodec_ControlDefn * ctl = GetCodecControl(codec, SET_CODEC_BIT_RATE_CONTROL);
+  if(ctl != NULL)
+  {
+    unsigned parm = bitRate;
+    unsigned int parmLen = sizeof(parm);
+    if((*ctl->control)(codec, context, SET_CODEC_BIT_RATE_CONTROL, &parm, &parmLen) == 0)
+      PTRACE(3, "MCUVideoCodec\t" << mediaFormat << " failed to set bit rate " << bitRate);
+    else
+      PTRACE(3, "MCUVideoCodec\t" << mediaFormat << " target bit rate " << appliedBitRate << " -> " << bitRate);
+    appliedBitRate = bitRate;
+    return;
+  }
+
+  // остальные кодеки переоткрываются при set_codec_options (H.263, MPEG4) - ключевой кадр на каждое изменение,
+  // VP8 меняет настройки на месте
+  if(GetPluginName(mediaFormat) != "VP8")
+    return;
+  ctl = GetCodecControl(codec, SET_CODEC_OPTIONS_CONTROL);
+  if(ctl == NULL)
+    return;
+
+  // полный список опций, часть кодеков сбрасывает отсутствующие
+  PStringArray list;
+  for(PINDEX i = 0; i < mediaFormat.GetOptionCount(); i++)
+  {
+    const OpalMediaOption & option = mediaFormat.GetOption(i);
+    list += option.GetName();
+    if(option.GetName() == OPTION_MAX_BIT_RATE || option.GetName() == OPTION_TARGET_BIT_RATE)
+      list += PString(bitRate);
+    else
+      list += option.AsString();
+  }
+  char ** _options = list.ToCharArray();
+  unsigned int optionsLen = sizeof(_options);
+  (*ctl->control)(codec, context, SET_CODEC_OPTIONS_CONTROL, _options, &optionsLen);
+  free(_options);
+
+  PTRACE(3, "MCUVideoCodec	" << mediaFormat << " target bit rate " << appliedBitRate << " -> " << bitRate);
+  appliedBitRate = bitRate;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 BOOL MCUVideoCodec::Write(const BYTE * buffer, unsigned length, const RTP_DataFrame & src, unsigned & written)
 {
   PWaitAndSignal mutex(videoHandlerActive);
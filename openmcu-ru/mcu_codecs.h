@@ -12,8 +12,16 @@ static const char GET_CODEC_OPTIONS_CONTROL[]    = "get_codec_options";
 static const char FREE_CODEC_OPTIONS_CONTROL[]   = "free_codec_options";
 static const char GET_OUTPUT_DATA_SIZE_CONTROL[] = "get_output_data_size";
 static const char SET_CODEC_OPTIONS_CONTROL[]    = "set_codec_options";
+static const char SET_CODEC_BIT_RATE_CONTROL[]   = "set_bit_rate"; // bit/s, without reopening the encoder
 static const char EVENT_CODEC_CONTROL[]          = "event_codec";
 
+static const char OPTION_ENCODING_THREADS[] = "Encoding Threads";
+static const char OPTION_DECODING_THREADS[] = "Decoding Threads";
+
+#define CODEC_THREADS_SD_PIXELS 230400 // 640x360 и меньше - один поток
+#define CODEC_THREADS_HD_PIXELS 921600 // 1280x720 и меньше - два потока
+#define CODEC_THREADS_MAX       4
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 inline static BOOL CallCodecControl(PluginCodec_Definition * defn, void * context, const char * name, void * parm, unsigned int * parmLen, int & retVal)
@@ -232,9 +240,14 @@ class MCUFramedAudioCodec : public H323AudioCodec
     MCU_RTPChannel * GetLogicalChannel()
     { return (MCU_RTPChannel *)logicalChannel; }
 
+    // уровень пакета без голоса в -dBov (RFC 6464), -1 - декодировать
+    void SetSilenceLevel(int level)
+    { silenceLevel = level; }
+
   protected:
     void * context;
     PluginCodec_Definition * codec;
+    int silenceLevel;
 
     PShortArray sampleBuffer;
     unsigned bytesPerFrame;
@@ -261,6 +274,34 @@ class MCUStreamedAudioCodec : public MCUFramedAudioCodec
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Общий запас потоков видеокодеков процесса. Кодеры и декодеры получают
+// потоки по размеру кадра, пока запас не исчерпан, затем по одному потоку.
+class MCUCodecThreadBudget
+{
+  public:
+    MCUCodecThreadBudget();
+
+    // 0 - по числу процессоров
+    void SetBudget(unsigned threads);
+
+    unsigned GetBudget() const
+    { return budget; }
+
+    unsigned GetUsed() const
+    { return used; }
+
+    unsigned Acquire(unsigned width, unsigned height);
+    void Reserve(unsigned threads);
+    void Release(unsigned threads);
+
+  protected:
+    PMutex mutex;
+    unsigned budget;
+    unsigned used;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 class MCUVideoCodec : public H323VideoCodec
 {
   PCLASSINFO(MCUVideoCodec, H323VideoCodec);
@@ -285,12 +326,27 @@ class MCUVideoCodec : public H323VideoCodec
 
     BOOL RenderFrame(const BYTE * buffer);
 
+    // битрейт по оценке получателей, 0 - согласованный максимум
+    // применяется в Read, в потоке кодера
+    void SetTargetBitRate(unsigned bitRate)
+    { targetBitRate = bitRate; }
+
+    unsigned GetTargetBitRate() const
+    { return appliedBitRate; }
+
     MCU_RTPChannel * GetLogicalChannel()
     { return (MCU_RTPChannel *)logicalChannel; }
 
+    // потоки кодека из общего запаса, 0 - по размеру кадра
+    void SetThreads(unsigned threads);
+
+    unsigned GetThreads() const
+    { return codecThreads; }
+
   protected:
     void * context;
     PluginCodec_Definition * codec;
+    unsigned codecThreads;
 
     RTP_DataFrame bufferRTP;
     PColourConverter * converter;
@@ -303,6 +359,11 @@ class MCUVideoCodec : public H323VideoCodec
     bool         sendIntra;
     bool         lastPacketSent;
 
+    void ApplyTargetBitRate();
+    unsigned     maxBitRate;
+    volatile unsigned targetBitRate;
+    unsigned     appliedBitRate;
+
     mutable PTimeInterval lastFrameTick;
 };
 
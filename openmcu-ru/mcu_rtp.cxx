@@ -21,9 +21,16 @@ MCU_RTPChannel::MCU_RTPChannel(H323Connection & conn, const H323Capability & cap
   intraRefreshPeriod = 0;
   intraRequestPeriod = 0;
 
+  cnPayloadType = -1;
+  cnTime = 0;
+
   cache = NULL;
   cacheMode = -1;
   encoderSeqN = 0;
+
+  rtxHistory = NULL;
+  rtxOwnHistory = NULL;
+  rtxHistoryN = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -37,6 +44,8 @@ MCU_RTPChannel::~MCU_RTPChannel()
     codec = NULL;
     avcodecMutex.Signal();
   }
+  if(rtxOwnHistory)
+    delete rtxOwnHistory;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -136,6 +145,10 @@ void MCU_RTPChannel::CleanUpOnTermination()
 
 void MCU_RTPChannel::OnFlowControl(long bitRateRestriction)
 {
+  // H.245 FlowControlCommand, единицы 100 бит/с
+  if(!isAudio && !receiver && bitRateRestriction > 0)
+    ((MCU_RTP_UDP &)rtpSession).GetBandwidthEstimator().OnReceiverEstimate(bitRateRestriction * 100);
+
   if(GetCodec() != NULL)
     codec->OnFlowControl(bitRateRestriction);
   else
@@ -187,9 +200,23 @@ BOOL MCU_RTPChannel::WriteFrame(RTP_DataFrame & frame)
 {
   MCU_RTP_UDP & session = (MCU_RTP_UDP &)rtpSession;
 
+  if(rtxHistory != NULL && rtxHistory == rtxOwnHistory)
+    rtxHistoryN = rtxOwnHistory->Put(frame);
+
+  // повторная передача пакетов запрошенных по NACK, вне очереди
+  if(rtxHistory != NULL && !session.SendRetransmissions())
+    goto error;
+
+  if(!isAudio)
+    session.GetPacer().Wait(frame.GetHeaderSize() + frame.GetPayloadSize());
+
   if(!session.PreWriteData(frame))
     goto error;
 
+  // номер последовательности назначен в PreWriteData
+  if(rtxHistory != NULL)
+    session.OnSentPacket(frame, rtxHistory, rtxHistoryN);
+
   if(!session.WriteData(frame))
     goto error;
 
@@ -208,6 +235,62 @@ BOOL MCU_RTPChannel::WriteFrame(RTP_DataFrame & frame)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+BOOL MCU_RTPChannel::WriteComfortNoise(DWORD rtpTimestamp)
+{
+  cnTime = MCUTime::GetMonoTimestampUsec();
+
+  // уровень шума в -dBov по последнему кадру, без параметров спектра
+  int level = 127;
+  if(PIsDescendant(codec, MCUFramedAudioCodec))
+  {
+    unsigned signal = ((MCUFramedAudioCodec *)codec)->GetAverageSignalLevel();
+    if(signal > 0 && signal < 32768)
+      level = PMIN(127, (int)(-20 * log10(signal / 32767.0)));
+  }
+
+  RTP_DataFrame frame(1);
+  frame.SetMinSize(frame.GetSize() + RTP_SECURE_HEADROOM);
+  frame.SetPayloadType((RTP_DataFrame::PayloadTypes)cnPayloadType);
+  frame.SetTimestamp(rtpTimestamp);
+  frame.GetPayloadPtr()[0] = (BYTE)level;
+
+  return WriteFrame(frame);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCU_RTPChannel::OnFastUpdatePicture(const PString & source)
+{
+  // запрос получателя, потери которого восстанавливаются по NACK, может быть отложен
+  bool recoverable = (!source.IsEmpty() && ((MCU_RTP_UDP &)rtpSession).IsRecovering());
+  if(cache)
+    cache->OnFastUpdatePicture(source, recoverable);
+  else
+    keyFrameArbiter.Request(source, recoverable);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCU_RTPChannel::SetRetransmitHistory(bool fromCache, unsigned historyN)
+{
+  if(fromCache)
+  {
+    // общая история кэша
+    rtxHistory = cache->GetHistory();
+    rtxHistoryN = historyN;
+  }
+  else
+  {
+    // собственная история, пакет сохраняется в WriteFrame
+    if(rtxOwnHistory == NULL)
+      rtxOwnHistory = new MCURtpHistory();
+    rtxHistory = rtxOwnHistory;
+    rtxHistoryN = 0;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void MCU_RTPChannel::SetFreeze(bool enable)
 {
   if(receiver)
@@ -270,6 +353,9 @@ void MCU_RTPChannel::Receive()
   // do not change payload type for audio and video
   BOOL allowRtpPayloadChange = FALSE;
 
+  MCUFramedAudioCodec * audioCodec = ((isAudio && PIsDescendant(codec, MCUFramedAudioCodec)) ? (MCUFramedAudioCodec *)codec : NULL);
+  uint64_t voiceTime = 0;
+
   MCU_RTP_DataFrame frame;
   while(1)
   {
@@ -280,6 +366,19 @@ void MCU_RTPChannel::Receive()
     if(!ReadFrame(rtpTimestamp, frame))
       break;
 
+    // уровень звука от терминала, пакеты без голоса не декодируются
+    int audioLevel = -1;
+    if(frame.GetExtension())
+      audioLevel = ReadHeaderExtension(frame);
+    if(audioCodec)
+    {
+      uint64_t now = MCUTime::GetMonoTimestampUsec();
+      if(audioLevel >= 0 && audioLevel < RTP_AUDIO_LEVEL_SILENCE)
+        voiceTime = now;
+      bool silent = (audioLevel >= RTP_AUDIO_LEVEL_SILENCE && now - voiceTime > RTP_AUDIO_LEVEL_HANGOVER);
+      audioCodec->SetSilenceLevel(silent ? audioLevel : -1);
+    }
+
     filterMutex.Wait();
     for(PINDEX i = 0; i < filters.GetSize(); i++)
       filters[i](frame, 0);
@@ -356,6 +455,54 @@ void MCU_RTPChannel::Receive()
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+int MCU_RTPChannel::ReadHeaderExtension(RTP_DataFrame & frame)
+{
+  // GetHeaderSize() учитывает длину расширения в байтах, а не в 32-битных словах,
+  // сумма заголовка и нагрузки равна размеру пакета
+  PINDEX total = frame.GetHeaderSize() + frame.GetPayloadSize();
+  PINDEX offset = RTP_DataFrame::MinHeaderSize + 4*frame.GetContribSrcCount();
+  PINDEX extSize = 4*frame.GetExtensionSize();
+  PINDEX headerSize = offset + 4 + extSize;
+  if(headerSize > total)
+  {
+    PTRACE(2, "MCU_RTPChannel\tInvalid header extension size " << extSize << ", packet " << total);
+    frame.SetPayloadSize(0);
+    return -1;
+  }
+
+  int level = -1;
+  int id = ((MCU_RTP_UDP &)rtpSession).GetAudioLevelId();
+  if(id > 0 && frame.GetExtensionType() == 0xBEDE)
+  {
+    // one-byte header: ID(4) L(4) data(L+1), 0 - выравнивание
+    const BYTE * ext = frame.GetExtensionPtr();
+    PINDEX i = 0;
+    while(i < extSize)
+    {
+      if(ext[i] == 0)
+      {
+        i++;
+        continue;
+      }
+      int elementId = ext[i] >> 4;
+      PINDEX len = (ext[i] & 0x0f) + 1;
+      if(elementId == 15)
+        break;
+      if(elementId == id && i + 1 < extSize)
+        level = ext[i + 1] & 0x7f;
+      i += 1 + len;
+    }
+  }
+
+  BYTE * ptr = frame.GetPointer();
+  memmove(ptr + offset, ptr + headerSize, total - headerSize);
+  frame.SetExtension(FALSE);
+  frame.SetPayloadSize(total - headerSize);
+  return level;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 #if PTRACING
 class CodecReadAnalyser
 {
@@ -420,6 +567,8 @@ void MCU_RTPChannel::Transmit()
   if(maxFrameSize == 0)
     maxFrameSize = isAudio ? 8 : 2000;
   MCU_RTP_DataFrame frame(framesInPacket * maxFrameSize);
+  // запас под трейлер SRTP/ZRTP, шифрование на месте без перераспределения
+  frame.SetMinSize(frame.GetSize() + RTP_SECURE_HEADROOM);
 
   if(rtpPayloadType == RTP_DataFrame::IllegalPayloadType)
   {
@@ -456,13 +605,27 @@ void MCU_RTPChannel::Transmit()
   if(!isAudio)
     preVideoFrames = TRUE;
 
+  MCU_RTP_UDP & session = (MCU_RTP_UDP &)rtpSession;
+  bool nack = (!isAudio && session.IsNackEnabled());
+  MCUVideoCodec * videoCodec = ((!isAudio && PIsDescendant(codec, MCUVideoCodec)) ? (MCUVideoCodec *)codec : NULL);
+  uint64_t bitRateTime = 0;
+  if(!isAudio)
+    session.GetBandwidthEstimator().SetMaxBitRate(mediaFormat.GetOptionInteger(OPTION_MAX_BIT_RATE));
+
   while(1)
   {
     BOOL retval = FALSE;
+    bool fromCache = false;
+    unsigned historyN = 0;
 
     // setup cache
     if(cacheMode == 2 && (cache == NULL || cache->GetName() != cacheName))
     {
+      // история старого кэша больше недоступна
+      session.ResetRetransmissions();
+      rtxHistory = NULL;
+      if(cache)
+        cache->SetReaderBitRate(this, 0);
       DetachCacheRTP(cache);
       while(!AttachCacheRTP(cache, cacheName, encoderSeqN))
         MCUTime::Sleep(100);
@@ -473,10 +636,42 @@ void MCU_RTPChannel::Transmit()
     if(!isAudio && intraRefreshPeriod > 0 && rtpSession.GetPacketsSent() % intraRefreshPeriod == 0)
       OnFastUpdatePicture();
 
+    // PLI/FIR
+    if(!isAudio && session.GetPictureLoss())
+      OnFastUpdatePicture(((MCUH323Connection &)connection).GetMemberName());
+
+    // оценка пропускной способности, для кэша выбирается минимальная по получателям
+    if(!isAudio && MCUTime::GetMonoTimestampUsec() - bitRateTime >= RTP_BWE_APPLY_INTERVAL)
+    {
+      bitRateTime = MCUTime::GetMonoTimestampUsec();
+      unsigned bitRate = session.GetBandwidthEstimator().GetBitRate();
+      if(cache)
+        cache->SetReaderBitRate(this, bitRate);
+      else if(videoCodec)
+        videoCodec->SetTargetBitRate(bitRate);
+      // пакеты кадра распределяются по времени, а не уходят пачкой
+      unsigned pacerBitRate = bitRate;
+      if(pacerBitRate == 0)
+        pacerBitRate = mediaFormat.GetOptionInteger(OPTION_MAX_BIT_RATE);
+      if(pacerBitRate == 0)
+        pacerBitRate = RTP_PACER_BITRATE;
+      session.GetPacer().SetRate(RTP_PACER_FACTOR * pacerBitRate, RTP_PACER_BURST, RTP_PACER_MAX_DELAY);
+    }
+
     // read frame
     if(cacheMode < 2 || encoderSeqN == 0xFFFFFFFF)
     {
-      retval = codec->Read(frame.GetPayloadPtr() + frameOffset, length, frame);
+      if(!isAudio && keyFrameArbiter.Check())
+        ((H323VideoCodec *)codec)->OnFastUpdatePicture();
+      if(videoCodec)
+      {
+        flags = 0;
+        retval = videoCodec->Read(frame.GetPayloadPtr() + frameOffset, length, frame, flags);
+        if((flags & PluginCodec_ReturnCoderIFrame) && (flags & PluginCodec_ReturnCoderLastFrame))
+          keyFrameArbiter.OnKeyFrame();
+      }
+      else
+        retval = codec->Read(frame.GetPayloadPtr() + frameOffset, length, frame);
     }
     else if(cacheMode == 2)
     {
@@ -485,17 +680,18 @@ void MCU_RTPChannel::Transmit()
         if((PTimer::Tick()-firstFrameTick).GetInterval() > 2000 && frame.GetMarker())
         {
           preVideoFrames = FALSE;
-          encoderSeqN = cache->GetLastFrameNum();
+          encoderSeqN = cache->GetStartFrameNum();
           OnFastUpdatePicture();
           while(1)
           {
             flags = 0;
-            retval = GetCacheRTP(cache, frame, length, encoderSeqN, flags);
+            retval = GetCacheRTP(cache, frame, length, encoderSeqN, flags, &historyN);
             if(flags & PluginCodec_ReturnCoderIFrame)
               break;
             if(terminating)
               break;
           }
+          fromCache = true;
         }
         else
           retval = codec->Read(frame.GetPayloadPtr() + frameOffset, length, frame);
@@ -503,13 +699,17 @@ void MCU_RTPChannel::Transmit()
       else
       {
         flags = 0;
-        retval = GetCacheRTP(cache, frame, length, encoderSeqN, flags);
+        retval = GetCacheRTP(cache, frame, length, encoderSeqN, flags, &historyN);
+        fromCache = true;
       }
     }
 
     if(retval == FALSE)
       break;
 
+    if(nack)
+      SetRetransmitHistory(fromCache, historyN);
+
     // ???
     if(freezeWrite)
       length = 0;
@@ -524,6 +724,7 @@ void MCU_RTPChannel::Transmit()
       if(silent && length > 0)
       {
         silent = FALSE;
+        cnTime = 0;
         frame.SetMarker(TRUE);  // Set flag for start of sound
         PTRACE(3, "MCU_RTPChannel\tTransmit start of talk burst: " << rtpTimestamp);
       }
@@ -595,9 +796,6 @@ void MCU_RTPChannel::Transmit()
       if(!WriteFrame(frame))
          break;
 
-      if(!isAudio && !frame.GetMarker())
-        MCUTime::Sleep(1);
-
       // Reset flag for in talk burst
       if(isAudio)
         frame.SetMarker(FALSE);
@@ -607,6 +805,13 @@ void MCU_RTPChannel::Transmit()
       frameCount = 0;
     }
 
+    // комфортный шум в начале паузы и периодически, пока нет голоса
+    if(isAudio && silent && cnPayloadType >= 0 && !paused && MCUTime::GetMonoTimestampUsec() - cnTime >= RTP_CN_INTERVAL)
+    {
+      if(!WriteComfortNoise(rtpTimestamp))
+        break;
+    }
+
     // Calculate the timestamp and real time to take in processing
     if(isAudio)
     {
@@ -635,6 +840,10 @@ void MCU_RTPChannel::Transmit()
   }
 
   // detach cache
+  session.ResetRetransmissions();
+  rtxHistory = NULL;
+  if(cache)
+    cache->SetReaderBitRate(this, 0);
   DetachCacheRTP(cache);
 
 #if PTRACING
@@ -742,6 +951,92 @@ static RTP_Session::ReceiverReportArray BuildReceiverReportArray(const RTP_Contr
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+MCUBandwidthEstimator::MCUBandwidthEstimator()
+{
+  maxBitRate = 0;
+  receiverBitRate = 0;
+  lossBitRate = 0;
+  minRtt = -1;
+  lastRtt = -1;
+  updateTime = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUBandwidthEstimator::SetMaxBitRate(unsigned bitRate)
+{
+  PWaitAndSignal m(mutex);
+  maxBitRate = bitRate;
+  if(lossBitRate == 0 || lossBitRate > maxBitRate)
+    lossBitRate = maxBitRate;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUBandwidthEstimator::OnReceiverEstimate(unsigned bitRate)
+{
+  PWaitAndSignal m(mutex);
+  PTRACE_IF(4, bitRate != receiverBitRate, "MCUBandwidthEstimator\tReceiver estimate " << bitRate);
+  receiverBitRate = bitRate;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUBandwidthEstimator::OnReceiverReport(unsigned fractionLost, int rtt)
+{
+  uint64_t now = MCUTime::GetMonoTimestampUsec();
+  PWaitAndSignal m(mutex);
+
+  if(rtt >= 0)
+  {
+    lastRtt = rtt;
+    if(minRtt < 0 || rtt < minRtt)
+      minRtt = rtt;
+  }
+
+  if(maxBitRate == 0)
+    return;
+  if(updateTime != 0 && now - updateTime < RTP_BWE_UPDATE_INTERVAL)
+    return;
+  updateTime = now;
+
+  // потери > 10% - снижение пропорционально потерям,
+  // рост задержки - снижение на 15%, потери < 2% - рост на 8%
+  unsigned bitRate = lossBitRate;
+  if(fractionLost > 26)
+    bitRate = (unsigned)((uint64_t)bitRate * (512 - fractionLost) / 512);
+  else if(rtt >= 0 && rtt > minRtt + RTP_BWE_DELAY_THRESHOLD)
+    bitRate = (unsigned)((uint64_t)bitRate * 85 / 100);
+  else if(fractionLost < 5)
+    bitRate = (unsigned)((uint64_t)bitRate * 108 / 100);
+
+  if(bitRate < RTP_BWE_MIN_BITRATE)
+    bitRate = RTP_BWE_MIN_BITRATE;
+  if(bitRate > maxBitRate)
+    bitRate = maxBitRate;
+
+  PTRACE_IF(4, bitRate != lossBitRate, "MCUBandwidthEstimator\tLoss " << fractionLost*100/256 << "%, rtt " << rtt << "/" << minRtt << " ms, estimate " << lossBitRate << " -> " << bitRate);
+  lossBitRate = bitRate;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned MCUBandwidthEstimator::GetBitRate()
+{
+  PWaitAndSignal m(mutex);
+  unsigned bitRate = lossBitRate;
+  if(receiverBitRate != 0 && (bitRate == 0 || receiverBitRate < bitRate))
+    bitRate = receiverBitRate;
+  if(bitRate != 0 && bitRate < RTP_BWE_MIN_BITRATE)
+    bitRate = RTP_BWE_MIN_BITRATE;
+  // согласованный максимум - без ограничения
+  if(maxBitRate != 0 && bitRate >= maxBitRate)
+    return 0;
+  return bitRate;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 MCU_RTP_UDP::MCU_RTP_UDP(
 #ifdef H323_RTP_AGGREGATE
       PHandleAggregator * aggregator,
@@ -768,8 +1063,31 @@ MCU_RTP_UDP::MCU_RTP_UDP(
   writeDataErrorsTime = 0;
   writeControlErrors = 0;
 
+  rtcpMux = false;
+  audioLevelId = -1;
+
+  interleaved = false;
+  interleavedDropped = 0;
+  interleavedWriter = NULL;
+  interleavedWriterContext = NULL;
+
   zrtp_secured = FALSE;
   srtp_secured = FALSE;
+
+  rtxPayloadType = -1;
+  rtxSyncSource = ((DWORD)rand() << 16) ^ (DWORD)rand();
+  rtxSequenceNumber = (WORD)rand();
+  packetsRetransmitted = 0;
+  retransmitTime = 0;
+  pictureLoss = false;
+  firSequenceNumber = -1;
+
+  for(int i = 0; i < RTP_BWE_SR_HISTORY; ++i)
+  {
+    srNtp[i] = 0;
+    srTime[i] = 0;
+  }
+  srIndex = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -783,6 +1101,8 @@ MCU_RTP_UDP::~MCU_RTP_UDP()
     delete r->second;
     frameQueue.erase(r);
   }
+  for(std::vector<RTP_DataFrame *>::iterator it = framePool.begin(); it != framePool.end(); ++it)
+    delete *it;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -803,11 +1123,300 @@ RTP_Session::SendReceiveStatus MCU_RTP_UDP::OnReceiveControl(RTP_ControlFrame &
       packetsLostTx = ra[ra.GetSize()-1].totalLost;
   }
 
+  // feedback может быть в любой части составного пакета
+  const BYTE * data = frame.GetPointer();
+  PINDEX total = frame.GetSize();
+  PINDEX offset = 0;
+  while(offset + 4 <= total)
+  {
+    PINDEX length = (((PINDEX)data[offset+2] << 8) | data[offset+3]) * 4 + 4;
+    if((data[offset] >> 6) != RTP_DataFrame::ProtocolVersion || offset + length > total)
+      break;
+    BYTE fmt = data[offset] & 0x1f;
+    DWORD ssrc = 0;
+    if(length >= 12)
+      ssrc = ((DWORD)data[offset+8] << 24) | ((DWORD)data[offset+9] << 16) | ((DWORD)data[offset+10] << 8) | data[offset+11];
+    // SR (200), RR (201) - блоки отчетов после заголовка и SSRC (и данных отправителя)
+    if(data[offset+1] == 200 && length >= 28)
+      OnReceiveReportBlocks(data + offset + 28, PMIN((PINDEX)fmt, (length - 28) / 24));
+    else if(data[offset+1] == 201 && length >= 8)
+      OnReceiveReportBlocks(data + offset + 8, PMIN((PINDEX)fmt, (length - 8) / 24));
+    // RTPFB (205), FMT=1 - generic NACK: SSRC отправителя, SSRC потока, FCI
+    else if(data[offset+1] == 205 && fmt == 1 && length >= 16 && IsNackEnabled())
+    {
+      if(ssrc == syncSourceOut || ssrc == 0)
+        OnReceiveNack(data + offset + 12, length - 12);
+    }
+    // RTPFB (205), FMT=3 - TMMBR, FCI: SSRC потока, MxTBR exp(6) mantissa(17) overhead(9)
+    else if(data[offset+1] == 205 && fmt == 3)
+    {
+      for(PINDEX i = offset + 12; i + 8 <= offset + length; i += 8)
+      {
+        DWORD fciSsrc = ((DWORD)data[i] << 24) | ((DWORD)data[i+1] << 16) | ((DWORD)data[i+2] << 8) | data[i+3];
+        if(fciSsrc != syncSourceOut)
+          continue;
+        unsigned exp = data[i+4] >> 2;
+        DWORD mantissa = ((DWORD)(data[i+4] & 0x03) << 15) | ((DWORD)data[i+5] << 7) | (data[i+6] >> 1);
+        bandwidthEstimator.OnReceiverEstimate(exp < 15 ? (unsigned)(mantissa << exp) : UINT_MAX);
+      }
+    }
+    // PSFB (206), FMT=15 - REMB, "REMB", число SSRC, BR exp(6) mantissa(18), SSRC потоков
+    else if(data[offset+1] == 206 && fmt == 15 && length >= 24 && memcmp(data + offset + 12, "REMB", 4) == 0)
+    {
+      unsigned exp = data[offset+17] >> 2;
+      DWORD mantissa = ((DWORD)(data[offset+17] & 0x03) << 16) | ((DWORD)data[offset+18] << 8) | data[offset+19];
+      bool found = (data[offset+16] == 0);
+      for(PINDEX i = offset + 20; i + 4 <= offset + length && i < offset + 20 + 4 * data[offset+16]; i += 4)
+      {
+        if((((DWORD)data[i] << 24) | ((DWORD)data[i+1] << 16) | ((DWORD)data[i+2] << 8) | data[i+3]) == syncSourceOut)
+          found = true;
+      }
+      if(found)
+        bandwidthEstimator.OnReceiverEstimate(exp < 14 ? (unsigned)(mantissa << exp) : UINT_MAX);
+    }
+    // PSFB (206), FMT=1 - PLI
+    else if(data[offset+1] == 206 && fmt == 1 && length >= 12)
+    {
+      if(ssrc == syncSourceOut || ssrc == 0)
+        OnReceivePictureLoss(-1);
+    }
+    // PSFB (206), FMT=4 - FIR, FCI: SSRC потока, номер запроса
+    else if(data[offset+1] == 206 && fmt == 4)
+    {
+      for(PINDEX i = offset + 12; i + 8 <= offset + length; i += 8)
+      {
+        DWORD fciSsrc = ((DWORD)data[i] << 24) | ((DWORD)data[i+1] << 16) | ((DWORD)data[i+2] << 8) | data[i+3];
+        if(fciSsrc == syncSourceOut)
+          OnReceivePictureLoss(data[i+4]);
+      }
+    }
+    offset += length;
+  }
+
   return RTP_UDP::OnReceiveControl(frame);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void MCU_RTP_UDP::OnReceiveReportBlocks(const BYTE * data, PINDEX count)
+{
+  // SSRC(4) fraction lost(1) cumulative lost(3) highest seq(4) jitter(4) LSR(4) DLSR(4)
+  for(PINDEX i = 0; i < count; ++i, data += 24)
+  {
+    DWORD ssrc = ((DWORD)data[0] << 24) | ((DWORD)data[1] << 16) | ((DWORD)data[2] << 8) | data[3];
+    if(ssrc != syncSourceOut)
+      continue;
+    DWORD lsr = ((DWORD)data[16] << 24) | ((DWORD)data[17] << 16) | ((DWORD)data[18] << 8) | data[19];
+    DWORD dlsr = ((DWORD)data[20] << 24) | ((DWORD)data[21] << 16) | ((DWORD)data[22] << 8) | data[23];
+    int rtt = -1;
+    for(int n = 0; lsr != 0 && n < RTP_BWE_SR_HISTORY; ++n)
+    {
+      if(srNtp[n] != lsr)
+        continue;
+      // DLSR в единицах 1/65536 с
+      int64_t usec = (int64_t)(MCUTime::GetMonoTimestampUsec() - srTime[n]) - (int64_t)dlsr * 1000000 / 65536;
+      rtt = (usec > 0 ? (int)(usec / 1000) : 0);
+      break;
+    }
+    bandwidthEstimator.OnReceiverReport(data[4], rtt);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCU_RTP_UDP::OnReceivePictureLoss(int firSeq)
+{
+  PWaitAndSignal m(nackMutex);
+  // повтор FIR с тем же номером - тот же запрос
+  if(firSeq >= 0)
+  {
+    if(firSeq == firSequenceNumber)
+      return;
+    firSequenceNumber = firSeq;
+  }
+  pictureLoss = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool MCU_RTP_UDP::GetPictureLoss()
+{
+  if(!pictureLoss)
+    return false;
+  PWaitAndSignal m(nackMutex);
+  bool result = pictureLoss;
+  pictureLoss = false;
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL MCU_RTP_UDP::SendPictureLoss()
+{
+  // RR без блоков отчетов и PSFB (206), FMT=1 - PLI: SSRC отправителя, SSRC потока
+  RTP_ControlFrame frame(32);
+  frame.SetPayloadType(RTP_ControlFrame::e_ReceiverReport);
+  frame.SetCount(0);
+  frame.SetPayloadSize(4);
+  *(PUInt32b *)frame.GetPayloadPtr() = syncSourceOut;
+  frame.WriteNextCompound();
+  frame.SetPayloadType(206);
+  frame.SetCount(1);
+  frame.SetPayloadSize(8);
+  PUInt32b * fci = (PUInt32b *)frame.GetPayloadPtr();
+  fci[0] = syncSourceOut;
+  fci[1] = syncSourceIn;
+  return WriteControl(frame);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool MCU_RTP_UDP::IsRecovering() const
+{
+  if(!IsNackEnabled() || retransmitTime == 0)
+    return false;
+  return (MCUTime::GetMonoTimestampUsec() - retransmitTime < RTP_RECOVERY_INTERVAL);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCU_RTP_UDP::OnReceiveNack(const BYTE * fci, PINDEX size)
+{
+  PWaitAndSignal m(nackMutex);
+  for(PINDEX i = 0; i + 4 <= size; i += 4)
+  {
+    // PID - потерянный пакет, BLP - маска следующих 16
+    WORD pid = (WORD)((fci[i] << 8) | fci[i+1]);
+    WORD blp = (WORD)((fci[i+2] << 8) | fci[i+3]);
+    nackQueue.push_back(pid);
+    for(int bit = 0; bit < 16; ++bit)
+    {
+      if(blp & (1 << bit))
+        nackQueue.push_back((WORD)(pid + bit + 1));
+    }
+  }
+  while(nackQueue.size() > RTP_HISTORY_SIZE)
+    nackQueue.pop_front();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCU_RTP_UDP::SetNack(bool enable, int _rtxPayloadType)
+{
+  PWaitAndSignal m(nackMutex);
+  nackQueue.clear();
+  rtxSentPackets.clear();
+  rtxPayloadType = -1;
+  if(enable)
+  {
+    rtxSentPackets.resize(RTP_HISTORY_SIZE);
+    rtxPayloadType = _rtxPayloadType;
+  }
+  PTRACE(2, "MCU_RTP_UDP\tSession " << sessionID << ", NACK " << (enable ? "enabled" : "disabled") << ", RTX payload type " << rtxPayloadType);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCU_RTP_UDP::ResetRetransmissions()
+{
+  // SetNack изменяет rtxSentPackets под этой же блокировкой
+  PWaitAndSignal m(nackMutex);
+  for(size_t i = 0; i < rtxSentPackets.size(); ++i)
+    rtxSentPackets[i].history = NULL;
+  nackQueue.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCU_RTP_UDP::OnSentPacket(const RTP_DataFrame & frame, MCURtpHistory * history, unsigned historyN)
+{
+  PWaitAndSignal m(nackMutex);
+  if(rtxSentPackets.size() == 0)
+    return;
+  WORD sequenceNumber = frame.GetSequenceNumber();
+  RtxSentPacket & packet = rtxSentPackets[sequenceNumber & (RTP_HISTORY_SIZE-1)];
+  packet.history = history;
+  packet.historyN = historyN;
+  packet.timestamp = frame.GetTimestamp();
+  packet.resendTime = 0;
+  packet.sequenceNumber = sequenceNumber;
+  packet.payloadType = (BYTE)frame.GetPayloadType();
+  packet.marker = frame.GetMarker();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL MCU_RTP_UDP::SendRetransmissions()
+{
+  std::deque<WORD> queue;
+  {
+    PWaitAndSignal m(nackMutex);
+    if(nackQueue.size() == 0)
+      return TRUE;
+    queue.swap(nackQueue);
+  }
+
+  if(remoteAddress.IsAny() || !remoteAddress.IsValid() || remoteDataPort == 0)
+    return TRUE;
+
+  uint64_t now = MCUTime::GetMonoTimestampUsec();
+  for(std::deque<WORD>::iterator it = queue.begin(); it != queue.end(); ++it)
+  {
+    WORD sequenceNumber = *it;
+    RtxSentPacket packet;
+    {
+      PWaitAndSignal m(nackMutex);
+      if(rtxSentPackets.size() == 0)
+        break;
+      RtxSentPacket & sent = rtxSentPackets[sequenceNumber & (RTP_HISTORY_SIZE-1)];
+      if(sent.history == NULL || sent.sequenceNumber != sequenceNumber)
+        continue;
+      if(sent.resendTime != 0 && now - sent.resendTime < RTP_RETRANSMIT_INTERVAL)
+        continue;
+      if(!sent.history->Get(sent.historyN, rtxFrame))
+      {
+        PTRACE(6, "MCU_RTP_UDP\tSession " << sessionID << ", NACK " << sequenceNumber << " packet is out of history");
+        continue;
+      }
+      sent.resendTime = now;
+      packet = sent;
+    }
+
+    rtxFrame.SetTimestamp(packet.timestamp);
+    rtxFrame.SetMarker(packet.marker);
+    if(rtxPayloadType < 0)
+    {
+      // тот же пакет
+      rtxFrame.SetPayloadType((RTP_DataFrame::PayloadTypes)packet.payloadType);
+      rtxFrame.SetSequenceNumber(sequenceNumber);
+      rtxFrame.SetSyncSource(syncSourceOut);
+    }
+    else
+    {
+      // RTX: OSN + исходная нагрузка, свои SSRC и нумерация
+      PINDEX size = rtxFrame.GetPayloadSize();
+      rtxFrame.SetPayloadSize(size + 2);
+      BYTE * payload = rtxFrame.GetPayloadPtr();
+      memmove(payload + 2, payload, size);
+      payload[0] = (BYTE)(sequenceNumber >> 8);
+      payload[1] = (BYTE)sequenceNumber;
+      rtxFrame.SetPayloadType((RTP_DataFrame::PayloadTypes)rtxPayloadType);
+      rtxFrame.SetSequenceNumber(rtxSequenceNumber++);
+      rtxFrame.SetSyncSource(rtxSyncSource);
+    }
+
+    if(!WriteData(rtxFrame))
+      return FALSE;
+    pacer.Consume(rtxFrame.GetHeaderSize() + rtxFrame.GetPayloadSize());
+    packetsRetransmitted++;
+    retransmitTime = now;
+    PTRACE(6, "MCU_RTP_UDP\tSession " << sessionID << ", NACK " << sequenceNumber << " retransmitted");
+  }
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void MCU_RTP_UDP::OnRxSenderReport(const SenderReport & PTRACE_PARAM(sender), const ReceiverReportArray & PTRACE_PARAM(reports))
 {
   rtpcReceived++;
@@ -900,20 +1509,42 @@ BOOL MCU_RTP_UDP::PostWriteData(RTP_DataFrame & frame)
 
 BOOL MCU_RTP_UDP::WriteControl(RTP_ControlFrame & frame)
 {
+  if(interleaved)
+  {
+    // RTCP через соединение RTSP
+    PWaitAndSignal m(interleavedMutex);
+    if(interleavedWriter)
+      interleavedWriter(interleavedWriterContext, sessionID, frame.GetPointer(), frame.GetCompoundSize());
+    return TRUE;
+  }
+
+  // rtcp-mux: RTCP через порт данных
+  PUDPSocket * socket = rtcpMux ? dataSocket : controlSocket;
+  WORD port = rtcpMux ? remoteDataPort : remoteControlPort;
+
   // Trying to send a PDU before we are set up!
-  if(!remoteAddress.IsValid() || remoteControlPort == 0)
+  if(!remoteAddress.IsValid() || port == 0)
     return TRUE;
 
+  // время отправки SR для расчета RTT по LSR/DLSR из RR получателя
+  if(frame.GetPayloadType() == RTP_ControlFrame::e_SenderReport && frame.GetPayloadSize() >= sizeof(RTP_ControlFrame::SenderReport))
+  {
+    const RTP_ControlFrame::SenderReport * sr = (const RTP_ControlFrame::SenderReport *)frame.GetPayloadPtr();
+    srNtp[srIndex % RTP_BWE_SR_HISTORY] = ((DWORD)sr->ntp_sec << 16) | ((DWORD)sr->ntp_frac >> 16);
+    srTime[srIndex % RTP_BWE_SR_HISTORY] = MCUTime::GetMonoTimestampUsec();
+    srIndex++;
+  }
+
   // Сделать несколько попыток записи, трассировка на последней попытке.
   // Всегда возвращает TRUE.
   int writeAttempts = 0;
-  while(!controlSocket->WriteTo(frame.GetPointer(), frame.GetCompoundSize(), remoteAddress, remoteControlPort))
+  while(!socket->WriteTo(frame.GetPointer(), frame.GetCompoundSize(), remoteAddress, port))
   {
     writeAttempts++;
     if(writeAttempts < 3)
       continue;
 
-    switch(controlSocket->GetErrorNumber())
+    switch(socket->GetErrorNumber())
     {
       case ECONNRESET :
       case ECONNREFUSED :
@@ -921,8 +1552,8 @@ BOOL MCU_RTP_UDP::WriteControl(RTP_ControlFrame & frame)
         break;
       default:
         PTRACE(1, "RTP_UDP\tSession " << sessionID << ", Write error on control port ("
-               << controlSocket->GetErrorNumber(PChannel::LastWriteError) << "): "
-               << controlSocket->GetErrorText(PChannel::LastWriteError));
+               << socket->GetErrorNumber(PChannel::LastWriteError) << "): "
+               << socket->GetErrorText(PChannel::LastWriteError));
     }
 
     writeControlErrors++;
@@ -934,6 +1565,168 @@ BOOL MCU_RTP_UDP::WriteControl(RTP_ControlFrame & frame)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void MCU_RTP_UDP::SetRtcpMux(bool enable)
+{
+  // порт RTCP уже закрыт, вернуться нельзя
+  if(rtcpMux || !enable)
+    return;
+  PTRACE(3, "MCU_RTP_UDP\tSession " << sessionID << ", rtcp-mux enabled");
+  rtcpMux = true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCU_RTP_UDP::Close(BOOL reading)
+{
+  if(interleaved && reading)
+  {
+    if(shutdownRead)
+      return;
+    // поток чтения ожидает пакеты от соединения RTSP
+    PTRACE(3, "MCU_RTP_UDP\tSession " << sessionID << ", Shutting down interleaved read.");
+    syncSourceIn = 0;
+    shutdownRead = TRUE;
+    interleavedSync.Signal();
+    return;
+  }
+
+  if(!rtcpMux)
+  {
+    RTP_UDP::Close(reading);
+    return;
+  }
+
+  if(!reading)
+  {
+    PTRACE(3, "MCU_RTP_UDP\tSession " << sessionID << ", Shutting down write.");
+    shutdownWrite = TRUE;
+    return;
+  }
+  if(shutdownRead)
+    return;
+
+  // порт RTCP закрыт, поток чтения будится пакетом на порт данных
+  PTRACE(3, "MCU_RTP_UDP\tSession " << sessionID << ", Shutting down read.");
+  syncSourceIn = 0;
+  shutdownRead = TRUE;
+  if(dataSocket != NULL)
+  {
+    PIPSocket::Address addr;
+    dataSocket->GetLocalAddress(addr);
+    if(addr.IsAny())
+      PIPSocket::GetHostAddress(addr);
+    dataSocket->WriteTo("", 1, addr, dataSocket->GetPort());
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RTP_Session::SendReceiveStatus MCU_RTP_UDP::ProcessPDU(RTP_DataFrame & frame, const BYTE * pdu, PINDEX pduSize, bool control)
+{
+  if(control)
+  {
+    if(pduSize < 4)
+    {
+      PTRACE(2, "MCU_RTP_UDP\tSession " << sessionID << ", Received control packet too small: " << pduSize << " bytes");
+      return e_IgnorePacket;
+    }
+    RTP_ControlFrame controlFrame(pduSize);
+    memcpy(controlFrame.GetPointer(), pdu, pduSize);
+    controlFrame.SetSize(pduSize);
+    if(pduSize < 4 + controlFrame.GetPayloadSize())
+    {
+      PTRACE(2, "MCU_RTP_UDP\tSession " << sessionID << ", Received control packet too small: " << pduSize << " bytes");
+      return e_IgnorePacket;
+    }
+    // кадр данных не получен, продолжить чтение
+    if(OnReceiveControl(controlFrame) == e_AbortTransport)
+      return e_AbortTransport;
+    return e_IgnorePacket;
+  }
+
+  // из очереди interleaved, из сокета пакет уже в кадре
+  if(pdu != (const BYTE *)frame)
+  {
+    frame.SetMinSize(pduSize + RTP_SECURE_HEADROOM);
+    memcpy(frame.GetPointer(), pdu, pduSize);
+  }
+  if(pduSize < RTP_DataFrame::MinHeaderSize || pduSize < frame.GetHeaderSize())
+  {
+    PTRACE(2, "MCU_RTP_UDP\tSession " << sessionID << ", Received data packet too small: " << pduSize << " bytes");
+    return e_IgnorePacket;
+  }
+
+  frame.SetPayloadSize(pduSize - frame.GetHeaderSize());
+  return OnReceiveData(frame, *this);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RTP_Session::SendReceiveStatus MCU_RTP_UDP::ReadMuxPDU(RTP_DataFrame & frame)
+{
+  SendReceiveStatus status = ReadDataOrControlPDU(*dataSocket, frame, TRUE);
+  if(status != e_ProcessPacket)
+    return status;
+
+  PINDEX pduSize = dataSocket->GetLastReadCount();
+
+  // RFC 5761: второй байт 192-223 у RTCP, у RTP это payload type 64-95 с маркером
+  bool control = (pduSize >= 4 && frame[1] >= 192 && frame[1] <= 223);
+  return ProcessPDU(frame, (const BYTE *)frame, pduSize, control);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCU_RTP_UDP::SetInterleaved(bool enable, InterleavedWriter * writer, void * writerContext)
+{
+  PWaitAndSignal m(interleavedMutex);
+  interleaved = enable;
+  interleavedWriter = writer;
+  interleavedWriterContext = writerContext;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCU_RTP_UDP::PutInterleaved(const BYTE * data, PINDEX size, bool control)
+{
+  if(!interleaved || shutdownRead)
+    return;
+
+  {
+    PWaitAndSignal m(interleavedMutex);
+    // поток чтения не успевает, старые пакеты отбрасываются
+    if(interleavedQueue.size() >= RTP_INTERLEAVED_QUEUE_SIZE)
+    {
+      interleavedQueue.pop_front();
+      if(interleavedDropped++ % 100 == 0)
+        PTRACE(2, "MCU_RTP_UDP\tSession " << sessionID << ", interleaved queue is full, dropped " << interleavedDropped);
+    }
+    InterleavedPacket packet;
+    packet.data = PBYTEArray(data, size);
+    packet.control = control;
+    interleavedQueue.push_back(packet);
+  }
+  interleavedSync.Signal();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RTP_Session::SendReceiveStatus MCU_RTP_UDP::ReadInterleavedPDU(RTP_DataFrame & frame)
+{
+  InterleavedPacket packet;
+  {
+    PWaitAndSignal m(interleavedMutex);
+    if(interleavedQueue.size() == 0)
+      return e_IgnorePacket;
+    packet = interleavedQueue.front();
+    interleavedQueue.pop_front();
+  }
+
+  return ProcessPDU(frame, (const BYTE *)packet.data, packet.data.GetSize(), packet.control);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void MCU_RTP_UDP::SetLastTimeRTPQueue(void)
 {
   PTime oldTime;
@@ -952,11 +1745,34 @@ void MCU_RTP_UDP::SetLastTimeRTPQueue(void)
 
 void MCU_RTP_UDP::CopyRTPDataFrame(RTP_DataFrame & dstFrame, RTP_DataFrame & srcFrame)
 {
-  PINDEX frameSize = srcFrame.GetSize();
-  dstFrame.SetSize(frameSize);
+  // буфер не уменьшается, запас остается под расшифровку и следующие пакеты
+  PINDEX frameSize = srcFrame.GetHeaderSize() + srcFrame.GetPayloadSize();
+  dstFrame.SetMinSize(frameSize + RTP_SECURE_HEADROOM);
   memcpy(dstFrame.GetPointer(), srcFrame.GetPointer(), frameSize);
-  frameSize = srcFrame.GetPayloadSize();
-  dstFrame.SetPayloadSize(frameSize);
+  dstFrame.SetPayloadSize(srcFrame.GetPayloadSize());
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RTP_DataFrame * MCU_RTP_UDP::GetPoolFrame()
+{
+  if(framePool.size() == 0)
+    return new MCU_RTP_DataFrame();
+  RTP_DataFrame * frame = framePool.back();
+  framePool.pop_back();
+  return frame;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCU_RTP_UDP::PutPoolFrame(RTP_DataFrame * frame)
+{
+  if(framePool.size() >= RTP_QUEUE_POOL_SIZE)
+  {
+    delete frame;
+    return;
+  }
+  framePool.push_back(frame);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -971,7 +1787,7 @@ BOOL MCU_RTP_UDP::ReadRTPQueue(RTP_DataFrame & frame)
   if(r != frameQueue.end())
   {
     CopyRTPDataFrame(frame,*(r->second));
-    delete r->second;
+    PutPoolFrame(r->second);
     frameQueue.erase(r);
     SetLastTimeRTPQueue();
     PTRACE(6, "MCU_RTP_UDP\tReadRTPQueue Get frame from queue " << expectedSequenceNumber << " " << frame.GetSequenceNumber());
@@ -983,7 +1799,7 @@ BOOL MCU_RTP_UDP::ReadRTPQueue(RTP_DataFrame & frame)
     WORD i = 0; while( (r = frameQueue.find(expectedSequenceNumber + i)) == frameQueue.end()) i++;
     PTRACE(6, "MCU_RTP_UDP\tReadRTPQueue Timeout, return first frame from queue " << expectedSequenceNumber + i);
     CopyRTPDataFrame(frame,*(r->second));
-    delete r->second;
+    PutPoolFrame(r->second);
     frameQueue.erase(r);
     return TRUE;
   }
@@ -1012,15 +1828,14 @@ BOOL MCU_RTP_UDP::ProcessRTPQueue(RTP_DataFrame & frame)
   std::map<WORD, RTP_DataFrame *>::iterator r = frameQueue.find(sequenceNumber);
   if(r != frameQueue.end()) // duplicate frame
   {
-    delete r->second;
+    PutPoolFrame(r->second);
     frameQueue.erase(r);
     SetLastTimeRTPQueue();
   }
 
-  ((MCU_RTP_DataFrame &)frame).localTimeStamp = now;
-
-  MCU_RTP_DataFrame * newFrame = new MCU_RTP_DataFrame();
+  MCU_RTP_DataFrame * newFrame = (MCU_RTP_DataFrame *)GetPoolFrame();
   CopyRTPDataFrame(*newFrame,frame);
+  newFrame->localTimeStamp = now;
 
   frameQueue.insert(std::map<WORD, RTP_DataFrame *>::value_type(sequenceNumber, newFrame));
   SetLastTimeRTPQueue();
@@ -1032,7 +1847,7 @@ BOOL MCU_RTP_UDP::ProcessRTPQueue(RTP_DataFrame & frame)
   {
     PTRACE(6, "MCU_RTP_UDP\tProcessRTPQueue Get frame from queue " << expectedSequenceNumber);
     CopyRTPDataFrame(frame,*(r->second));
-    delete r->second;
+    PutPoolFrame(r->second);
     frameQueue.erase(r);
     SetLastTimeRTPQueue();
     return TRUE;
@@ -1043,7 +1858,7 @@ BOOL MCU_RTP_UDP::ProcessRTPQueue(RTP_DataFrame & frame)
     WORD i = 0; while( (r = frameQueue.find(expectedSequenceNumber + i)) == frameQueue.end()) i++;
     PTRACE(6, "MCU_RTP_UDP\tProcessRTPQueue Timeout, return first frame from queue " << expectedSequenceNumber + i);
     CopyRTPDataFrame(frame,*(r->second));
-    delete r->second;
+    PutPoolFrame(r->second);
     frameQueue.erase(r);
     return TRUE;
   }
@@ -1064,10 +1879,60 @@ BOOL MCU_RTP_UDP::ReadData(RTP_DataFrame & frame, BOOL loop)
       return TRUE; // Got frame from queue
     }
 
+    if(interleaved)
+    {
+      // пакеты из соединения RTSP, без ожидания если очередь не пуста
+      BOOL queued;
+      {
+        PWaitAndSignal m(interleavedMutex);
+        queued = (interleavedQueue.size() > 0);
+      }
+      if(!queued && !interleavedSync.Wait(reportTimer))
+      {
+        if(!shutdownRead && !SendReport())
+          return FALSE;
+      }
+      if(shutdownRead)
+      {
+        PTRACE(3, "MCU_RTP_UDP\tSession " << sessionID << ", Read shutdown.");
+        shutdownRead = FALSE;
+        return FALSE;
+      }
+      switch(ReadInterleavedPDU(frame))
+      {
+        case e_ProcessPacket :
+          return TRUE;
+        case e_IgnorePacket :
+          break;
+        case e_AbortTransport :
+          return FALSE;
+      }
+      continue;
+    }
+
 #ifdef H323_RTP_AGGREGATE
     PTime start;
 #endif
-    int selectStatus = PSocket::Select(*dataSocket, *controlSocket, reportTimer);
+    int selectStatus;
+    if(rtcpMux)
+    {
+      // поток чтения единственный, кто ожидает на порту RTCP
+      if(controlSocket != NULL)
+      {
+        PTRACE(3, "MCU_RTP_UDP\tSession " << sessionID << ", rtcp-mux, close control port " << localControlPort);
+        delete controlSocket;
+        controlSocket = NULL;
+      }
+      PSocket::SelectList read, dummy1, dummy2;
+      read += *dataSocket;
+      PChannel::Errors error = PSocket::Select(read, dummy1, dummy2, reportTimer);
+      if(error != PChannel::NoError)
+        selectStatus = error;
+      else
+        selectStatus = (read.GetSize() > 0) ? -1 : 0;
+    }
+    else
+      selectStatus = PSocket::Select(*dataSocket, *controlSocket, reportTimer);
 #ifdef H323_RTP_AGGREGATE
     unsigned duration = (unsigned)(PTime() - start).GetMilliSeconds();
     if(duration > 50)
@@ -1093,7 +1958,7 @@ BOOL MCU_RTP_UDP::ReadData(RTP_DataFrame & frame, BOOL loop)
         // Then do -1 case
 
       case -1 :
-        switch (ReadDataPDU(frame)) {
+        switch (rtcpMux ? ReadMuxPDU(frame) : ReadDataPDU(frame)) {
           case e_ProcessPacket :
             if (!shutdownRead)
               return TRUE;
@@ -1410,7 +2275,7 @@ BOOL MCUSIP_RTP_UDP::WriteData(RTP_DataFrame & frame)
   if(srtp_write)
   {
     int len = frame.GetHeaderSize() + frame.GetPayloadSize();
-    frame.SetMinSize(len + SRTP_MAX_TRAILER_LEN);
+    frame.SetMinSize(len + RTP_SECURE_HEADROOM);
     if(SRTP_ERROR(srtp_protect, (srtp_write->GetSession(), frame.GetPointer(), &len)))
       return TRUE;
     //cout << "SRTP Protected RTP packet\n";
@@ -1422,10 +2287,9 @@ BOOL MCUSIP_RTP_UDP::WriteData(RTP_DataFrame & frame)
   {
     //cout << "ZRTP OnSendData\n";
     unsigned len = frame.GetHeaderSize() + frame.GetPayloadSize();
-    frame.SetSize(2060);
+    frame.SetMinSize(len + RTP_SECURE_HEADROOM);
     if(ZRTP_ERROR(zrtp_process_rtp, (zrtp_stream, (char *)frame.GetPointer(), &len)))
       return TRUE;
-    frame.SetSize(len);
     frame.SetPayloadSize(len - frame.GetHeaderSize());
   }
 #endif
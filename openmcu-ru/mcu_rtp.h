@@ -12,6 +12,28 @@
 
 #define	MAX_PAYLOAD_TYPE_MISMATCHES 8
 #define RTP_TRACE_DISPLAY_RATE 16000 // 2 seconds
+#define RTP_RETRANSMIT_INTERVAL 100000 // usec, не чаще для одного пакета
+#define RTP_RECOVERY_INTERVAL 500000 // usec, после последней повторной передачи
+#define RTP_SECURE_HEADROOM 64 // bytes, запас в кадре под SRTP/ZRTP трейлер
+#define RTP_QUEUE_POOL_SIZE 32 // кадры для очереди переупорядочивания
+#define RTP_INTERLEAVED_QUEUE_SIZE 500 // пакеты RTSP interleaved, ожидающие чтения
+
+#define RTP_AUDIO_LEVEL_URN      "urn:ietf:params:rtp-hdrext:ssrc-audio-level"
+#define RTP_AUDIO_LEVEL_SILENCE  70     // -dBov, тише пакеты не декодируются (RFC 6464)
+#define RTP_AUDIO_LEVEL_HANGOVER 300000 // usec, декодирование после последнего голоса
+
+#define RTP_CN_INTERVAL          5000000 // usec, повтор комфортного шума в паузе (RFC 3389)
+
+#define RTP_BWE_MIN_BITRATE     64000   // bit/s
+#define RTP_BWE_UPDATE_INTERVAL 1000000 // usec, не чаще изменение оценки по RTCP RR
+#define RTP_BWE_DELAY_THRESHOLD 100     // ms, рост RTT над минимальным
+#define RTP_BWE_SR_HISTORY      8
+#define RTP_BWE_APPLY_INTERVAL  200000  // usec, передача оценки кодеру
+
+#define RTP_PACER_FACTOR        3       // скорость отправки видео, кратно целевому битрейту
+#define RTP_PACER_BITRATE       2048000 // bit/s, если битрейт неизвестен
+#define RTP_PACER_BURST         5000    // usec, пакеты отправляемые без ожидания
+#define RTP_PACER_MAX_DELAY     100000  // usec, предельная задержка пакета
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -53,13 +75,12 @@ class MCU_RTPChannel : public H323_RTPChannel
     const PString & GetCacheName() const
     { return cacheName; }
 
-    void OnFastUpdatePicture()
-    {
-      if(cache)
-        cache->OnFastUpdatePicture();
-      else
-        ((H323VideoCodec *)codec)->OnFastUpdatePicture();
-    }
+    // source - имя получателя запросившего ключевой кадр, пустое для запросов MCU
+    void OnFastUpdatePicture(const PString & source = "");
+
+    // запросы ключевого кадра при кодировании без кэша
+    MCUKeyFrameArbiter & GetKeyFrameArbiter()
+    { return keyFrameArbiter; }
 
     void SetFreeze(bool enable);
 
@@ -72,7 +93,18 @@ class MCU_RTPChannel : public H323_RTPChannel
     void SetAudioJitterEnable(bool enable)
     { audioJitterEnable = enable; }
 
+    // тип нагрузки комфортного шума (RFC 3389), -1 - паузы без пакетов
+    void SetComfortNoise(int payloadType)
+    { cnPayloadType = payloadType; }
+
   protected:
+    void SetRetransmitHistory(bool fromCache, unsigned historyN);
+
+    // удаляет заголовок расширения (RFC 5285), возвращает уровень звука (RFC 6464) или -1
+    int ReadHeaderExtension(RTP_DataFrame & frame);
+
+    BOOL WriteComfortNoise(DWORD rtpTimestamp);
+
     bool freezeWrite;
     bool isAudio;
     bool audioJitterEnable;
@@ -80,10 +112,20 @@ class MCU_RTPChannel : public H323_RTPChannel
     int intraRefreshPeriod;
     int intraRequestPeriod;
 
+    int cnPayloadType;
+    uint64_t cnTime;
+
     unsigned encoderSeqN;
     int cacheMode; // -1 - default no cache, 0 - no cache, 1 - cached, 2 - caching
     PString cacheName;
     CacheRTP *cache;
+
+    // повторная передача по NACK
+    MCURtpHistory *rtxHistory;
+    MCURtpHistory *rtxOwnHistory; // без кэша
+    unsigned rtxHistoryN;
+
+    MCUKeyFrameArbiter keyFrameArbiter;
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -117,6 +159,40 @@ class MCUSIP_RTPChannel : public MCU_RTPChannel
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Оценка пропускной способности исходящего потока.
+// Ограничение получателя (REMB, TMMBR, H.245 flow control) и собственная оценка
+// по потерям и росту RTT из RTCP RR, используется меньшая.
+class MCUBandwidthEstimator
+{
+  public:
+    MCUBandwidthEstimator();
+
+    // согласованный максимум кодера
+    void SetMaxBitRate(unsigned bitRate);
+
+    void OnReceiverEstimate(unsigned bitRate);
+
+    // fractionLost - доля потерь из RR (0..255), rtt - мс, -1 неизвестно
+    void OnReceiverReport(unsigned fractionLost, int rtt);
+
+    // 0 - ограничения нет
+    unsigned GetBitRate();
+
+    int GetRoundTripTime() const
+    { return lastRtt; }
+
+  protected:
+    PMutex mutex;
+    unsigned maxBitRate;
+    unsigned receiverBitRate;
+    unsigned lossBitRate;
+    int minRtt;
+    int lastRtt;
+    uint64_t updateTime;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 class MCU_RTP_UDP : public RTP_UDP
 {
   public:
@@ -138,6 +214,26 @@ class MCU_RTP_UDP : public RTP_UDP
 
     virtual BOOL WriteControl(RTP_ControlFrame & frame);
 
+    virtual void Close(BOOL reading);
+
+    // RTP и RTCP на одном порту (RFC 5761), порт RTCP закрывается потоком чтения
+    void SetRtcpMux(bool enable);
+    bool IsRtcpMux() const { return rtcpMux; }
+
+    // id расширения уровня звука (RFC 6464) из SDP, -1 - не согласовано
+    void SetAudioLevelId(int id) { audioLevelId = id; }
+    int GetAudioLevelId() const { return audioLevelId; }
+
+    // RTSP interleaved (RFC 2326 10.12): пакеты приходят через соединение RTSP, а не через порты,
+    // RTCP отправляется функцией writer
+    typedef void InterleavedWriter(void * context, unsigned sessionID, const BYTE * data, PINDEX size);
+    void SetInterleaved(bool enable, InterleavedWriter * writer = NULL, void * writerContext = NULL);
+    bool IsInterleaved() const { return interleaved; }
+    void PutInterleaved(const BYTE * data, PINDEX size, bool control);
+
+    // запрос intra-frame у источника без сигнализации (RFC 4585 PLI)
+    BOOL SendPictureLoss();
+
     // non-virtual
     //BOOL ReadBufferedData(DWORD timestamp, RTP_DataFrame & frame);
 
@@ -155,6 +251,28 @@ class MCU_RTP_UDP : public RTP_UDP
     // Get total number transmitted packets lost in session (via RTCP).
     DWORD GetPacketsLostTx() const { return packetsLostTx; }
 
+    // Generic NACK (RFC 4585), rtxPayloadType < 0 - повтор без RTX (RFC 4588)
+    void SetNack(bool enable, int rtxPayloadType = -1);
+    bool IsNackEnabled() const { return rtxSentPackets.size() > 0; }
+    void OnSentPacket(const RTP_DataFrame & frame, MCURtpHistory * history, unsigned historyN);
+    void ResetRetransmissions();
+    BOOL SendRetransmissions();
+
+    DWORD GetPacketsRetransmitted() const { return packetsRetransmitted; }
+
+    // потери сейчас восстанавливаются повтором пакетов
+    bool IsRecovering() const;
+
+    // получен PLI или FIR (RFC 4585, RFC 5104), сбрасывается при чтении
+    bool GetPictureLoss();
+
+    MCUBandwidthEstimator & GetBandwidthEstimator()
+    { return bandwidthEstimator; }
+
+    // равномерная отправка видео, только из потока передачи
+    MCUPacer & GetPacer()
+    { return pacer; }
+
 
     BOOL           zrtp_secured;
     PString        zrtp_sas_token;
@@ -170,7 +288,65 @@ class MCU_RTP_UDP : public RTP_UDP
     MCUTime writeDataErrorsTime;
     unsigned writeControlErrors;
 
+    volatile bool rtcpMux;
+    int audioLevelId;
+    // проверка и обработка принятого RTP или RTCP пакета, pdu может быть буфером frame
+    SendReceiveStatus ProcessPDU(RTP_DataFrame & frame, const BYTE * pdu, PINDEX pduSize, bool control);
+    SendReceiveStatus ReadMuxPDU(RTP_DataFrame & frame);
+
+    struct InterleavedPacket
+    {
+      PBYTEArray data;
+      bool control;
+    };
+    volatile bool interleaved;
+    std::deque<InterleavedPacket> interleavedQueue;
+    PMutex interleavedMutex;
+    PSyncPoint interleavedSync;
+    DWORD interleavedDropped;
+    InterleavedWriter * interleavedWriter;
+    void * interleavedWriterContext;
+    SendReceiveStatus ReadInterleavedPDU(RTP_DataFrame & frame);
+
+    void OnReceiveNack(const BYTE * fci, PINDEX size);
+    void OnReceivePictureLoss(int firSeq);
+    void OnReceiveReportBlocks(const BYTE * data, PINDEX count);
+
+    MCUBandwidthEstimator bandwidthEstimator;
+    MCUPacer pacer;
+
+    // отправленные SR для расчета RTT: NTP (средние 32 бита), время отправки
+    DWORD srNtp[RTP_BWE_SR_HISTORY];
+    uint64_t srTime[RTP_BWE_SR_HISTORY];
+    unsigned srIndex;
+
+    struct RtxSentPacket
+    {
+      MCURtpHistory *history;
+      unsigned historyN;
+      DWORD timestamp;
+      uint64_t resendTime;
+      WORD sequenceNumber;
+      BYTE payloadType;
+      bool marker;
+    };
+    std::vector<RtxSentPacket> rtxSentPackets;
+    std::deque<WORD> nackQueue;
+    PMutex nackMutex;
+    int rtxPayloadType;
+    DWORD rtxSyncSource;
+    WORD rtxSequenceNumber;
+    RTP_DataFrame rtxFrame;
+    DWORD packetsRetransmitted;
+    uint64_t retransmitTime;
+
+    bool pictureLoss;
+    int firSequenceNumber;
+
     std::map<WORD, RTP_DataFrame *> frameQueue;
+    std::vector<RTP_DataFrame *> framePool;
+    RTP_DataFrame * GetPoolFrame();
+    void   PutPoolFrame(RTP_DataFrame * frame);
     PTime  lastWriteTime;
     DWORD  lastRcvdTimeStamp;
     void   SetLastTimeRTPQueue();
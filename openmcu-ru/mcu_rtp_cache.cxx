@@ -9,6 +9,174 @@ PMutex cacheRTPListMutex;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+MCURtpHistory::MCURtpHistory()
+{
+  slots = new Slot[RTP_HISTORY_SIZE];
+  for(int i = 0; i < RTP_HISTORY_SIZE; ++i)
+  {
+    slots[i].index = 0;
+    slots[i].size = 0;
+  }
+  // 0 - пакет не сохранен
+  nextIndex = 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCURtpHistory::~MCURtpHistory()
+{
+  delete [] slots;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned MCURtpHistory::Put(const RTP_DataFrame & frame)
+{
+  PINDEX size = frame.GetHeaderSize() + frame.GetPayloadSize();
+  PWaitAndSignal m(mutex);
+  unsigned index = nextIndex++;
+  if(nextIndex == 0)
+    nextIndex = 1;
+  Slot & slot = slots[index & (RTP_HISTORY_SIZE-1)];
+  if(slot.data.GetSize() < size)
+    slot.data.SetSize(size);
+  memcpy(slot.data.GetPointer(), (const BYTE *)frame, size);
+  slot.size = size;
+  slot.index = index;
+  return index;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool MCURtpHistory::Get(unsigned index, RTP_DataFrame & frame)
+{
+  if(index == 0)
+    return false;
+  PWaitAndSignal m(mutex);
+  Slot & slot = slots[index & (RTP_HISTORY_SIZE-1)];
+  if(slot.index != index || slot.size == 0)
+    return false;
+  frame.SetMinSize(slot.size);
+  memcpy(frame.GetPointer(), (const BYTE *)slot.data, slot.size);
+  frame.SetPayloadSize(slot.size - frame.GetHeaderSize());
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCUKeyFrameArbiter::MCUKeyFrameArbiter()
+{
+  pendingTime = 0;
+  keyFrameTime = 0;
+  requestCount = 0;
+  mergedCount = 0;
+  deferredCount = 0;
+  forcedCount = 0;
+  keyFrameCount = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUKeyFrameArbiter::Request(const PString & source, bool recoverable)
+{
+  uint64_t now = MCUTime::GetMonoTimestampUsec();
+  uint64_t window = OpenMCU::Current().GetKeyFrameRequestWindow() * 1000;
+
+  PWaitAndSignal m(mutex);
+  requestCount++;
+
+  PString name = (source.IsEmpty() ? "mcu" : source);
+  SourceMap::iterator it = sources.find(name);
+  if(it == sources.end())
+  {
+    // ограничение списка, удаляется самый старый
+    if(sources.size() >= KEYFRAME_MAX_SOURCES)
+    {
+      SourceMap::iterator oldest = sources.begin();
+      for(SourceMap::iterator r = sources.begin(); r != sources.end(); ++r)
+      {
+        if(r->second.lastTime < oldest->second.lastTime)
+          oldest = r;
+      }
+      sources.erase(oldest);
+    }
+    Source s = { 0, 0, 0 };
+    it = sources.insert(SourceMap::value_type(name, s)).first;
+  }
+  Source & s = it->second;
+  s.requests++;
+  bool repeated = (s.lastTime != 0 && now - s.lastTime < KEYFRAME_REPEAT_TIME);
+  s.lastTime = now;
+
+  // потери восстанавливаются повтором пакетов
+  if(recoverable && !repeated)
+  {
+    s.deferred++;
+    deferredCount++;
+    return;
+  }
+
+  // запрос уже ожидает, или ключевой кадр только что отправлен
+  if(pendingTime != 0 || (keyFrameTime != 0 && now - keyFrameTime < window))
+  {
+    mergedCount++;
+    return;
+  }
+  pendingTime = now;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool MCUKeyFrameArbiter::Check()
+{
+  if(pendingTime == 0)
+    return false;
+
+  uint64_t now = MCUTime::GetMonoTimestampUsec();
+  uint64_t window = OpenMCU::Current().GetKeyFrameRequestWindow() * 1000;
+  uint64_t minInterval = OpenMCU::Current().GetKeyFrameMinInterval() * 1000;
+
+  PWaitAndSignal m(mutex);
+  if(pendingTime == 0 || now - pendingTime < window)
+    return false;
+  if(keyFrameTime != 0 && now - keyFrameTime < minInterval)
+    return false;
+  pendingTime = 0;
+  forcedCount++;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUKeyFrameArbiter::OnKeyFrame()
+{
+  PWaitAndSignal m(mutex);
+  keyFrameTime = MCUTime::GetMonoTimestampUsec();
+  keyFrameCount++;
+  // ожидающий запрос выполнен этим кадром
+  pendingTime = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUKeyFrameArbiter::WriteStatus(MCUJSONWriter & writer)
+{
+  PWaitAndSignal m(mutex);
+  writer.BeginObject();
+  writer.Value("requests", requestCount);
+  writer.Value("merged", mergedCount);
+  writer.Value("deferred", deferredCount);
+  writer.Value("forced", forcedCount);
+  writer.Value("keyframes", keyFrameCount);
+  writer.BeginObject("sources");
+  for(SourceMap::iterator it = sources.begin(); it != sources.end(); ++it)
+    writer.Value((const char *)it->first, it->second.requests);
+  writer.End();
+  writer.End();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 BOOL OpenAudioCache(const PString & room, const OpalMediaFormat & format, const PString & cacheName)
 {
   PWaitAndSignal m(cacheRTPListMutex);
@@ -121,7 +289,7 @@ void PutCacheRTP(CacheRTP *& cache, RTP_DataFrame & frame, unsigned int len, uns
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-bool GetCacheRTP(CacheRTP *& cache, RTP_DataFrame & frame, unsigned & toLen, unsigned & seqN, unsigned & flags)
+bool GetCacheRTP(CacheRTP *& cache, RTP_DataFrame & frame, unsigned & toLen, unsigned & seqN, unsigned & flags, unsigned * historyN)
 {
   if(!cache)
   {
@@ -131,7 +299,7 @@ bool GetCacheRTP(CacheRTP *& cache, RTP_DataFrame & frame, unsigned & toLen, uns
   }
   if(flags & PluginCodec_CoderForceIFrame)
     cache->OnFastUpdatePicture();
-  cache->GetFrame(frame, toLen, seqN, flags);
+  cache->GetFrame(frame, toLen, seqN, flags, historyN);
   return true;
   //cout << "GetCacheRTP length=" << toLen << " marker=" << frame.GetMarker() << " flags=" << flags  << "\n";
 }
@@ -146,7 +314,7 @@ bool AttachCacheRTP(CacheRTP *& cache, const PString & key, unsigned & encoderSe
   MCUTRACE(1, "CacheRTP " << key << " Attach");
   cache = it.GetCapturedObject();
   cache->IncrementUsersNumber();
-  encoderSeqN = cache->GetLastFrameNum();
+  encoderSeqN = cache->GetStartFrameNum();
   return true;
 }
 
@@ -12,6 +12,11 @@
 #define FRAME_BUF_SIZE	0x2000
 #define FRAME_OFFSET	0x100
 
+#define RTP_HISTORY_SIZE	0x200 // степень двойки
+
+#define KEYFRAME_REPEAT_TIME	2000000 // usec, повторный запрос при восстановлении по NACK
+#define KEYFRAME_MAX_SOURCES	64
+
 // cacheRTPListMutex - используется при создании кэшей
 // предотвращает создание в списке двух одноименных кэшей
 extern PMutex cacheRTPListMutex;
@@ -26,12 +31,81 @@ CacheRTP * CreateCacheRTP(const PString & key);
 void DeleteCacheRTP(CacheRTP *& cache);
 bool FindCacheRTP(const PString & key);
 void PutCacheRTP(CacheRTP *& cache, RTP_DataFrame & frame, unsigned int len, unsigned int flags);
-bool GetCacheRTP(CacheRTP *& cache, RTP_DataFrame & frame, unsigned & toLen, unsigned & seqN, unsigned & flags);
+bool GetCacheRTP(CacheRTP *& cache, RTP_DataFrame & frame, unsigned & toLen, unsigned & seqN, unsigned & flags, unsigned * historyN = NULL);
 bool AttachCacheRTP(CacheRTP *& cache, const PString & key, unsigned & encoderSeqN);
 void DetachCacheRTP(CacheRTP *& cache);
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// История отправленных пакетов для повторной передачи по NACK.
+// Для кэша одна история на всех получателей, пакеты хранятся с исходным заголовком,
+// номер последовательности и временную метку каждая сессия восстанавливает сама.
+class MCURtpHistory
+{
+  public:
+    MCURtpHistory();
+    ~MCURtpHistory();
+
+    // возвращает номер пакета в истории
+    unsigned Put(const RTP_DataFrame & frame);
+    bool Get(unsigned index, RTP_DataFrame & frame);
+
+  protected:
+    struct Slot
+    {
+      unsigned index;
+      PINDEX size;
+      PBYTEArray data;
+    };
+    Slot *slots;
+    unsigned nextIndex;
+    PMutex mutex;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Запросы ключевого кадра от получателей одного кодера (PLI/FIR/H.245 fast update).
+// Запросы внутри окна объединяются, между запрошенными ключевыми кадрами выдерживается
+// минимальный интервал. Если получатель восстанавливается по NACK, кадр формируется
+// только по повторному запросу от него.
+class MCUKeyFrameArbiter
+{
+  public:
+    MCUKeyFrameArbiter();
+
+    // source - имя получателя, пустое для внутренних запросов MCU
+    void Request(const PString & source, bool recoverable = false);
+
+    // вызывается кодером перед каждым кадром, true - нужен ключевой кадр
+    bool Check();
+
+    // кодер сформировал ключевой кадр (по запросу или по периоду)
+    void OnKeyFrame();
+
+    void WriteStatus(MCUJSONWriter & writer);
+
+  protected:
+    struct Source
+    {
+      unsigned requests;
+      unsigned deferred;
+      uint64_t lastTime;
+    };
+    typedef std::map<PString, Source> SourceMap;
+
+    PMutex mutex;
+    uint64_t pendingTime;  // 0 - нет запроса
+    uint64_t keyFrameTime;
+    unsigned requestCount;
+    unsigned mergedCount;
+    unsigned deferredCount;
+    unsigned forcedCount;
+    unsigned keyFrameCount;
+    SourceMap sources;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 class CacheRTP
 {
   public:
@@ -43,7 +117,8 @@ class CacheRTP
       lastN = 0;
       iframeN = 0;
       uN = 0;
-      fastUpdate = false;
+      suspended = false;
+      history = NULL;
     }
 
    ~CacheRTP()
@@ -55,6 +130,8 @@ class CacheRTP
         if(unit)
           delete unit;
       }
+      if(history)
+        delete history;
     }
 
     long GetID() const
@@ -63,30 +140,65 @@ class CacheRTP
     const PString & GetName() const
     { return name; }
 
-    void OnFastUpdatePicture()
-    { fastUpdate = true; }
+    void OnFastUpdatePicture(const PString & source = "", bool recoverable = false)
+    { keyFrameArbiter.Request(source, recoverable); }
+
+    MCUKeyFrameArbiter & GetKeyFrameArbiter()
+    { return keyFrameArbiter; }
+
+    // оценка битрейта получателя, 0 - нет ограничения или получатель отключен
+    void SetReaderBitRate(const void * reader, unsigned bitRate)
+    {
+      PWaitAndSignal m(readerMutex);
+      if(bitRate == 0)
+        readerBitRates.erase(reader);
+      else
+        readerBitRates[reader] = bitRate;
+    }
+
+    // битрейт общего кодера по самому медленному получателю
+    unsigned GetTargetBitRate()
+    {
+      PWaitAndSignal m(readerMutex);
+      unsigned bitRate = 0;
+      for(std::map<const void *, unsigned>::iterator it = readerBitRates.begin(); it != readerBitRates.end(); ++it)
+      {
+        if(bitRate == 0 || it->second < bitRate)
+          bitRate = it->second;
+      }
+      return bitRate;
+    }
+
+    // история создается при подключении первого получателя с NACK
+    MCURtpHistory * GetHistory()
+    {
+      PWaitAndSignal m(historyMutex);
+      if(history == NULL)
+      {
+        MCUTRACE(1, "CacheRTP " << name << " retransmission history enabled");
+        history = new MCURtpHistory();
+      }
+      return history;
+    }
 
     bool GetMarker (unsigned char *pkt)
     { return (pkt[1] & 0x80); }
 
     void IncrementUsersNumber()
-    { uN++; }
+    { PWaitAndSignal m(suspendMutex); uN++; }
 
     void DecrementUsersNumber()
-    { uN--; }
+    { PWaitAndSignal m(suspendMutex); uN--; }
 
     unsigned GetUsersNumber() const
     { return uN; }
 
     void GetFastUpdate(unsigned & flags)
     {
-      if(!fastUpdate)
-        return;
-      if(seqN - iframeN <= FRAME_OFFSET * 10)
+      if(!keyFrameArbiter.Check())
         return;
       MCUTRACE(1, "CacheRTP " << name << " FastUpdate needed");
       flags |= PluginCodec_CoderForceIFrame;
-      fastUpdate = false;
     }
 
     unsigned int GetLastFrameNum()
@@ -97,6 +209,74 @@ class CacheRTP
       return 0;
     }
 
+    // номер пакета, с которого начинает новый получатель,
+    // после приостановки - сохраненный ключевой кадр
+    unsigned int GetStartFrameNum()
+    {
+      PWaitAndSignal m(suspendMutex);
+      if(suspended && unitList.find(iframeN) != unitList.end())
+        return iframeN;
+      if(unitList.empty())
+        return seqN;
+      return GetLastFrameNum();
+    }
+
+    // вызывается потоком кодера, когда нет получателей: буфер и история освобождаются,
+    // остается последний полный ключевой кадр для мгновенной картинки при возобновлении
+    bool Suspend()
+    {
+      PWaitAndSignal m(suspendMutex);
+      if(uN != 0)
+        return false;
+
+      // кодер остановлен посреди кадра
+      if(seqN & ~FRAME_MASK)
+        seqN = (seqN & FRAME_MASK) + FRAME_OFFSET;
+
+      unsigned iframeEnd = (iframeN & FRAME_MASK) + FRAME_OFFSET;
+      bool complete = false;
+      for(CacheRTPUnitMap::iterator r = unitList.begin(); r != unitList.end(); )
+      {
+        if(iframeN != 0 && r->first >= iframeN && r->first < iframeEnd)
+        {
+          r->second->lock = 0;
+          r->second->historyN = 0;
+          complete = GetMarker(r->second->frame.GetPointer());
+          ++r;
+          continue;
+        }
+        CacheRTPUnit *unit = r->second;
+        unitList.erase(r++);
+        if(unit)
+          delete unit;
+      }
+      if(!complete || unitList.find(iframeN) == unitList.end())
+      {
+        for(CacheRTPUnitMap::iterator r = unitList.begin(); r != unitList.end(); )
+        {
+          CacheRTPUnit *unit = r->second;
+          unitList.erase(r++);
+          if(unit)
+            delete unit;
+        }
+      }
+      // сохраненный кадр не занимается под новые пакеты, удаляется при следующей приостановке
+      lastN = seqN;
+      suspended = true;
+
+      {
+        PWaitAndSignal mh(historyMutex);
+        if(history)
+        {
+          delete history;
+          history = NULL;
+        }
+      }
+
+      MCUTRACE(1, "CacheRTP " << name << " suspended, keyframe " << (unitList.empty() ? "not kept" : "kept"));
+      return true;
+    }
+
     void PutFrame(RTP_DataFrame & frame, unsigned len, unsigned flags)
     {
       CacheRTPUnit *unit;
@@ -116,12 +296,15 @@ class CacheRTP
       unit->PutFrame(frame);
       unit->len = len;
       unit->lock = 0;
+      unit->historyN = (history ? history->Put(frame) : 0);
       unitList.insert(CacheRTPUnitMap::value_type(seqN, unit));
       //MCUTRACE(6, "CacheRTP " << name << " put frame " << seqN);
       if(flags & PluginCodec_ReturnCoderIFrame && seqN > (iframeN & FRAME_MASK) + FRAME_OFFSET)
       {
         iframeN = seqN;
+        suspended = false;
         MCUTRACE(6, "CacheRTP " << name << " new iframe " << iframeN);
+        keyFrameArbiter.OnKeyFrame();
       }
       if(GetMarker(frame.GetPointer()))
       {
@@ -140,7 +323,7 @@ class CacheRTP
         seqN++;
     }
 
-    void GetFrame(RTP_DataFrame & frame, unsigned & toLen, unsigned & num, unsigned & flags)
+    void GetFrame(RTP_DataFrame & frame, unsigned & toLen, unsigned & num, unsigned & flags, unsigned * historyN = NULL)
     {
       while(num >= seqN)
         MCUTime::Sleep(10);
@@ -161,6 +344,8 @@ class CacheRTP
       }
       r->second->GetFrame(frame);
       toLen = r->second->len;
+      if(historyN)
+        *historyN = r->second->historyN;
       flags = 0;
       if(GetMarker(frame.GetPointer()))
         flags |= PluginCodec_ReturnCoderLastFrame;
@@ -176,8 +361,17 @@ class CacheRTP
     unsigned seqN;
     unsigned lastN;
     unsigned iframeN;
-    bool fastUpdate;
     unsigned uN;
+    bool suspended;
+    PMutex suspendMutex;
+
+    MCUKeyFrameArbiter keyFrameArbiter;
+
+    std::map<const void *, unsigned> readerBitRates;
+    PMutex readerMutex;
+
+    MCURtpHistory * volatile history;
+    PMutex historyMutex;
 
     class CacheRTPUnit
     {
@@ -204,6 +398,7 @@ class CacheRTP
 
         int lock;
         unsigned int len;
+        unsigned int historyN;
         RTP_DataFrame frame;
     };
     typedef std::map<unsigned int, CacheRTPUnit *> CacheRTPUnitMap;
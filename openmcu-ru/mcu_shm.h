@@ -0,0 +1,260 @@
+/*
+ * mcu_shm.h
+ *
+ * Shared memory export of the room audio/video, the ring layout and the reference reader.
+ * The file does not depend on the MCU headers, external programs include it as is.
+ *
+ * Ring: /dev/shm/openmcu_<audio|video>_<room>, see mcu_shm_make_name() for the room names
+ * with other characters than [A-Za-z0-9_.-]
+ *
+ *   MCUShmHeader | slot 0 | slot 1 | ... | slot N-1
+ *   slot: MCUShmSlot | data
+ *
+ * The writer never waits for readers, the oldest slot is overwritten. A frame N is in the slot
+ * N % slot_count, the slot sequence is 0 while the slot is being written. The reader copies
+ * the data and checks that the slot sequence did not change, otherwise the frame is lost.
+ *
+ * Reader:
+ *
+ *   MCUShmReader reader;
+ *   if(mcu_shm_reader_open(&reader, "openmcu_video_101") == 0)
+ *     while((size = mcu_shm_reader_read(&reader, buffer, sizeof(buffer), &timestamp)) >= 0)
+ *       if(size == 0) usleep(5000); else ...
+ *   mcu_shm_reader_close(&reader);
+ *
+ */
+
+#ifndef _MCU_SHM_H
+#define _MCU_SHM_H
+
+#include <stdint.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#define MCU_SHM_MAGIC         0x4d435348 // MCSH
+#define MCU_SHM_VERSION       1
+#define MCU_SHM_ALIGN         64
+
+#define MCU_SHM_MEDIA_AUDIO   1
+#define MCU_SHM_MEDIA_VIDEO   2
+
+#define MCU_SHM_FOURCC(a,b,c,d) ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+#define MCU_SHM_FORMAT_S16LE  MCU_SHM_FOURCC('S','1','6','L') // PCM, interleaved channels
+#define MCU_SHM_FORMAT_I420   MCU_SHM_FOURCC('I','4','2','0') // YUV420P
+
+#define MCU_SHM_STATE_RUNNING 1
+#define MCU_SHM_STATE_CLOSED  2 // the writer is gone, reopen the ring
+
+#if defined(__GNUC__)
+#define MCU_SHM_BARRIER() __sync_synchronize()
+#else
+#define MCU_SHM_BARRIER()
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+typedef struct MCUShmHeader
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t header_size;      // offset of the first slot
+  uint32_t slot_size;        // MCUShmSlot + data, aligned
+  uint32_t slot_count;
+  uint32_t media;            // MCU_SHM_MEDIA_*
+  uint32_t format;           // MCU_SHM_FORMAT_*
+  uint32_t width;            // video
+  uint32_t height;
+  uint32_t frame_rate;
+  uint32_t sample_rate;      // audio
+  uint32_t channels;
+  uint32_t writer_pid;
+  volatile uint32_t state;   // MCU_SHM_STATE_*
+  volatile uint64_t write_seq; // the last complete frame, 0 - no frames yet
+} MCUShmHeader;
+
+typedef struct MCUShmSlot
+{
+  volatile uint64_t seq;     // frame sequence, 0 - being written
+  uint64_t timestamp;        // usec, monotonic clock of the MCU
+  uint32_t size;             // bytes of data
+  uint32_t reserved;
+} MCUShmSlot;
+
+#define MCU_SHM_HEADER_SIZE   ((sizeof(MCUShmHeader) + MCU_SHM_ALIGN - 1) / MCU_SHM_ALIGN * MCU_SHM_ALIGN)
+#define MCU_SHM_SLOT_SIZE(data_size) ((sizeof(MCUShmSlot) + (data_size) + MCU_SHM_ALIGN - 1) / MCU_SHM_ALIGN * MCU_SHM_ALIGN)
+
+static inline MCUShmSlot * mcu_shm_slot(MCUShmHeader *header, uint64_t seq)
+{
+  return (MCUShmSlot *)((uint8_t *)header + header->header_size + (seq % header->slot_count) * header->slot_size);
+}
+
+#define MCU_SHM_NAME_SIZE     128
+
+// The ring name without the leading slash: the characters except [A-Za-z0-9_.-] are replaced by '_'.
+// The name changed by the replacement or cut to the size gets "_<FNV-1a hash of the original>",
+// so "openmcu_video_a b" and "openmcu_video_a_b" do not share a ring.
+// A name of the allowed characters is returned as is.
+static inline void mcu_shm_make_name(char *dst, const char *name)
+{
+  const size_t max_len = MCU_SHM_NAME_SIZE - 10; // "_" + 8 hex digits + 0
+  uint32_t hash = 2166136261U;
+  size_t len = 0;
+  int changed = 0;
+  const char *p;
+  for(p = name; *p; p++)
+  {
+    unsigned char c = (unsigned char)*p;
+    hash = (hash ^ c) * 16777619U;
+    if(len == max_len)
+    {
+      changed = 1;
+      continue;
+    }
+    if((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-' || c == '.')
+      dst[len++] = c;
+    else
+    {
+      dst[len++] = '_';
+      changed = 1;
+    }
+  }
+  dst[len] = 0;
+  if(changed)
+  {
+    static const char hex[] = "0123456789abcdef";
+    int i;
+    dst[len++] = '_';
+    for(i = 7; i >= 0; i--)
+      dst[len++] = hex[(hash >> (i * 4)) & 0xf];
+    dst[len] = 0;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WIN32
+
+typedef struct MCUShmReader
+{
+  int fd;
+  size_t map_size;
+  MCUShmHeader *header;
+  uint64_t seq;              // the last frame read
+  uint64_t lost;             // frames overwritten before they were read
+} MCUShmReader;
+
+// returns 0 on success
+// name - the room ring name as is, mcu_shm_make_name() is applied
+static inline int mcu_shm_reader_open(MCUShmReader *reader, const char *name)
+{
+  char path[MCU_SHM_NAME_SIZE + 1];
+  struct stat st;
+  void *map;
+  memset(reader, 0, sizeof(MCUShmReader));
+  reader->fd = -1;
+
+  path[0] = '/';
+  mcu_shm_make_name(path + 1, name);
+  reader->fd = shm_open(path, O_RDONLY, 0);
+  if(reader->fd < 0)
+    return -1;
+  if(fstat(reader->fd, &st) < 0 || (size_t)st.st_size < MCU_SHM_HEADER_SIZE)
+    goto error;
+
+  map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, reader->fd, 0);
+  if(map == MAP_FAILED)
+    goto error;
+  reader->map_size = st.st_size;
+  reader->header = (MCUShmHeader *)map;
+  if(reader->header->magic != MCU_SHM_MAGIC || reader->header->version != MCU_SHM_VERSION ||
+     reader->header->header_size + (size_t)reader->header->slot_size * reader->header->slot_count > reader->map_size)
+    goto error;
+
+  // the reader starts from the newest frame
+  reader->seq = reader->header->write_seq;
+  return 0;
+
+  error:
+    if(reader->header)
+      munmap(reader->header, reader->map_size);
+    close(reader->fd);
+    memset(reader, 0, sizeof(MCUShmReader));
+    reader->fd = -1;
+    return -1;
+}
+
+// returns the frame size, 0 - no new frame, -1 - the ring is closed or the buffer is too small
+static inline int mcu_shm_reader_read(MCUShmReader *reader, void *buf, uint32_t buf_size, uint64_t *timestamp)
+{
+  MCUShmHeader *header = reader->header;
+  for(;;)
+  {
+    uint64_t write_seq, seq;
+    uint32_t size;
+    MCUShmSlot *slot;
+
+    if(header->state == MCU_SHM_STATE_CLOSED)
+      return -1;
+    write_seq = header->write_seq;
+    MCU_SHM_BARRIER();
+    if(write_seq <= reader->seq)
+      return 0;
+
+    // the reader is too slow, the oldest frames are overwritten
+    seq = reader->seq + 1;
+    if(write_seq - seq >= header->slot_count - 1)
+    {
+      reader->lost += write_seq - seq;
+      seq = write_seq;
+    }
+
+    slot = mcu_shm_slot(header, seq);
+    if(slot->seq != seq)
+    {
+      reader->lost++;
+      reader->seq = seq;
+      continue;
+    }
+    MCU_SHM_BARRIER();
+    size = slot->size;
+    if(size > buf_size || size > header->slot_size - sizeof(MCUShmSlot))
+      return -1;
+    memcpy(buf, (uint8_t *)slot + sizeof(MCUShmSlot), size);
+    if(timestamp)
+      *timestamp = slot->timestamp;
+    MCU_SHM_BARRIER();
+
+    // overwritten while copying
+    reader->seq = seq;
+    if(slot->seq != seq)
+    {
+      reader->lost++;
+      continue;
+    }
+    return (int)size;
+  }
+}
+
+static inline void mcu_shm_reader_close(MCUShmReader *reader)
+{
+  if(reader->header)
+    munmap(reader->header, reader->map_size);
+  if(reader->fd >= 0)
+    close(reader->fd);
+  memset(reader, 0, sizeof(MCUShmReader));
+  reader->fd = -1;
+}
+
+#endif // _WIN32
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#endif // _MCU_SHM_H
@@ -69,6 +69,15 @@ AVCodecID GetCodecId(int media_type, PString codec_name)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void SetCodecExtradata(AVCodecContext *context, const BYTE * data, PINDEX size)
+{
+  context->extradata = (uint8_t *)av_mallocz(size + AV_INPUT_BUFFER_PADDING_SIZE);
+  memcpy(context->extradata, data, size);
+  context->extradata_size = size;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 ConferenceRecorder::ConferenceRecorder(Conference *_conference)
   : ConferenceMember(_conference)
 {
@@ -95,6 +104,18 @@ void ConferenceRecorder::Close()
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+PString ConferenceRecorder::GetMonitorInfo(const PString & hdr)
+{
+  PWaitAndSignal m(mutex);
+  PStringStream output;
+  if(writer)
+    output << writer->GetMonitorInfo(hdr)
+           << hdr << "Video dropped: " << video_dropped << "\n";
+  return output;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void ConferenceRecorder::Reset()
 {
   running = FALSE;
@@ -104,6 +125,35 @@ void ConferenceRecorder::Reset()
   audio_frame_count = 0;
   video_frame_count = 0;
 
+  segment_duration = 0;
+
+  writer = NULL;
+  write_queue_size = 0;
+  write_direct = FALSE;
+  video_dropping = FALSE;
+  video_drop_keyframe = FALSE;
+  video_dropped = 0;
+
+  remux_audio = FALSE;
+  remux_video = FALSE;
+  audio_cache = NULL;
+  video_cache = NULL;
+  audio_cache_seqn = 0;
+  video_cache_seqn = 0;
+  video_cache_last = 0xFFFFFFFF;
+  audio_clock = 0;
+  audio_frame_time = 0;
+  audio_pts = -1;
+  video_pts = -1;
+  remux_start_time = 0;
+  video_au_size = 0;
+  video_au_pts = 0;
+  video_au_keyframe = FALSE;
+  video_au_lost = FALSE;
+  video_wait_keyframe = TRUE;
+  video_params_size = 0;
+  video_extradata.SetSize(0);
+
 #if USE_SWRESAMPLE || USE_AVRESAMPLE
   swrc = NULL;
 #endif
@@ -147,6 +197,10 @@ void ConferenceRecorder::Stop()
     av_write_trailer(fmt_context);
   }
 
+  // detach the room cache
+  DetachCacheRTP(audio_cache);
+  DetachCacheRTP(video_cache);
+
   avcodecMutex.Wait();
   if(audio_st)
     avcodec_close(audio_st->codec);
@@ -156,14 +210,16 @@ void ConferenceRecorder::Stop()
 
   if(fmt_context)
   {
-    // close the output file
-    if(fmt_context->pb && fmt_context->oformat && !(fmt_context->oformat->flags & AVFMT_NOFILE))
-      avio_close(fmt_context->pb);
+    CloseOutput();
 
     // free the stream
     avformat_free_context(fmt_context);
   }
 
+  // the session file is assembled from the segments in the background
+  if(segment_duration > 0 && (thread_audio || thread_video))
+    new RecorderConcatThread(manifest, filename);
+
 #if USE_SWRESAMPLE
   if(swrc)
     swr_free(&swrc);
@@ -199,19 +255,8 @@ void ConferenceRecorder::Stop()
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-BOOL ConferenceRecorder::Start()
+void ConferenceRecorder::LoadSettings(MCUConfig & cfg)
 {
-  PWaitAndSignal m(mutex);
-
-  if(conference == NULL)
-    return FALSE;
-
-  if(IsRunning() == TRUE)
-    return TRUE;
-
-  OpenMCU & mcu = OpenMCU::Current();
-  MCUConfig cfg("Parameters");
-
   // video
   PString res = cfg.GetString(RecorderResolutionKey, PString(DefaultRecorderFrameWidth)+"x"+PString(DefaultRecorderFrameHeight));
   video_width = res.Tokenise("x")[0].AsInteger();
@@ -250,6 +295,23 @@ BOOL ConferenceRecorder::Start()
   if(audio_channels < 1)      { audio_channels = 1; PTRACE(1, trace_section << "audio channels changed to 1"); }
   else if(audio_channels > 8) { audio_channels = 8; PTRACE(1, trace_section << "audio channels changed to 8"); }
   audio_bitrate = 64;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL ConferenceRecorder::Start()
+{
+  PWaitAndSignal m(mutex);
+
+  if(conference == NULL)
+    return FALSE;
+
+  if(IsRunning() == TRUE)
+    return TRUE;
+
+  OpenMCU & mcu = OpenMCU::Current();
+  MCUConfig cfg("Parameters");
+  LoadSettings(cfg);
 
   // codecs
   audio_codec_id = GetCodecId(0, cfg.GetString(RecorderAudioCodecKey, RecorderDefaultAudioCodec));
@@ -260,6 +322,10 @@ BOOL ConferenceRecorder::Start()
     return FALSE;
   }
 
+  // encoded streams of the room cache, no extra encoders
+  if(cfg.GetBoolean(RecorderRemuxKey, FALSE))
+    FindRemuxCaches();
+
   // file format: room101__2013-0516-1058270__704x576x10
   PStringStream t;
   t << mcu.vr_ffmpegDir << PATH_SEPARATOR
@@ -269,10 +335,38 @@ BOOL ConferenceRecorder::Start()
     << video_height << "x"
     << video_framerate;
   filename = t;
-  if((video_codec_id == AV_CODEC_ID_MPEG4 || video_codec_id == AV_CODEC_ID_MSMPEG4V3) && audio_codec_id != AV_CODEC_ID_PCM_S16LE)
+  if(remux_audio || remux_video)
+    format_name = "mkv";
+  else if((video_codec_id == AV_CODEC_ID_MPEG4 || video_codec_id == AV_CODEC_ID_MSMPEG4V3) && audio_codec_id != AV_CODEC_ID_PCM_S16LE)
     format_name = "asf";
   else
     format_name = "mkv";
+
+  // segments and the manifest: room101__2013-0516-1058270__704x576x10_00000.mp4, room101__...ffconcat
+  segment_duration = cfg.GetInteger(RecorderSegmentKey, 0);
+  if(segment_duration > RECORDER_SEGMENT_MAX)
+    segment_duration = RECORDER_SEGMENT_MAX;
+  if(segment_duration > 0)
+  {
+    // fragmented mp4 when the codecs fit, otherwise matroska clusters
+    if((video_codec_id == AV_CODEC_ID_NONE || video_codec_id == AV_CODEC_ID_H264 || video_codec_id == AV_CODEC_ID_MPEG4) &&
+       (audio_codec_id == AV_CODEC_ID_NONE || audio_codec_id == AV_CODEC_ID_AC3))
+    {
+      segment_format = "mp4";
+      format_name = "mp4";
+    } else {
+      segment_format = "matroska";
+      format_name = "mkv";
+    }
+    segment_pattern = filename + "_%05d." + format_name;
+    manifest = filename + ".ffconcat";
+  }
+
+  // the file is written by a separate thread, the segment muxer writes its files itself
+  write_queue_size = cfg.GetInteger(RecorderWriteQueueKey, RECORDER_WRITE_QUEUE_DEFAULT);
+  if(write_queue_size > RECORDER_WRITE_QUEUE_MAX)
+    write_queue_size = RECORDER_WRITE_QUEUE_MAX;
+  write_direct = cfg.GetBoolean(RecorderDirectIOKey, FALSE);
   filename += "."+format_name;
 
   //
@@ -283,14 +377,21 @@ BOOL ConferenceRecorder::Start()
     return FALSE;
   }
 
+  StartThreads();
+
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ConferenceRecorder::StartThreads()
+{
   startTime = PTime();
 
   if(audio_st)
     thread_audio = PThread::Create(PCREATE_NOTIFIER(RecorderAudio), 0, PThread::NoAutoDeleteThread, PThread::NormalPriority, "conference_recorder:%0x");
   if(video_st)
     thread_video = PThread::Create(PCREATE_NOTIFIER(RecorderVideo), 0, PThread::NoAutoDeleteThread, PThread::NormalPriority, "conference_recorder:%0x");
-
-  return TRUE;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -304,7 +405,19 @@ BOOL ConferenceRecorder::InitRecorder()
 
   // allocate the output media context
   fmt_context = avformat_alloc_context();
-  fmt_context->oformat = av_guess_format(format_name, filename, NULL);
+  if(segment_duration > 0)
+  {
+    fmt_context->oformat = av_guess_format("segment", NULL, NULL);
+    if(fmt_context->oformat == NULL)
+    {
+      MCUTRACE(1, trace_section << "segment muxer not found, recording to a single file");
+      segment_duration = 0;
+    }
+    else
+      strncpy(fmt_context->filename, segment_pattern, sizeof(fmt_context->filename)-1);
+  }
+  if(fmt_context->oformat == NULL)
+    fmt_context->oformat = av_guess_format(format_name, filename, NULL);
   if(fmt_context->oformat == NULL)
   {
     MCUTRACE(1, trace_section << "could not allocate the output context");
@@ -314,26 +427,26 @@ BOOL ConferenceRecorder::InitRecorder()
   fmt_context->oformat->audio_codec = audio_codec_id;
   fmt_context->oformat->video_codec = video_codec_id;
 
-  audio_st = AddStream(AVMEDIA_TYPE_AUDIO);
-  video_st = AddStream(AVMEDIA_TYPE_VIDEO);
+  audio_st = (remux_audio ? AddRemuxStream(AVMEDIA_TYPE_AUDIO) : AddStream(AVMEDIA_TYPE_AUDIO));
+  video_st = (remux_video ? AddRemuxStream(AVMEDIA_TYPE_VIDEO) : AddStream(AVMEDIA_TYPE_VIDEO));
 
-  if(audio_st && OpenAudio() == FALSE)
+  if(audio_st && !remux_audio && OpenAudio() == FALSE)
     return FALSE;
-  if(video_st && OpenVideo() == FALSE)
+  if(video_st && !remux_video && OpenVideo() == FALSE)
     return FALSE;
 
   av_dump_format(fmt_context, 0, filename, 1);
 
-  // open the output file
-  ret = avio_open(&fmt_context->pb, filename, AVIO_FLAG_WRITE);
-  if(ret < 0)
+  AVDictionary *options = NULL;
+  if(OpenOutput(&options) == FALSE)
   {
-    MCUTRACE(1, trace_section << "could not open " << filename << " " << ret << " " << AVErrorToString(ret));
+    av_dict_free(&options);
     return FALSE;
   }
 
   // write the stream header
-  ret = avformat_write_header(fmt_context, NULL);
+  ret = avformat_write_header(fmt_context, &options);
+  av_dict_free(&options);
   if(ret < 0)
   {
     MCUTRACE(1, trace_section << "error occurred when opening output file: " << ret << " " << AVErrorToString(ret));
@@ -345,6 +458,81 @@ BOOL ConferenceRecorder::InitRecorder()
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+BOOL ConferenceRecorder::OpenOutput(AVDictionary **options)
+{
+  // open the output file, the segment muxer opens its own files
+  if(!(fmt_context->oformat->flags & AVFMT_NOFILE) && write_queue_size > 0)
+  {
+    writer = new RecorderWriter(filename, write_queue_size << 20, write_direct);
+    if(writer->Open() == FALSE)
+    {
+      MCUTRACE(1, trace_section << "could not open " << filename);
+      delete writer;
+      writer = NULL;
+      return FALSE;
+    }
+    unsigned char *buffer = (unsigned char *)av_malloc(RECORDER_IO_BUFFER_SIZE);
+    fmt_context->pb = avio_alloc_context(buffer, RECORDER_IO_BUFFER_SIZE, 1, writer, NULL, &RecorderWriter::WriteData, &RecorderWriter::SeekData);
+    if(fmt_context->pb == NULL)
+    {
+      av_free(buffer);
+      MCUTRACE(1, trace_section << "could not allocate the output buffer");
+      return FALSE;
+    }
+    fmt_context->flags |= AVFMT_FLAG_CUSTOM_IO;
+  }
+  else if(!(fmt_context->oformat->flags & AVFMT_NOFILE))
+  {
+    int ret = avio_open(&fmt_context->pb, filename, AVIO_FLAG_WRITE);
+    if(ret < 0)
+    {
+      MCUTRACE(1, trace_section << "could not open " << filename << " " << ret << " " << AVErrorToString(ret));
+      return FALSE;
+    }
+  }
+
+  if(segment_duration > 0)
+  {
+    av_dict_set(options, "segment_time", PString(segment_duration), 0);
+    av_dict_set(options, "segment_format", segment_format, 0);
+    av_dict_set(options, "segment_list", manifest, 0);
+    av_dict_set(options, "segment_list_type", "ffconcat", 0);
+    av_dict_set(options, "reset_timestamps", "1", 0);
+    // fragments are written as they come, after a crash the segment is readable up to the last one
+    if(segment_format == "mp4")
+      av_dict_set(options, "segment_format_options", "movflags=frag_keyframe+empty_moov", 0);
+  }
+
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ConferenceRecorder::CloseOutput()
+{
+  // the queue is written before the file is closed
+  if(writer)
+  {
+    if(fmt_context->pb)
+    {
+      avio_flush(fmt_context->pb);
+      av_free(fmt_context->pb->buffer);
+      av_free(fmt_context->pb);
+      fmt_context->pb = NULL;
+    }
+    writer->Close();
+    delete writer;
+    writer = NULL;
+    return;
+  }
+
+  // close the output file
+  if(fmt_context->pb && fmt_context->oformat && !(fmt_context->oformat->flags & AVFMT_NOFILE))
+    avio_close(fmt_context->pb);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 AVStream * ConferenceRecorder::AddStream(AVMediaType codec_type)
 {
   AVStream *st = NULL;
@@ -391,6 +579,8 @@ AVStream * ConferenceRecorder::AddStream(AVMediaType codec_type)
     context->time_base.num = 12 * 16000 / context->sample_rate;
     context->time_base.den = 125;
     //context->strict_std_compliance = -2;
+    if(codec->id == AV_CODEC_ID_AAC)
+      context->strict_std_compliance = FF_COMPLIANCE_EXPERIMENTAL;
   }
   else if(codec_type == AVMEDIA_TYPE_VIDEO)
   {
@@ -418,7 +608,7 @@ AVStream * ConferenceRecorder::AddStream(AVMediaType codec_type)
   }
 
   // Some formats want stream headers to be separate
-  if(fmt_context->oformat->flags & AVFMT_GLOBALHEADER)
+  if((fmt_context->oformat->flags & AVFMT_GLOBALHEADER) || segment_duration > 0)
     context->flags |= CODEC_FLAG_GLOBAL_HEADER;
 
   return st;
@@ -430,6 +620,37 @@ int ConferenceRecorder::WritePacket(AVStream *st, AVPacket *pkt)
 {
   int ret = 0;
 
+  // the storage does not keep up, the video is dropped and the audio is kept
+  if(writer && st == video_st)
+  {
+    unsigned queue_percent = writer->GetQueuePercent();
+    if(queue_percent >= 75 && !video_dropping)
+    {
+      MCUTRACE(1, trace_section << "write queue " << queue_percent << "%, dropping video");
+      video_dropping = TRUE;
+      video_drop_keyframe = FALSE;
+    }
+    if(video_dropping)
+    {
+      // resume from a keyframe when the queue is drained
+      if(queue_percent < 50 && (pkt->flags & AV_PKT_FLAG_KEY))
+      {
+        MCUTRACE(1, trace_section << "write queue " << queue_percent << "%, video resumed, dropped " << video_dropped);
+        video_dropping = FALSE;
+      }
+      else
+      {
+        if(queue_percent < 50 && remux_video && !video_drop_keyframe)
+        {
+          video_cache->OnFastUpdatePicture("recorder");
+          video_drop_keyframe = TRUE;
+        }
+        video_dropped++;
+        return 0;
+      }
+    }
+  }
+
   pkt->stream_index = st->index;
   pkt->pts = av_rescale_q(pkt->pts, st->codec->time_base, st->time_base);
   pkt->dts = AV_NOPTS_VALUE;
@@ -741,6 +962,18 @@ void ConferenceRecorder::RecorderAudio(PThread &, INT)
 {
   MCUTRACE(1, trace_section << "audio thread started");
 
+  if(remux_audio)
+  {
+    // the cache delivers frames at the encoder rate
+    audio_cache_seqn = audio_cache->GetLastFrameNum();
+    running = TRUE;
+    while(running)
+      WriteRemuxAudio();
+    running = FALSE;
+    MCUTRACE(1, trace_section << "audio thread ended");
+    return;
+  }
+
   unsigned delay_us = av_q2d(audio_st->codec->time_base)*1000000;
   if(delay_us <= 1000)
     delay_us = src_samples*1000000/audio_samplerate;
@@ -764,6 +997,17 @@ void ConferenceRecorder::RecorderVideo(PThread &, INT)
 {
   MCUTRACE(1, trace_section << "video thread started");
 
+  if(remux_video)
+  {
+    firstFrameSendTime = PTime();
+    running = TRUE;
+    while(running)
+      WriteRemuxVideo();
+    running = FALSE;
+    MCUTRACE(1, trace_section << "video thread ended");
+    return;
+  }
+
   unsigned delay_us = av_q2d(video_st->codec->time_base)*1000000;
   if(delay_us <= 1000)
     delay_us = 1000000/video_framerate;
@@ -784,3 +1028,1008 @@ void ConferenceRecorder::RecorderVideo(PThread &, INT)
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ConferenceRecorder::FindRemuxCaches()
+{
+  remux_start_time = MCUTime::GetMonoTimestampUsec();
+
+  PString video_cache_name;
+  OpalMediaFormat video_format;
+  AVCodecID video_remux_id = AV_CODEC_ID_NONE;
+
+  MCUMemberList & memberList = conference->GetMemberList();
+  for(MCUMemberList::shared_iterator it = memberList.begin(); it != memberList.end(); ++it)
+  {
+    ConferenceMember *member = *it;
+    if(member->GetType() != MEMBER_TYPE_CACHE)
+      continue;
+    ConferenceCacheMember *cacheMember = (ConferenceCacheMember *)member;
+    const OpalMediaFormat & format = cacheMember->GetCacheFormat();
+    PString name = format;
+
+    if(format.GetDefaultSessionID() == OpalMediaFormat::DefaultAudioSessionID)
+    {
+      if(remux_audio || audio_codec_id == AV_CODEC_ID_NONE)
+        continue;
+      AVCodecID codec_id = AV_CODEC_ID_NONE;
+      unsigned channels = format.GetOptionInteger(OPTION_ENCODER_CHANNELS, 1);
+      if(name.ToUpper().Find("OPUS") == 0 && channels <= 2)
+        codec_id = AV_CODEC_ID_OPUS;
+      else if(name.Find("G.722-64k") == 0)
+        codec_id = AV_CODEC_ID_ADPCM_G722;
+      if(codec_id == AV_CODEC_ID_NONE || !CanRemux(codec_id))
+        continue;
+      if(!AttachCacheRTP(audio_cache, cacheMember->GetCacheName(), audio_cache_seqn))
+        continue;
+      remux_audio = TRUE;
+      audio_codec_id = codec_id;
+      audio_clock = format.GetTimeUnits() * 1000;
+      audio_frame_time = format.GetFrameTime();
+      audio_channels = channels;
+      audio_samplerate = (codec_id == AV_CODEC_ID_OPUS ? 48000 : 16000);
+      MCUTRACE(1, trace_section << "audio from cache " << cacheMember->GetCacheName());
+    }
+    else if(format.GetDefaultSessionID() == OpalMediaFormat::DefaultVideoSessionID)
+    {
+      if(video_remux_id != AV_CODEC_ID_NONE || video_codec_id == AV_CODEC_ID_NONE)
+        continue;
+      // the same layout as the encoded recording
+      if(cacheMember->GetVideoMixerNumber() != GetVideoMixerNumber())
+        continue;
+      if(name.Find("H.264") == 0)
+        video_remux_id = AV_CODEC_ID_H264;
+      else if(name.Find("VP8") == 0)
+        video_remux_id = AV_CODEC_ID_VP8;
+      else
+        continue;
+      if(!CanRemux(video_remux_id))
+      {
+        video_remux_id = AV_CODEC_ID_NONE;
+        continue;
+      }
+      video_cache_name = cacheMember->GetCacheName();
+      video_format = format;
+    }
+  }
+
+  if(video_remux_id == AV_CODEC_ID_NONE)
+    return;
+  if(!AttachCacheRTP(video_cache, video_cache_name, video_cache_seqn))
+    return;
+
+  AVCodecID codec_id = video_codec_id;
+  video_codec_id = video_remux_id;
+  if(OpenRemuxVideo() == FALSE)
+  {
+    MCUTRACE(1, trace_section << "no keyframe from cache " << video_cache_name << ", video is encoded");
+    DetachCacheRTP(video_cache);
+    video_codec_id = codec_id;
+    return;
+  }
+
+  remux_video = TRUE;
+  video_width = video_format.GetOptionInteger(OPTION_FRAME_WIDTH, video_width);
+  video_height = video_format.GetOptionInteger(OPTION_FRAME_HEIGHT, video_height);
+  unsigned frame_time = video_format.GetOptionInteger(OPTION_FRAME_TIME, 0);
+  if(frame_time > 0)
+    video_framerate = 90000 / frame_time;
+  MCUTRACE(1, trace_section << "video from cache " << video_cache_name);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL ConferenceRecorder::OpenRemuxVideo()
+{
+  // the recording starts from a keyframe, SPS/PPS of H.264 go to the stream header
+  video_wait_keyframe = TRUE;
+  video_cache->OnFastUpdatePicture("recorder");
+
+  while(MCUTime::GetMonoTimestampUsec() - remux_start_time < RECORDER_REMUX_KEYFRAME_TIMEOUT)
+  {
+    if(ReadRemuxVideo() == FALSE)
+      return FALSE;
+    if(video_au_lost || !video_au_keyframe)
+      continue;
+    if(video_codec_id == AV_CODEC_ID_H264)
+    {
+      if(video_params_size == 0)
+        continue;
+      video_extradata.SetSize(video_params_size);
+      memcpy(video_extradata.GetPointer(), video_params.GetPointer(), video_params_size);
+    }
+    // the access unit is written first by the video thread
+    return TRUE;
+  }
+
+  video_au_size = 0;
+  return FALSE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+AVStream * ConferenceRecorder::AddRemuxStream(AVMediaType codec_type)
+{
+  AVStream *st = avformat_new_stream(fmt_context, NULL);
+  if(st == NULL)
+  {
+    MCUTRACE(1, trace_section << "could not allocate stream");
+    return NULL;
+  }
+  st->id = fmt_context->nb_streams-1;
+  AVCodecContext *context = st->codec;
+  context->codec_type = codec_type;
+
+  if(codec_type == AVMEDIA_TYPE_AUDIO)
+  {
+    context->codec_id      = audio_codec_id;
+    context->sample_rate   = audio_samplerate;
+    context->channels      = audio_channels;
+    context->channel_layout = MCU_AV_CH_Layout_Selector[context->channels];
+    context->time_base.num = 1;
+    context->time_base.den = audio_clock;
+    if(audio_codec_id == AV_CODEC_ID_ADPCM_G722)
+      context->bits_per_coded_sample = 4;
+    if(audio_codec_id == AV_CODEC_ID_OPUS)
+    {
+      // OpusHead: version, channels, pre-skip 312, 48000 Hz, gain 0, mapping 0
+      const BYTE head[19] = { 'O','p','u','s','H','e','a','d', 1, (BYTE)audio_channels, 0x38, 0x01, 0x80, 0xbb, 0x00, 0x00, 0x00, 0x00, 0x00 };
+      SetCodecExtradata(context, head, sizeof(head));
+    }
+  }
+  else if(codec_type == AVMEDIA_TYPE_VIDEO)
+  {
+    context->codec_id      = video_codec_id;
+    context->pix_fmt       = AV_PIX_FMT_YUV420P;
+    context->width         = video_width;
+    context->height        = video_height;
+    context->time_base.num = 1;
+    context->time_base.den = 1000;
+    // Annex B, the muxer converts it to avcC
+    if(video_extradata.GetSize() > 0)
+      SetCodecExtradata(context, video_extradata.GetPointer(), video_extradata.GetSize());
+  }
+
+  // Some formats want stream headers to be separate
+  if((fmt_context->oformat->flags & AVFMT_GLOBALHEADER) || segment_duration > 0)
+    context->flags |= CODEC_FLAG_GLOBAL_HEADER;
+
+  return st;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ConferenceRecorder::AppendVideo(PBYTEArray & buffer, PINDEX & size, const BYTE * data, PINDEX len, BOOL startCode)
+{
+  static const BYTE start_code[4] = { 0, 0, 0, 1 };
+  if(buffer.GetSize() < size + len + 4)
+    buffer.SetSize((size + len + 4) * 2);
+  if(startCode)
+  {
+    memcpy(buffer.GetPointer() + size, start_code, 4);
+    size += 4;
+  }
+  memcpy(buffer.GetPointer() + size, data, len);
+  size += len;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ConferenceRecorder::DepacketizeH264(const BYTE * payload, PINDEX size)
+{
+  if(size < 1)
+    return;
+
+  int type = payload[0] & 0x1f;
+  if(type >= 1 && type <= 23)
+  {
+    // single NAL unit
+    AppendVideo(video_au, video_au_size, payload, size, TRUE);
+    if(type == 5)
+      video_au_keyframe = TRUE;
+    else if(type == 7 || type == 8)
+      AppendVideo(video_params, video_params_size, payload, size, TRUE);
+  }
+  else if(type == 24)
+  {
+    // STAP-A
+    PINDEX offset = 1;
+    while(offset + 2 < size)
+    {
+      PINDEX len = (payload[offset] << 8) | payload[offset+1];
+      offset += 2;
+      if(len == 0 || offset + len > size)
+        break;
+      int nal_type = payload[offset] & 0x1f;
+      AppendVideo(video_au, video_au_size, payload + offset, len, TRUE);
+      if(nal_type == 5)
+        video_au_keyframe = TRUE;
+      else if(nal_type == 7 || nal_type == 8)
+        AppendVideo(video_params, video_params_size, payload + offset, len, TRUE);
+      offset += len;
+    }
+  }
+  else if(type == 28)
+  {
+    // FU-A
+    if(size < 3)
+      return;
+    BYTE fu_header = payload[1];
+    if(fu_header & 0x80)
+    {
+      BYTE nal_header = (payload[0] & 0xe0) | (fu_header & 0x1f);
+      AppendVideo(video_au, video_au_size, &nal_header, 1, TRUE);
+      if((fu_header & 0x1f) == 5)
+        video_au_keyframe = TRUE;
+    }
+    else if(video_au_size == 0)
+    {
+      // the beginning of the NAL unit is lost
+      video_au_lost = TRUE;
+      return;
+    }
+    AppendVideo(video_au, video_au_size, payload + 2, size - 2, FALSE);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ConferenceRecorder::DepacketizeVP8(const BYTE * payload, PINDEX size)
+{
+  // payload descriptor, RFC 7741
+  if(size < 1)
+    return;
+  PINDEX offset = 1;
+  BYTE descriptor = payload[0];
+  if(descriptor & 0x80)
+  {
+    if(offset >= size)
+      return;
+    BYTE extension = payload[offset++];
+    if(extension & 0x80) // PictureID
+    {
+      if(offset >= size)
+        return;
+      offset += (payload[offset] & 0x80) ? 2 : 1;
+    }
+    if(extension & 0x40) // TL0PICIDX
+      offset++;
+    if(extension & 0x30) // TID/KEYIDX
+      offset++;
+  }
+  if(offset >= size)
+    return;
+
+  // start of partition 0, P bit of the payload header
+  if((descriptor & 0x10) && (descriptor & 0x07) == 0 && (payload[offset] & 0x01) == 0)
+    video_au_keyframe = TRUE;
+  AppendVideo(video_au, video_au_size, payload + offset, size - offset, FALSE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL ConferenceRecorder::ReadRemuxVideo()
+{
+  RTP_DataFrame frame;
+  video_au_size = 0;
+  video_au_keyframe = FALSE;
+  video_au_lost = FALSE;
+  video_params_size = 0;
+
+  for(;;)
+  {
+    unsigned length = 0, flags = 0;
+    if(!GetCacheRTP(video_cache, frame, length, video_cache_seqn, flags))
+      return FALSE;
+
+    // each frame of the cache starts on a new hundred, inside the frame numbers are sequential
+    unsigned seqn = video_cache_seqn - 1;
+    BOOL first = (seqn & ~FRAME_MASK) == 0;
+    if(video_cache_last == 0xFFFFFFFF)
+    {
+      if(!first)
+        video_au_lost = TRUE;
+    }
+    else if(first && seqn != (video_cache_last & FRAME_MASK) + FRAME_OFFSET)
+      video_au_lost = TRUE;
+    else if(!first && seqn != video_cache_last + 1)
+      video_au_lost = TRUE;
+    if(first)
+      video_au_pts = (MCUTime::GetMonoTimestampUsec() - remux_start_time) / 1000;
+    video_cache_last = seqn;
+
+    if(video_codec_id == AV_CODEC_ID_H264)
+      DepacketizeH264(frame.GetPayloadPtr(), length);
+    else
+      DepacketizeVP8(frame.GetPayloadPtr(), length);
+
+    if(flags & PluginCodec_ReturnCoderLastFrame)
+      break;
+  }
+
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL ConferenceRecorder::WriteRemuxVideo()
+{
+  int ret = 0;
+
+  // the first access unit was read by OpenRemuxVideo
+  if(video_au_size == 0 && ReadRemuxVideo() == FALSE)
+    return FALSE;
+
+  if(video_au_lost || video_au_size == 0)
+  {
+    if(!video_wait_keyframe)
+    {
+      PTRACE(3, trace_section << "cache frame lost, waiting keyframe");
+      video_wait_keyframe = TRUE;
+      video_cache->OnFastUpdatePicture("recorder");
+    }
+    video_au_size = 0;
+    return TRUE;
+  }
+  if(video_wait_keyframe && !video_au_keyframe)
+  {
+    video_au_size = 0;
+    return TRUE;
+  }
+  video_wait_keyframe = FALSE;
+
+  // the muxer requires increasing timestamps
+  if(video_au_pts <= video_pts)
+    video_au_pts = video_pts + 1;
+  video_pts = video_au_pts;
+
+  AVPacket pkt = { 0 };
+  av_init_packet(&pkt);
+  pkt.data = video_au.GetPointer();
+  pkt.size = video_au_size;
+  pkt.pts = video_au_pts;
+  if(video_au_keyframe)
+    pkt.flags |= AV_PKT_FLAG_KEY;
+  video_frame_count++;
+
+  ret = WritePacket(video_st, &pkt);
+  video_au_size = 0;
+  if(ret < 0)
+  {
+    MCUTRACE(1, trace_section << "error while writing video frame: " << ret << " " <<  AVErrorToString(ret));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL ConferenceRecorder::WriteRemuxAudio()
+{
+  RTP_DataFrame frame;
+  int ret = 0;
+  unsigned length = 0, flags = 0;
+  unsigned seqn = audio_cache_seqn;
+  if(!GetCacheRTP(audio_cache, frame, length, audio_cache_seqn, flags))
+    return FALSE;
+
+  // the start and the gaps of the cache follow the clock
+  if(audio_pts < 0 || audio_cache_seqn != seqn + 1)
+  {
+    int64_t pts = (int64_t)(MCUTime::GetMonoTimestampUsec() - remux_start_time) * audio_clock / 1000000;
+    if(pts > audio_pts)
+      audio_pts = pts;
+  }
+
+  int64_t pts = audio_pts;
+  audio_pts += audio_frame_time;
+  if(length == 0)
+    return TRUE;
+
+  AVPacket pkt = { 0 };
+  av_init_packet(&pkt);
+  pkt.data = frame.GetPayloadPtr();
+  pkt.size = length;
+  pkt.pts = pts;
+  pkt.flags |= AV_PKT_FLAG_KEY;
+  audio_frame_count++;
+
+  ret = WritePacket(audio_st, &pkt);
+  if(ret < 0)
+  {
+    MCUTRACE(1, trace_section << "error while writing audio frame: " << ret << " " <<  AVErrorToString(ret));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RecorderConcatThread::Main()
+{
+  if(MCU_AVConcatFiles(manifest, filename) == FALSE)
+  {
+    MCUTRACE(1, "ConferenceRecorder: failed to concatenate segments, see " << manifest);
+    return;
+  }
+
+  // remove the segments and the manifest
+  PDirectory dir = PFilePath(manifest).GetDirectory();
+  PTextFile file(manifest, PFile::ReadOnly);
+  PString line;
+  while(file.ReadLine(line))
+  {
+    line = line.Trim();
+    if(line.Find("file ") != 0)
+      continue;
+    PString name = line.Mid(5).Trim();
+    if(name.GetLength() > 1 && name[0] == '\'')
+      name = name.Mid(1, name.GetLength()-2);
+    if(name.Find(PATH_SEPARATOR) == P_MAX_INDEX)
+      name = dir + name;
+    PFile::Remove(name);
+  }
+  file.Close();
+  PFile::Remove(manifest);
+
+  MCUTRACE(1, "ConferenceRecorder: segments concatenated to " << filename);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RecorderWriteBlock::RecorderWriteBlock(int64_t _offset)
+  : offset(_offset), size(0)
+{
+  // O_DIRECT requires the aligned memory
+  buffer = (BYTE *)malloc(RECORDER_WRITE_BLOCK_SIZE + RECORDER_WRITE_ALIGN);
+  data = (BYTE *)(((size_t)buffer + RECORDER_WRITE_ALIGN - 1) & ~(size_t)(RECORDER_WRITE_ALIGN - 1));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RecorderWriteBlock::~RecorderWriteBlock()
+{
+  free(buffer);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RecorderWriter::RecorderWriter(const PString & _filename, unsigned _queue_size, BOOL _direct)
+  : filename(_filename), direct(_direct), queue_size(_queue_size)
+{
+  direct_enabled = FALSE;
+  queue_bytes = 0;
+  queue_bytes_max = 0;
+  block = NULL;
+  position = 0;
+  file_size = 0;
+  write_latency = 0;
+  write_latency_max = 0;
+  stalls = 0;
+  errors = 0;
+  running = FALSE;
+  thread = NULL;
+
+  // one block is written, one is filled
+  if(queue_size < 2 * RECORDER_WRITE_BLOCK_SIZE)
+    queue_size = 2 * RECORDER_WRITE_BLOCK_SIZE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+RecorderWriter::~RecorderWriter()
+{
+  Close();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL RecorderWriter::Open()
+{
+  if(!file.Open(filename, PFile::WriteOnly, PFile::Create | PFile::Truncate))
+    return FALSE;
+
+  block = new RecorderWriteBlock(0);
+  running = TRUE;
+  thread = PThread::Create(PCREATE_NOTIFIER(WriterThread), 0, PThread::NoAutoDeleteThread, PThread::NormalPriority, "recorder_writer:%0x");
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RecorderWriter::Close()
+{
+  if(thread == NULL)
+    return;
+
+  // the thread writes the rest of the queue and exits
+  Push();
+  queue_mutex.Wait();
+  running = FALSE;
+  queue_mutex.Signal();
+  queue_sync.Signal();
+  thread->WaitForTermination();
+  delete thread;
+  thread = NULL;
+
+  delete block;
+  block = NULL;
+  file.Close();
+
+  MCUTRACE(1, "RecorderWriter: " << filename << " closed, max queue " << queue_bytes_max/1024 << " KiB, max latency " << write_latency_max/1000 << " ms, stalls " << stalls << ", errors " << errors);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int RecorderWriter::WriteData(void *opaque, uint8_t *buf, int buf_size)
+{
+  ((RecorderWriter *)opaque)->Write(buf, buf_size);
+  return buf_size;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int64_t RecorderWriter::SeekData(void *opaque, int64_t offset, int whence)
+{
+  return ((RecorderWriter *)opaque)->Seek(offset, whence);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RecorderWriter::Write(const BYTE *buf, PINDEX len)
+{
+  while(len > 0)
+  {
+    PINDEX size = PMIN(len, RECORDER_WRITE_BLOCK_SIZE - block->size);
+    memcpy(block->data + block->size, buf, size);
+    block->size += size;
+    buf += size;
+    len -= size;
+    position += size;
+    if(position > file_size)
+      file_size = position;
+    if(block->size == RECORDER_WRITE_BLOCK_SIZE)
+      Push();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int64_t RecorderWriter::Seek(int64_t offset, int whence)
+{
+  if(whence == AVSEEK_SIZE)
+    return file_size;
+
+  int64_t pos;
+  whence &= ~AVSEEK_FORCE;
+  if(whence == SEEK_SET)
+    pos = offset;
+  else if(whence == SEEK_CUR)
+    pos = position + offset;
+  else if(whence == SEEK_END)
+    pos = file_size + offset;
+  else
+    return -1;
+  if(pos < 0)
+    return -1;
+
+  // the muxer updates the header, the next data goes to a new block
+  if(pos != position)
+  {
+    Push();
+    position = pos;
+    block->offset = pos;
+  }
+  return pos;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RecorderWriter::Push()
+{
+  if(block->size == 0)
+    return;
+
+  // the queue is full, the recorder thread waits for the storage
+  BOOL stall = FALSE;
+  for(;;)
+  {
+    queue_mutex.Wait();
+    if(queue.size() == 0 || (queue.size() + 1) * RECORDER_WRITE_BLOCK_SIZE <= queue_size)
+      break;
+    queue_mutex.Signal();
+    if(!stall)
+    {
+      stall = TRUE;
+      stalls++;
+    }
+    space_sync.Wait(100);
+  }
+  queue.push_back(block);
+  queue_bytes += block->size;
+  if(queue_bytes > queue_bytes_max)
+    queue_bytes_max = queue_bytes;
+  queue_mutex.Signal();
+  queue_sync.Signal();
+
+  block = new RecorderWriteBlock(position);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RecorderWriter::SetDirect(BOOL enable)
+{
+  if(enable == direct_enabled)
+    return;
+#ifdef O_DIRECT
+  int flags = fcntl(file.GetHandle(), F_GETFL);
+  if(flags != -1 && fcntl(file.GetHandle(), F_SETFL, (enable ? (flags | O_DIRECT) : (flags & ~O_DIRECT))) == 0)
+  {
+    direct_enabled = enable;
+    return;
+  }
+#endif
+  if(enable)
+  {
+    MCUTRACE(1, "RecorderWriter: O_DIRECT is not supported for " << filename);
+    direct = FALSE;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+unsigned RecorderWriter::GetQueuePercent()
+{
+  PWaitAndSignal m(queue_mutex);
+  return queue.size() * RECORDER_WRITE_BLOCK_SIZE * 100 / queue_size;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PString RecorderWriter::GetMonitorInfo(const PString & hdr)
+{
+  PWaitAndSignal m(queue_mutex);
+  PStringStream output;
+  output << hdr << "Write queue: " << queue_bytes/1024 << " KiB in " << queue.size() << " blocks, max " << queue_bytes_max/1024 << " KiB, limit " << queue_size/1024 << " KiB\n"
+         << hdr << "Write latency: " << write_latency/1000 << " ms, max " << write_latency_max/1000 << " ms\n"
+         << hdr << "Write stalls: " << stalls << ", errors: " << errors << (direct_enabled ? ", O_DIRECT" : "") << "\n";
+  return output;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void RecorderWriter::WriterThread(PThread &, INT)
+{
+  for(;;)
+  {
+    RecorderWriteBlock *b = NULL;
+    queue_mutex.Wait();
+    if(queue.size() > 0)
+      b = queue.front();
+    BOOL stop = !running;
+    queue_mutex.Signal();
+
+    if(b == NULL)
+    {
+      if(stop)
+        break;
+      queue_sync.Wait(100);
+      continue;
+    }
+
+    uint64_t start = MCUTime::GetMonoTimestampUsec();
+    // O_DIRECT takes the aligned blocks, the header updates go through the page cache
+    SetDirect(direct && (b->offset % RECORDER_WRITE_ALIGN) == 0 && (b->size % RECORDER_WRITE_ALIGN) == 0);
+    BOOL result = (file.SetPosition(b->offset) && file.Write(b->data, b->size));
+    if(!result && direct_enabled)
+    {
+      SetDirect(FALSE);
+      direct = FALSE;
+      result = (file.SetPosition(b->offset) && file.Write(b->data, b->size));
+    }
+    if(!result)
+    {
+      errors++;
+      MCUTRACE(1, "RecorderWriter: write error " << filename << " " << file.GetErrorText());
+    }
+    write_latency = MCUTime::GetMonoTimestampUsec() - start;
+    if(write_latency > write_latency_max)
+      write_latency_max = write_latency;
+
+    // the block is counted in the queue until it is written
+    queue_mutex.Wait();
+    queue.pop_front();
+    queue_bytes -= b->size;
+    queue_mutex.Signal();
+    space_sync.Signal();
+    delete b;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ConferenceStreamer::ConferenceStreamer(Conference *_conference)
+  : ConferenceRecorder(_conference)
+{
+  trace_section = "ConferenceStreamer: ";
+  target_duration = STREAMER_SEGMENT_DEFAULT;
+  sequence = 0;
+  segment_start = -1;
+  segment_size = 0;
+  keyframe_requested = FALSE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ConferenceStreamer::~ConferenceStreamer()
+{
+  Stop();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL ConferenceStreamer::Start()
+{
+  PWaitAndSignal m(mutex);
+
+  if(conference == NULL)
+    return FALSE;
+
+  // the threads set the running flag a bit later
+  if(IsRunning() == TRUE || thread_audio || thread_video)
+    return TRUE;
+
+  MCUConfig cfg("Parameters");
+  LoadSettings(cfg);
+
+  target_duration = MCUConfig("Export Parameters").GetInteger(LiveSegmentDurationKey, STREAMER_SEGMENT_DEFAULT);
+  if(target_duration < 1)
+    target_duration = 1;
+  else if(target_duration > STREAMER_SEGMENT_MAX)
+    target_duration = STREAMER_SEGMENT_MAX;
+
+  // HLS players expect AAC, AC-3 is the fallback
+  audio_codec_id = GetCodecId(0, "aac");
+  if(audio_codec_id == AV_CODEC_ID_NONE)
+    audio_codec_id = GetCodecId(0, "ac3");
+
+  // H.264 of the room cache, otherwise the mixed video is encoded
+  video_codec_id = AV_CODEC_ID_H264;
+  FindRemuxCaches();
+  if(!remux_video)
+    video_codec_id = GetCodecId(1, "libx264");
+
+  if(audio_codec_id == AV_CODEC_ID_NONE && video_codec_id == AV_CODEC_ID_NONE)
+  {
+    MCUTRACE(1, trace_section << "failed initialise streamer, codecs not found");
+    return FALSE;
+  }
+
+  format_name = "mpegts";
+  filename = conference->GetNumber() + " live";
+  sequence = 0;
+  segment_start = -1;
+  segment_size = 0;
+  keyframe_requested = FALSE;
+
+  if(InitRecorder() == FALSE)
+  {
+    MCUTRACE(1, trace_section << "failed initialise streamer");
+    Stop();
+    return FALSE;
+  }
+
+  OnRequest();
+  StartThreads();
+
+  MCUTRACE(1, trace_section << "started, segment " << target_duration << " sec, video " << (remux_video ? "from cache" : "encoded"));
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL ConferenceStreamer::OpenOutput(AVDictionary **options)
+{
+  // the muxer writes to the current segment in memory
+  unsigned char *buffer = (unsigned char *)av_malloc(STREAMER_IO_BUFFER_SIZE);
+  fmt_context->pb = avio_alloc_context(buffer, STREAMER_IO_BUFFER_SIZE, 1, this, NULL, &WriteData, NULL);
+  if(fmt_context->pb == NULL)
+  {
+    av_free(buffer);
+    MCUTRACE(1, trace_section << "could not allocate the output buffer");
+    return FALSE;
+  }
+  fmt_context->flags |= AVFMT_FLAG_CUSTOM_IO;
+
+  // audio is not held back in the muxer, the segment is cut exactly at the keyframe
+  av_dict_set(options, "pes_payload_size", "0", 0);
+
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ConferenceStreamer::CloseOutput()
+{
+  if(fmt_context->pb)
+  {
+    av_free(fmt_context->pb->buffer);
+    av_free(fmt_context->pb);
+    fmt_context->pb = NULL;
+  }
+
+  PWaitAndSignal m(segments_mutex);
+  while(segments.size() > 0)
+  {
+    delete segments.front();
+    segments.pop_front();
+  }
+  segment_data.SetSize(0);
+  segment_size = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int ConferenceStreamer::WriteData(void *opaque, uint8_t *buf, int buf_size)
+{
+  ConferenceStreamer *streamer = (ConferenceStreamer *)opaque;
+  if(streamer->segment_data.GetSize() < streamer->segment_size + buf_size)
+    streamer->segment_data.SetSize((streamer->segment_size + buf_size) * 2);
+  memcpy(streamer->segment_data.GetPointer() + streamer->segment_size, buf, buf_size);
+  streamer->segment_size += buf_size;
+  return buf_size;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int ConferenceStreamer::WritePacket(AVStream *st, AVPacket *pkt)
+{
+  // the frame was buffered by the encoder
+  if(pkt->size == 0)
+    return 0;
+
+  AVRational msec = { 1, 1000 };
+  int64_t pts = av_rescale_q(pkt->pts, st->codec->time_base, msec);
+  BOOL keyframe = (pkt->flags & AV_PKT_FLAG_KEY) ? TRUE : FALSE;
+
+  PWaitAndSignal m(write_mutex);
+
+  if(st == video_st || video_st == NULL)
+  {
+    if(segment_start < 0)
+      segment_start = pts;
+    BOOL expired = (pts - segment_start >= (int64_t)target_duration * 1000);
+    // a segment starts with a keyframe, audio only stream is cut by time
+    if(expired && (keyframe || video_st == NULL))
+    {
+      CutSegment(pts);
+      keyframe_requested = FALSE;
+    }
+    else if(expired && remux_video && !keyframe_requested)
+    {
+      // the cache encoder sends keyframes on request only
+      video_cache->OnFastUpdatePicture("streamer");
+      keyframe_requested = TRUE;
+    }
+  }
+
+  PBYTEArray buffer;
+  if(remux_video && st == video_st && keyframe && video_params_size == 0 && video_extradata.GetSize() > 0)
+  {
+    // each segment is decoded independently, SPS/PPS go before the keyframe
+    buffer.SetSize(video_extradata.GetSize() + pkt->size);
+    memcpy(buffer.GetPointer(), video_extradata.GetPointer(), video_extradata.GetSize());
+    memcpy(buffer.GetPointer() + video_extradata.GetSize(), pkt->data, pkt->size);
+    pkt->data = buffer.GetPointer();
+    pkt->size = buffer.GetSize();
+  }
+
+  pkt->stream_index = st->index;
+  pkt->pts = av_rescale_q(pkt->pts, st->codec->time_base, st->time_base);
+  pkt->dts = pkt->pts;
+
+  // live output, no interleaving queue
+  return av_write_frame(fmt_context, pkt);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ConferenceStreamer::CutSegment(int64_t pts)
+{
+  // all data before the keyframe goes to the finished segment
+  avio_flush(fmt_context->pb);
+
+  StreamerSegment *segment = new StreamerSegment(sequence++, (unsigned)(pts - segment_start));
+  segment->data.SetSize(segment_size);
+  memcpy(segment->data.GetPointer(), segment_data.GetPointer(), segment_size);
+  segment_size = 0;
+  segment_start = pts;
+
+  segments_mutex.Wait();
+  segments.push_back(segment);
+  while(segments.size() > STREAMER_SEGMENT_STORE)
+  {
+    delete segments.front();
+    segments.pop_front();
+  }
+  segments_mutex.Signal();
+
+  // PAT/PMT at the beginning of the next segment
+  av_opt_set(fmt_context->priv_data, "mpegts_flags", "+resend_headers", 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL ConferenceStreamer::WaitSegment()
+{
+  for(unsigned i = 0; i < target_duration * 30; i++)
+  {
+    segments_mutex.Wait();
+    BOOL ready = (segments.size() > 0);
+    segments_mutex.Signal();
+    if(ready)
+      return TRUE;
+    MCUTime::Sleep(100);
+  }
+  return FALSE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL ConferenceStreamer::GetPlaylist(PString & playlist, const PString & url)
+{
+  PWaitAndSignal m(segments_mutex);
+
+  if(segments.size() == 0)
+    return FALSE;
+
+  unsigned first = (segments.size() > STREAMER_PLAYLIST_SIZE ? segments.size() - STREAMER_PLAYLIST_SIZE : 0);
+  unsigned target = target_duration;
+  for(unsigned i = first; i < segments.size(); i++)
+  {
+    if((segments[i]->duration + 999) / 1000 > target)
+      target = (segments[i]->duration + 999) / 1000;
+  }
+
+  // the session in the segment URL, the numbering starts again after restart
+  PString session = PString(startTime.GetTimeInSeconds());
+
+  PStringStream s;
+  s << "#EXTM3U\n"
+    << "#EXT-X-VERSION:3\n"
+    << "#EXT-X-TARGETDURATION:" << target << "\n"
+    << "#EXT-X-MEDIA-SEQUENCE:" << segments[first]->sequence << "\n";
+  for(unsigned i = first; i < segments.size(); i++)
+  {
+    s << "#EXTINF:" << psprintf("%u.%03u", segments[i]->duration / 1000, segments[i]->duration % 1000) << ",\n"
+      << url << "&session=" << session << "&segment=" << segments[i]->sequence << "\n";
+  }
+  playlist = s;
+
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL ConferenceStreamer::GetSegment(const PString & session, unsigned number, PBYTEArray & data)
+{
+  PWaitAndSignal m(segments_mutex);
+
+  // the segment of the previous session must not be cached under the same URL
+  if(session != PString(startTime.GetTimeInSeconds()))
+    return FALSE;
+
+  for(unsigned i = 0; i < segments.size(); i++)
+  {
+    if(segments[i]->sequence != number)
+      continue;
+    data = segments[i]->data;
+    data.MakeUnique();
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -56,6 +56,90 @@ static struct recorder_resolution {
 
 PString GetRecorderCodecs(int media_type);
 
+#define RECORDER_REMUX_KEYFRAME_TIMEOUT  5000000 // usec, wait for the first cache keyframe
+#define RECORDER_SEGMENT_MAX             3600    // sec
+#define RECORDER_WRITE_QUEUE_DEFAULT     16      // MiB, 0 - synchronous write
+#define RECORDER_WRITE_QUEUE_MAX         256     // MiB
+#define RECORDER_WRITE_BLOCK_SIZE        1048576 // bytes, one write call
+#define RECORDER_WRITE_ALIGN             4096    // O_DIRECT alignment
+#define RECORDER_IO_BUFFER_SIZE          65536
+
+#define STREAMER_SEGMENT_DEFAULT         2       // sec
+#define STREAMER_SEGMENT_MAX             10      // sec
+#define STREAMER_PLAYLIST_SIZE           5       // segments in the playlist
+#define STREAMER_SEGMENT_STORE           (STREAMER_PLAYLIST_SIZE + 2) // late clients still get the segment
+#define STREAMER_IDLE_TIMEOUT            30000   // msec without requests, then the streamer stops
+#define STREAMER_IO_BUFFER_SIZE          32768
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class RecorderWriteBlock
+{
+  public:
+    RecorderWriteBlock(int64_t _offset);
+    ~RecorderWriteBlock();
+
+    int64_t offset;  // file position
+    PINDEX size;
+    BYTE *data;      // aligned
+  protected:
+    BYTE *buffer;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The muxer output goes to a queue of large blocks, the file is written by a separate thread.
+// A slow storage delays the queue only, the recorder threads keep the pace.
+class RecorderWriter : public PObject
+{
+  PCLASSINFO(RecorderWriter, PObject);
+
+  public:
+    RecorderWriter(const PString & _filename, unsigned _queue_size, BOOL _direct);
+    ~RecorderWriter();
+
+    BOOL Open();
+    void Close();
+
+    static int WriteData(void *opaque, uint8_t *buf, int buf_size);
+    static int64_t SeekData(void *opaque, int64_t offset, int whence);
+
+    unsigned GetQueuePercent();
+    PString GetMonitorInfo(const PString & hdr);
+
+  protected:
+    void Write(const BYTE *buf, PINDEX len);
+    int64_t Seek(int64_t offset, int whence);
+    void Push();
+    void SetDirect(BOOL enable);
+
+    PString filename;
+    PFile file;
+    BOOL direct;
+    BOOL direct_enabled;
+
+    unsigned queue_size;       // bytes
+    unsigned queue_bytes;
+    unsigned queue_bytes_max;
+    std::deque<RecorderWriteBlock *> queue;
+    RecorderWriteBlock *block; // current, filled by the muxer
+    int64_t position;
+    int64_t file_size;
+
+    uint64_t write_latency;     // usec, last block
+    uint64_t write_latency_max;
+    unsigned stalls;
+    unsigned errors;
+
+    BOOL running;
+    PMutex queue_mutex;
+    PSyncPoint queue_sync;
+    PSyncPoint space_sync;
+
+    PThread *thread;
+    PDECLARE_NOTIFIER(PThread, RecorderWriter, WriterThread);
+};
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 class ConferenceRecorder : public ConferenceMember
@@ -64,7 +148,7 @@ class ConferenceRecorder : public ConferenceMember
 
   public:
     ConferenceRecorder(Conference *_conference);
-    ~ConferenceRecorder();
+    virtual ~ConferenceRecorder();
 
     virtual void Close();
 
@@ -77,6 +161,8 @@ class ConferenceRecorder : public ConferenceMember
     BOOL IsRunning()
     { return running; }
 
+    virtual PString GetMonitorInfo(const PString & hdr);
+
     BOOL Start();
     void Stop();
 
@@ -88,6 +174,19 @@ class ConferenceRecorder : public ConferenceMember
     PString format_name;
     PString trace_section;
 
+    unsigned segment_duration; // sec, 0 - single file
+    PString segment_format;
+    PString segment_pattern;
+    PString manifest;
+
+    // asynchronous file write
+    RecorderWriter *writer;
+    unsigned write_queue_size;  // MiB
+    BOOL write_direct;
+    BOOL video_dropping;       // the write queue is full
+    BOOL video_drop_keyframe;  // keyframe requested to resume
+    unsigned video_dropped;
+
     unsigned audio_bitrate; // kbit
     unsigned audio_samplerate;
     unsigned audio_channels;
@@ -103,6 +202,30 @@ class ConferenceRecorder : public ConferenceMember
     AVCodecID audio_codec_id;
     AVCodecID video_codec_id;
 
+    // remux of the room cache, without re-encoding
+    BOOL remux_audio;
+    BOOL remux_video;
+    CacheRTP *audio_cache;
+    CacheRTP *video_cache;
+    unsigned audio_cache_seqn;
+    unsigned video_cache_seqn;
+    unsigned video_cache_last; // last packet read
+    unsigned audio_clock;      // RTP, Hz
+    unsigned audio_frame_time; // RTP
+    int64_t audio_pts;
+    int64_t video_pts;         // msec
+    uint64_t remux_start_time;
+
+    PBYTEArray video_au;       // access unit, Annex B for H.264
+    PINDEX video_au_size;
+    int64_t video_au_pts;
+    BOOL video_au_keyframe;
+    BOOL video_au_lost;
+    BOOL video_wait_keyframe;
+    PBYTEArray video_params;   // SPS/PPS of the access unit
+    PINDEX video_params_size;
+    PBYTEArray video_extradata;
+
 #if USE_SWRESAMPLE
     struct SwrContext *swrc;
 #elif USE_AVRESAMPLE
@@ -131,7 +254,14 @@ class ConferenceRecorder : public ConferenceMember
     AVFormatContext *fmt_context;
 
     void Reset();
+    void LoadSettings(MCUConfig & cfg);
     BOOL InitRecorder();
+    void StartThreads();
+
+    virtual BOOL OpenOutput(AVDictionary **options);
+    virtual void CloseOutput();
+    virtual BOOL CanRemux(AVCodecID codec_id)
+    { return TRUE; }
 
     AVStream *AddStream(AVMediaType codec_type);
 
@@ -145,7 +275,17 @@ class ConferenceRecorder : public ConferenceMember
 
     BOOL OpenResampler();
     BOOL Resampler();
-    int WritePacket(AVStream *st, AVPacket *pkt);
+    virtual int WritePacket(AVStream *st, AVPacket *pkt);
+
+    void FindRemuxCaches();
+    BOOL OpenRemuxVideo();
+    AVStream *AddRemuxStream(AVMediaType codec_type);
+    BOOL ReadRemuxVideo();
+    void DepacketizeH264(const BYTE * payload, PINDEX size);
+    void DepacketizeVP8(const BYTE * payload, PINDEX size);
+    void AppendVideo(PBYTEArray & buffer, PINDEX & size, const BYTE * data, PINDEX len, BOOL startCode);
+    BOOL WriteRemuxAudio();
+    BOOL WriteRemuxVideo();
 
     PThread *thread_audio;
     PDECLARE_NOTIFIER(PThread, ConferenceRecorder, RecorderAudio);
@@ -159,4 +299,87 @@ class ConferenceRecorder : public ConferenceMember
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Assembles the session file from the segments of the manifest without re-encoding,
+// the segments are removed on success.
+class RecorderConcatThread : public PThread
+{
+  PCLASSINFO(RecorderConcatThread, PThread);
+  public:
+    RecorderConcatThread(const PString & _manifest, const PString & _filename)
+      : PThread(10000, AutoDeleteThread), manifest(_manifest), filename(_filename)
+    { Resume(); }
+
+    void Main();
+
+  protected:
+    PString manifest;
+    PString filename;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class StreamerSegment
+{
+  public:
+    StreamerSegment(unsigned _sequence, unsigned _duration)
+      : sequence(_sequence), duration(_duration)
+    { }
+
+    unsigned sequence;
+    unsigned duration; // msec
+    PBYTEArray data;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// HLS live output of the room: MPEG-TS segments are kept in memory and served by the web server.
+// The video is taken from the H.264 cache of the room when it exists, so one packager per room
+// replaces the external transcoder.
+class ConferenceStreamer : public ConferenceRecorder
+{
+  PCLASSINFO(ConferenceStreamer, ConferenceRecorder);
+
+  public:
+    ConferenceStreamer(Conference *_conference);
+    ~ConferenceStreamer();
+
+    virtual PString GetName() const
+    { return "live streamer"; }
+
+    BOOL Start();
+
+    // the streamer stops when nobody requests the playlist
+    void OnRequest()
+    { lastRequestTime = PTime(); }
+    BOOL IsIdle() const
+    { return (PTime() - lastRequestTime > STREAMER_IDLE_TIMEOUT); }
+
+    BOOL WaitSegment();
+    BOOL GetPlaylist(PString & playlist, const PString & url);
+    // session - the start time from the playlist URL, the numbering starts again after restart
+    BOOL GetSegment(const PString & session, unsigned number, PBYTEArray & data);
+
+  protected:
+    virtual BOOL OpenOutput(AVDictionary **options);
+    virtual void CloseOutput();
+    virtual BOOL CanRemux(AVCodecID codec_id)
+    { return (codec_id == AV_CODEC_ID_H264); }
+    virtual int WritePacket(AVStream *st, AVPacket *pkt);
+
+    void CutSegment(int64_t pts);
+    static int WriteData(void *opaque, uint8_t *buf, int buf_size);
+
+    unsigned target_duration; // sec
+    unsigned sequence;
+    int64_t segment_start;    // msec
+    BOOL keyframe_requested;
+    PBYTEArray segment_data;
+    PINDEX segment_size;
+    std::deque<StreamerSegment *> segments;
+    PMutex segments_mutex;
+    PTime lastRequestTime;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 #endif // _MCU_RECORDER_H
@@ -123,34 +123,32 @@ void AbookAccount::SaveConfig()
 
 PString AbookAccount::AsJsArray(int state)
 {
-  MCUJSON *json = AsJSON(state);
-  std::string str;
-  json->ToString(str, false, false);
-  delete json;
-  return str;
+  MCUJSONWriter json(false, false);
+  AsJSON(json, state);
+  return json.GetString();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-MCUJSON * AbookAccount::AsJSON(int state)
+void AbookAccount::AsJSON(MCUJSONWriter & json, int state)
 {
   PString memberName = display_name+" ["+GetUrl()+"]";
   PString memberNameID = MCUURL(memberName).GetMemberNameId();
-  MCUJSON *json = new MCUJSON(MCUJSON::JSON_ARRAY);
-  json->Insert("state", state);
-  json->Insert("memberNameID", memberNameID);
-  json->Insert("memberName", memberName);
-  json->Insert("is_abook", is_abook);
-  json->Insert("remote_application", remote_application);
-  json->Insert("reg_state", reg_state);
-  json->Insert("reg_info", reg_info);
-  json->Insert("conn_state", conn_state);
-  json->Insert("conn_info", conn_info);
-  json->Insert("ping_state", ping_state);
-  json->Insert("ping_info", ping_info);
-  json->Insert("is_account", is_account);
-  json->Insert("is_saved_account", is_saved_account);
-  return json;
+  json.BeginArray();
+  json.Value("state", state);
+  json.Value("memberNameID", memberNameID);
+  json.Value("memberName", memberName);
+  json.Value("is_abook", is_abook);
+  json.Value("remote_application", remote_application);
+  json.Value("reg_state", reg_state);
+  json.Value("reg_info", reg_info);
+  json.Value("conn_state", conn_state);
+  json.Value("conn_info", conn_info);
+  json.Value("ping_state", ping_state);
+  json.Value("ping_info", ping_info);
+  json.Value("is_account", is_account);
+  json.Value("is_saved_account", is_saved_account);
+  json.End();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -257,7 +257,7 @@ class AbookAccount
     }
 
     PString AsJsArray(int state = 0);
-    MCUJSON * AsJSON(int state = 0);
+    void AsJSON(MCUJSONWriter & writer, int state = 0);
     void SendRoomControl(int state = 0);
     void SaveConfig();
     PString GetUrl();
@@ -553,6 +553,9 @@ class Registrar : public PThread
       init_accounts = 0;
       registrarGk = NULL;
       trace_section = "Registrar: ";
+      accountList.EnableIndex();
+      subscriptionList.EnableIndex();
+      connectionList.EnableIndex();
     }
 
     void SetTerminating()
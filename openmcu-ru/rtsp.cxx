@@ -97,6 +97,18 @@ MCURtspConnection::MCURtspConnection(MCUH323EndPoint *_ep, PString _callToken)
   cseq = 1;
   listener = NULL;
 
+  use_fanout = FALSE;
+  audio_interleaved = -1;
+  video_interleaved = -1;
+  audio_subscriber = NULL;
+  video_subscriber = NULL;
+
+  rtsp_tcp = FALSE;
+  rtsp_tcp_fallback = FALSE;
+  audio_interleaved_session = NULL;
+  video_interleaved_session = NULL;
+  rtsp_session_timeout = RTSP_KEEPALIVE_TIMEOUT;
+
   // create local capability list
   CreateLocalSipCaps();
 
@@ -130,6 +142,15 @@ void MCURtspConnection::CleanUpOnCallEnd()
   if(direction == DIRECTION_OUTBOUND && callEndReason == EndedByLocalUser && rtsp_state == RTSP_PLAYING)
     SendTeardown();
 
+  // the fanout threads use the listener and the RTP sessions
+  StopFanout();
+
+  // RTCP of the receive channels is sent through the listener
+  if(audio_interleaved_session)
+    audio_interleaved_session->SetInterleaved(true);
+  if(video_interleaved_session)
+    video_interleaved_session->SetInterleaved(true);
+
   if(listener)
     delete listener;
   listener = NULL;
@@ -165,6 +186,13 @@ BOOL MCURtspConnection::Connect(PString room, PString address)
   auth.username = GetEndpointParam(UserNameKey, url.GetUserName());
   auth.password = GetEndpointParam(PasswordKey, url.GetPassword());
 
+  // media transport, by default UDP and TCP interleaved if the server does not support UDP
+  {
+    PString transport = GetEndpointParam(TransportKey).ToLower();
+    rtsp_tcp = (transport == "tcp");
+    rtsp_tcp_fallback = (transport == "");
+  }
+
   // create listener
   listener = MCUListener::Create(MCU_LISTENER_TCP_CLIENT, url.GetHostName(), rtsp_port.AsInteger(), OnReceived_wrap, this);
   if(listener == NULL)
@@ -214,6 +242,9 @@ BOOL MCURtspConnection::Connect(MCUSocket *socket, const msg_t *msg)
   // requested room
   requestedRoom = GetEndpointParam(RoomNameKey);
 
+  // the same as the cache mode of the stream member, the room layout is common for all viewers
+  use_fanout = MCUConfigSnapshot::GetConferenceConfig(requestedRoom).forceSplitVideo;
+
   // detect local_ip, nat_ip and create rtp sessions
   if(!CreateDefaultRTPSessions())
     goto error;
@@ -329,11 +360,17 @@ BOOL MCURtspConnection::CreateInboundCaps()
 
 BOOL MCURtspConnection::SendOptions()
 {
+  // keepalive of the session
+  PString session_header;
+  if(rtsp_session_str != "")
+    session_header = "Session: "+rtsp_session_str+"\r\n";
+
   char buffer[1024];
   snprintf(buffer, 1024,
   	   "OPTIONS %s RTSP/1.0\r\n"
 	   "CSeq: %d\r\n"
-	   , (const char *)ruri_str, cseq++);
+	   "%s"
+	   , (const char *)ruri_str, cseq++, (const char *)session_header);
 
   AddHeaders(buffer, METHOD_OPTIONS);
   if(!SendRequest(buffer))
@@ -387,13 +424,22 @@ BOOL MCURtspConnection::SendSetup(MediaTypes mtype, int pt)
   if(rtsp_session_str != "")
     session_header = "Session: "+rtsp_session_str+"\r\n";
 
+  PString transport_str;
+  if(rtsp_tcp)
+  {
+    int channel = (mtype == MEDIA_TYPE_AUDIO ? 0 : 2);
+    transport_str = "RTP/AVP/TCP;unicast;interleaved="+PString(channel)+"-"+PString(channel+1);
+  }
+  else
+    transport_str = "RTP/AVP/UDP;unicast;client_port="+PString(rtp_port)+"-"+PString(rtp_port+1);
+
   char buffer[1024];
   snprintf(buffer, 1024,
   	   "SETUP %s RTSP/1.0\r\n"
 	   "CSeq: %d\r\n"
 	   "%s"
-           "Transport: RTP/AVP/UDP;unicast;client_port=%d-%d\r\n"
-	   , (const char *)control, cseq++, (const char *)session_header, rtp_port, rtp_port+1);
+           "Transport: %s\r\n"
+	   , (const char *)control, cseq++, (const char *)session_header, (const char *)transport_str);
 
   AddHeaders(buffer, METHOD_SETUP);
   if(!SendRequest(buffer))
@@ -481,6 +527,7 @@ BOOL MCURtspConnection::OnResponsePlay(const msg_t *msg)
     MCUTRACE(1, trace_section << "video " << sc->capname << " " << sc->remote_ip << ":" << sc->remote_port);
   }
 
+  keepalive_time = PTime();
   rtsp_state = RTSP_PLAYING;
   return TRUE;
 }
@@ -495,7 +542,17 @@ BOOL MCURtspConnection::OnResponseSetup(const msg_t *msg)
   for(sip_unknown_t *sip_un = sip->sip_unknown; sip_un != NULL; sip_un = sip_un->un_next)
   {
     if(PString(sip_un->un_name) == "Session")
-      rtsp_session_str = PString(sip_un->un_value).Tokenise(";")[0];
+    {
+      // 12345678;timeout=60
+      PStringArray session_params = PString(sip_un->un_value).Tokenise(";");
+      rtsp_session_str = session_params[0];
+      for(PINDEX i = 1; i < session_params.GetSize(); i++)
+      {
+        PString param = session_params[i].Trim();
+        if(param.Left(8) == "timeout=" && param.Mid(8).AsInteger() > 0)
+          rtsp_session_timeout = param.Mid(8).AsInteger();
+      }
+    }
     if(PString(sip_un->un_name) == "Transport")
       transport_str = sip_un->un_value;
   }
@@ -664,6 +721,79 @@ BOOL MCURtspConnection::ParseTransportStr(SipCapability *sc, PString & transport
   MCUStringDictionary transport_dict(transport_str);
   PString local_ports, remote_ports;
 
+  //RTP/AVP/TCP;unicast;interleaved=0-1
+  if(direction == DIRECTION_OUTBOUND && rtsp_tcp)
+  {
+    if(transport_str.Find("RTP/AVP/TCP") != 0)
+    {
+      MCUTRACE(1, trace_section << "the server did not accept TCP transport");
+      return FALSE;
+    }
+    int channel = (sc->media == MEDIA_TYPE_AUDIO ? 0 : 2);
+    PString interleaved = transport_dict("interleaved");
+    if(interleaved != "")
+      channel = interleaved.Tokenise("-")[0].AsInteger();
+    if(channel < 0 || channel > 254)
+    {
+      MCUTRACE(1, trace_section << "incorrect interleaved channel " << interleaved);
+      return FALSE;
+    }
+
+    // the media comes from the RTSP server address
+    sc->remote_ip = listener->GetSocketHost();
+    sc->remote_port = listener->GetSocketPort().AsInteger();
+    if(!MCUSocket::IsValidHost(sc->remote_ip) && !MCUSocket::GetHostIP(sc->remote_ip, sc->remote_ip))
+    {
+      MCUTRACE(1, trace_section << "incorrect remote ip " << sc->remote_ip);
+      return FALSE;
+    }
+
+    MCUSIP_RTP_UDP *session = CreateRTPSession(sc->media);
+    session->SetInterleaved(true, OnInterleavedWrite_wrap, this);
+    session->DecrementReference();
+    if(sc->media == MEDIA_TYPE_AUDIO)
+    {
+      audio_interleaved = channel;
+      audio_interleaved_session = session;
+    }
+    else
+    {
+      video_interleaved = channel;
+      video_interleaved_session = session;
+    }
+    listener->SetInterleaved(TRUE, OnInterleaved_wrap, this);
+    return TRUE;
+  }
+
+  if(direction == DIRECTION_INBOUND && transport_str.Find("RTP/AVP/TCP") == 0)
+  {
+    // the media goes through the RTSP connection, only the packets from the cache
+    if(!use_fanout)
+    {
+      MCUTRACE(1, trace_section << "TCP transport requires the split screen video in the room");
+      return FALSE;
+    }
+    int channel = (sc->media == MEDIA_TYPE_AUDIO ? 0 : 2);
+    PString interleaved = transport_dict("interleaved");
+    if(interleaved != "")
+      channel = interleaved.Tokenise("-")[0].AsInteger();
+    if(channel < 0 || channel > 254)
+    {
+      MCUTRACE(1, trace_section << "incorrect interleaved channel " << interleaved);
+      return FALSE;
+    }
+    if(sc->media == MEDIA_TYPE_AUDIO)
+      audio_interleaved = channel;
+    else
+      video_interleaved = channel;
+    listener->SetInterleaved(TRUE);
+
+    transport_dict.Append("interleaved", PString(channel)+"-"+PString(channel+1));
+    transport_str = transport_dict.AsString();
+    transport_str.Replace("=;",";",TRUE,0);
+    return TRUE;
+  }
+
   if(direction == DIRECTION_INBOUND)
   {
     sc->remote_ip = MCUURL(ruri_str).GetHostName();
@@ -786,11 +916,20 @@ BOOL MCURtspConnection::OnRequestPlay(const msg_t *msg)
   if(!conferenceMember || !conferenceMember->IsJoined())
     return FALSE;
 
-  // start rtp channels
-  CreateMediaChannel(MEDIA_TYPE_AUDIO, scap, 1);
-  CreateMediaChannel(MEDIA_TYPE_VIDEO, vcap, 1);
-  StartMediaChannel(MEDIA_TYPE_AUDIO, scap, 1);
-  StartMediaChannel(MEDIA_TYPE_VIDEO, vcap, 1);
+  if(use_fanout)
+  {
+    // the packets from the room caches
+    if(!StartFanout())
+      return FALSE;
+  }
+  else
+  {
+    // start rtp channels
+    CreateMediaChannel(MEDIA_TYPE_AUDIO, scap, 1);
+    CreateMediaChannel(MEDIA_TYPE_VIDEO, vcap, 1);
+    StartMediaChannel(MEDIA_TYPE_AUDIO, scap, 1);
+    StartMediaChannel(MEDIA_TYPE_VIDEO, vcap, 1);
+  }
 
   // is connected
   connectionState = EstablishedConnection;
@@ -837,6 +976,167 @@ BOOL MCURtspConnection::OnRequestTeardown(const msg_t *msg)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+BOOL MCURtspConnection::StartFanout()
+{
+  // cache names are the same as for the stream members, the caches are shared with them
+  SipCapability *sc = FindSipCap(RemoteSipCaps, MEDIA_TYPE_AUDIO, scap);
+  if(sc && sc->cap && (audio_interleaved >= 0 || sc->remote_port != 0))
+  {
+    const OpalMediaFormat & mf = sc->cap->GetMediaFormat();
+    unsigned clock = mf.GetTimeUnits() * 1000;
+    unsigned channels = mf.GetOptionInteger(OPTION_ENCODER_CHANNELS, 1);
+    audioTransmitCodecName = mf + "@" + PString(clock) + "/" + PString(channels) + "_" + requestedRoom;
+    if(!OpenAudioCache(requestedRoom, mf, audioTransmitCodecName))
+      return FALSE;
+
+    audio_subscriber = new MCURtspSubscriber(memberName, sc->payload, FALSE);
+    if(audio_interleaved >= 0)
+    {
+      audio_subscriber->listener = listener;
+      audio_subscriber->channel = audio_interleaved;
+    }
+    else
+      audio_subscriber->session = CreateRTPSession(sc);
+    if(!MCURtspFanout::Subscribe(audioTransmitCodecName, clock, mf.GetFrameTime(), audio_subscriber))
+      return FALSE;
+  }
+
+  sc = FindSipCap(RemoteSipCaps, MEDIA_TYPE_VIDEO, vcap);
+  if(sc && sc->cap && (video_interleaved >= 0 || sc->remote_port != 0))
+  {
+    const OpalMediaFormat & mf = sc->cap->GetMediaFormat();
+    unsigned frameRate = 90000 / PMAX(mf.GetOptionInteger(OPTION_FRAME_TIME, 9000), 1);
+    videoTransmitCodecName = mf + "@" + PString(mf.GetOptionInteger(OPTION_FRAME_WIDTH))
+                             + "x" + PString(mf.GetOptionInteger(OPTION_FRAME_HEIGHT))
+                             + ":" + PString(mf.GetOptionInteger(OPTION_MAX_BIT_RATE))
+                             + "x" + PString(frameRate)
+                             + "_" + requestedRoom + "/" + PString(videoMixerNumber);
+    if(!OpenVideoCache(requestedRoom, mf, videoTransmitCodecName))
+      return FALSE;
+
+    video_subscriber = new MCURtspSubscriber(memberName, sc->payload, TRUE);
+    if(video_interleaved >= 0)
+    {
+      video_subscriber->listener = listener;
+      video_subscriber->channel = video_interleaved;
+    }
+    else
+      video_subscriber->session = CreateRTPSession(sc);
+    if(!MCURtspFanout::Subscribe(videoTransmitCodecName, 90000, 0, video_subscriber))
+      return FALSE;
+  }
+
+  if(audio_subscriber == NULL && video_subscriber == NULL)
+  {
+    MCUTRACE(1, trace_section << "no media to play");
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCURtspConnection::StopFanout()
+{
+  if(audio_subscriber)
+  {
+    MCURtspFanout::Unsubscribe(audio_subscriber);
+    delete audio_subscriber;
+    audio_subscriber = NULL;
+  }
+  if(video_subscriber)
+  {
+    MCURtspFanout::Unsubscribe(video_subscriber);
+    delete video_subscriber;
+    video_subscriber = NULL;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCURtspConnection::SendLogicalChannelMiscCommand(H323Channel & channel, unsigned command)
+{
+  if(direction != DIRECTION_OUTBOUND || command != H245_MiscellaneousCommand_type::e_videoFastUpdatePicture)
+    return;
+
+  PTime now;
+  if(now < vfuSendTime + PTimeInterval(1000))
+    return;
+  vfuSendTime = now;
+
+  // the camera has no signalling for the intra-frame request, RTCP PLI
+  MCU_RTP_UDP *session = (MCU_RTP_UDP *)GetSession(channel.GetSessionID());
+  if(session)
+    session->SendPictureLoss();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCURtspConnection::SendKeepalive()
+{
+  if(direction != DIRECTION_OUTBOUND)
+    return;
+
+  // the listener thread is processing a message
+  if(!connMutex.Wait(0))
+    return;
+
+  if(rtsp_state == RTSP_PLAYING && PTime() - keepalive_time >= PTimeInterval(0, rtsp_session_timeout / 2))
+  {
+    keepalive_time = PTime();
+    SendOptions();
+  }
+
+  connMutex.Signal();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCURtspConnection::OnInterleaved(int channel, const BYTE *data, int size)
+{
+  // RTP on the even channel, RTCP on the next
+  MCUSIP_RTP_UDP *session = NULL;
+  int base = -1;
+  if(audio_interleaved_session && (channel == audio_interleaved || channel == audio_interleaved+1))
+  {
+    session = audio_interleaved_session;
+    base = audio_interleaved;
+  }
+  else if(video_interleaved_session && (channel == video_interleaved || channel == video_interleaved+1))
+  {
+    session = video_interleaved_session;
+    base = video_interleaved;
+  }
+  if(session == NULL)
+    return;
+
+  session->PutInterleaved(data, size, channel != base);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCURtspConnection::OnInterleavedWrite(unsigned sessionID, const BYTE *data, PINDEX size)
+{
+  int channel = (sessionID == RTP_Session::DefaultAudioSessionID ? audio_interleaved : video_interleaved);
+  if(channel < 0 || listener == NULL || size > 0xffff)
+    return;
+
+  // $, channel, length, RTCP packet
+  PBYTEArray packet(size + 4);
+  BYTE *ptr = packet.GetPointer();
+  ptr[0] = '$';
+  ptr[1] = (BYTE)(channel + 1);
+  ptr[2] = (BYTE)(size >> 8);
+  ptr[3] = (BYTE)size;
+  memcpy(ptr + 4, data, size);
+
+  // RTCP is not important, not sent if the socket is busy
+  listener->Send((const char *)ptr, size + 4, FALSE);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void MCURtspConnection::AddHeaders(char *buffer, PString method_name)
 {
   if(direction == DIRECTION_OUTBOUND && auth.type != HTTPAuth::AUTH_NONE && method_name != METHOD_OPTIONS)
@@ -971,12 +1271,30 @@ BOOL MCURtspConnection::OnResponseReceived(const msg_t *msg)
   {
     if(status == 200)
       response_code = OnResponseSetup(msg);
+    else if(status == 461 && !rtsp_tcp && rtsp_tcp_fallback)
+    {
+      // 461 Unsupported transport, the rest of the media over TCP
+      MCUTRACE(1, trace_section << "UDP transport is not supported, trying TCP interleaved");
+      rtsp_tcp = TRUE;
+      if(rtsp_state == RTSP_SETUP_AUDIO)
+        SendSetup(MEDIA_TYPE_AUDIO, scap);
+      else
+        SendSetup(MEDIA_TYPE_VIDEO, vcap);
+      return TRUE;
+    }
   }
   else if(rtsp_state == RTSP_PLAY)
   {
     if(status == 200)
       response_code = OnResponsePlay(msg);
   }
+  else if(rtsp_state == RTSP_PLAYING)
+  {
+    // keepalive
+    if(status != 200)
+      MCUTRACE(1, trace_section << "keepalive response " << status);
+    return TRUE;
+  }
   else if(rtsp_state == RTSP_TEARDOWN)
   {
     return TRUE;
@@ -1292,3 +1610,249 @@ void MCURtspServer::SendResponse(MCUSocket *socket, const msg_t *msg, const PStr
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCURtspSubscriber::MCURtspSubscriber(const PString & _name, int _payload, BOOL _video)
+  : name(_name), payload(_payload), video(_video)
+{
+  session = NULL;
+  listener = NULL;
+  channel = -1;
+
+  ssrc = random();
+  sequence = (WORD)random();
+  timestamp_offset = random();
+
+  started = FALSE;
+  failed = FALSE;
+  dropped = 0;
+  fanout = NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCURtspFanout::FanoutMap MCURtspFanout::fanoutList;
+PMutex MCURtspFanout::fanoutListMutex;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCURtspFanout::MCURtspFanout(const PString & _cacheName, BOOL _video, unsigned _clock, unsigned _frameTime)
+  : cacheName(_cacheName), video(_video), clock(_clock), frame_time(_frameTime)
+{
+  trace_section = "RTSP fanout "+cacheName+": ";
+  cache = NULL;
+  cache_seqn = 0;
+  keyframe_requested = FALSE;
+  running = FALSE;
+  thread = NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCURtspFanout::~MCURtspFanout()
+{
+  running = FALSE;
+  if(thread)
+  {
+    thread->WaitForTermination();
+    delete thread;
+    thread = NULL;
+  }
+  DetachCacheRTP(cache);
+  MCUTRACE(1, trace_section << "stopped");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL MCURtspFanout::Start()
+{
+  if(!AttachCacheRTP(cache, cacheName, cache_seqn))
+  {
+    MCUTRACE(1, trace_section << "cache not found");
+    return FALSE;
+  }
+  running = TRUE;
+  thread = PThread::Create(PCREATE_NOTIFIER(FanoutThread), 0, PThread::NoAutoDeleteThread, PThread::HighPriority, "rtsp_fanout:%0x");
+  MCUTRACE(1, trace_section << "started");
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL MCURtspFanout::Subscribe(const PString & cacheName, unsigned clock, unsigned frameTime, MCURtspSubscriber *subscriber)
+{
+  PWaitAndSignal m(fanoutListMutex);
+
+  MCURtspFanout *fanout = NULL;
+  FanoutMap::iterator it = fanoutList.find(cacheName);
+  if(it != fanoutList.end())
+    fanout = it->second;
+  else
+  {
+    fanout = new MCURtspFanout(cacheName, subscriber->video, clock, frameTime);
+    if(!fanout->Start())
+    {
+      delete fanout;
+      return FALSE;
+    }
+    fanoutList.insert(FanoutMap::value_type(cacheName, fanout));
+  }
+
+  PWaitAndSignal m2(fanout->mutex);
+  subscriber->fanout = fanout;
+  subscriber->started = !subscriber->video;
+  fanout->subscribers.push_back(subscriber);
+  if(subscriber->video)
+    fanout->RequestKeyFrame(subscriber->name);
+  MCUTRACE(1, fanout->trace_section << "subscribe " << subscriber->name << ", viewers " << fanout->subscribers.size());
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCURtspFanout::Unsubscribe(MCURtspSubscriber *subscriber)
+{
+  PWaitAndSignal m(fanoutListMutex);
+
+  MCURtspFanout *fanout = subscriber->fanout;
+  if(fanout == NULL)
+    return;
+
+  {
+    PWaitAndSignal m2(fanout->mutex);
+    fanout->subscribers.remove(subscriber);
+    subscriber->fanout = NULL;
+    MCUTRACE(1, fanout->trace_section << "unsubscribe " << subscriber->name << ", dropped " << subscriber->dropped << ", viewers " << fanout->subscribers.size());
+    if(fanout->subscribers.size() != 0)
+      return;
+  }
+
+  // the last viewer, the cache can go to sleep
+  fanoutList.erase(fanout->cacheName);
+  delete fanout;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCURtspFanout::RequestKeyFrame(const PString & source)
+{
+  keyframe_requested = TRUE;
+  keyframe_source = source;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCURtspFanout::Send(MCURtspSubscriber *subscriber, RTP_DataFrame & frame, PINDEX length, DWORD timestamp, unsigned flags)
+{
+  if(subscriber->failed)
+    return;
+
+  if(!subscriber->started)
+  {
+    if(!(flags & PluginCodec_ReturnCoderIFrame))
+      return;
+    subscriber->started = TRUE;
+  }
+
+  frame.SetPayloadSize(length);
+  frame.SetPayloadType((RTP_DataFrame::PayloadTypes)subscriber->payload);
+  frame.SetTimestamp(timestamp + subscriber->timestamp_offset);
+
+  if(subscriber->session)
+  {
+    if(!subscriber->session->PreWriteData(frame) || !subscriber->session->WriteData(frame))
+    {
+      MCUTRACE(1, trace_section << subscriber->name << " write error");
+      subscriber->failed = TRUE;
+    }
+    return;
+  }
+
+  frame.SetSequenceNumber(subscriber->sequence++);
+  frame.SetSyncSource(subscriber->ssrc);
+
+  // $, channel, length, RTP packet
+  PINDEX size = frame.GetHeaderSize() + length;
+  BYTE *data = packet.GetPointer(size + 4);
+  data[0] = '$';
+  data[1] = (BYTE)subscriber->channel;
+  data[2] = (BYTE)(size >> 8);
+  data[3] = (BYTE)size;
+  memcpy(data + 4, frame.GetPointer(), size);
+
+  // the slow viewer loses whole packets, the socket keeps the rest of a partially sent one,
+  // the others are not delayed
+  int ret = subscriber->listener->Send((const char *)data, size + 4, FALSE);
+  if(ret < 0)
+  {
+    // the rest is stuck or the socket is broken, the connection is closed by its listener thread
+    MCUTRACE(1, trace_section << subscriber->name << " write error, disconnect");
+    subscriber->failed = TRUE;
+    subscriber->listener->Shutdown();
+  }
+  else if(ret == 0)
+  {
+    subscriber->dropped++;
+    if(subscriber->video && subscriber->started)
+    {
+      subscriber->started = FALSE;
+      RequestKeyFrame(subscriber->name);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCURtspFanout::FanoutThread(PThread &, INT)
+{
+  RTP_DataFrame frame;
+  uint64_t start_time = MCUTime::GetMonoTimestampUsec();
+  int64_t audio_timestamp = -1;
+  DWORD timestamp = 0;
+  BOOL frame_start = TRUE;
+
+  while(running)
+  {
+    if(keyframe_requested)
+    {
+      PWaitAndSignal m(mutex);
+      cache->OnFastUpdatePicture(keyframe_source, false);
+      keyframe_requested = FALSE;
+    }
+
+    unsigned length = 0, flags = 0;
+    unsigned seqn = cache_seqn;
+    if(!GetCacheRTP(cache, frame, length, cache_seqn, flags))
+      break;
+
+    // the source timestamps, the viewers add own offsets
+    if(video)
+    {
+      if(frame_start)
+        timestamp = (DWORD)((MCUTime::GetMonoTimestampUsec() - start_time) * 90 / 1000);
+      frame_start = ((flags & PluginCodec_ReturnCoderLastFrame) != 0);
+    }
+    else
+    {
+      // the start and the gaps of the cache follow the clock
+      if(audio_timestamp < 0 || cache_seqn != seqn + 1)
+      {
+        int64_t t = (int64_t)(MCUTime::GetMonoTimestampUsec() - start_time) * clock / 1000000;
+        if(t > audio_timestamp)
+          audio_timestamp = t;
+      }
+      timestamp = (DWORD)audio_timestamp;
+      audio_timestamp += frame_time;
+    }
+
+    if(length == 0)
+      continue;
+
+    PWaitAndSignal m(mutex);
+    for(std::list<MCURtspSubscriber *>::iterator it = subscribers.begin(); it != subscribers.end(); ++it)
+      Send(*it, frame, length, timestamp, flags);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -26,6 +26,9 @@
 
 #include "sockets.h"
 
+#define RTSP_KEEPALIVE_TIMEOUT    60  // sec, if the server does not specify the session timeout
+#define RTSP_RECONNECT_MAX_DELAY  300 // sec, the autodial of the unavailable camera
+
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
 static const PString METHOD_OPTIONS    = "OPTIONS";
@@ -35,6 +38,8 @@ static const PString METHOD_PLAY       = "PLAY";
 static const PString METHOD_TEARDOWN   = "TEARDOWN";
 
 class ConferenceStreamMember;
+class MCURtspFanout;
+class MCURtspSubscriber;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -46,6 +51,11 @@ class MCURtspConnection : public MCUSipConnection
     virtual BOOL ClearCall(CallEndReason reason = EndedByLocalUser);
     virtual void CleanUpOnCallEnd();
 
+    virtual void SendLogicalChannelMiscCommand(H323Channel & channel, unsigned command);
+
+    // called by the connection monitor every second
+    void SendKeepalive();
+
   protected:
 
     enum RtspStates
@@ -89,6 +99,9 @@ class MCURtspConnection : public MCUSipConnection
     BOOL OnRequestTeardown(const msg_t *msg);
     BOOL OnRequestOptions(const msg_t *msg);
 
+    BOOL StartFanout();
+    void StopFanout();
+
     BOOL RtspCheckAuth(const msg_t *msg);
     BOOL ParseTransportStr(SipCapability *sc, PString & transport_str);
     void AddHeaders(char *buffer, PString method_name="");
@@ -103,7 +116,30 @@ class MCURtspConnection : public MCUSipConnection
     { return ((MCURtspConnection *)context)->OnReceived(socket, data); }
     int OnReceived(MCUSocket *socket, PString data);
 
+    // the camera media over the RTSP connection
+    static void OnInterleaved_wrap(void *context, int channel, const BYTE *data, int size)
+    { ((MCURtspConnection *)context)->OnInterleaved(channel, data, size); }
+    void OnInterleaved(int channel, const BYTE *data, int size);
+    static void OnInterleavedWrite_wrap(void *context, unsigned sessionID, const BYTE *data, PINDEX size)
+    { ((MCURtspConnection *)context)->OnInterleavedWrite(sessionID, data, size); }
+    void OnInterleavedWrite(unsigned sessionID, const BYTE *data, PINDEX size);
+
     MCUListener *listener;
+
+    // outbound, transport of the camera media
+    BOOL rtsp_tcp;
+    BOOL rtsp_tcp_fallback;    // UDP, TCP if the server does not support UDP
+    MCUSIP_RTP_UDP *audio_interleaved_session;
+    MCUSIP_RTP_UDP *video_interleaved_session;
+    int rtsp_session_timeout;  // sec
+    PTime keepalive_time;
+
+    // viewers of the room with the split screen video are served from the room caches
+    BOOL use_fanout;
+    int audio_interleaved; // TCP channel, -1 - UDP
+    int video_interleaved;
+    MCURtspSubscriber *audio_subscriber;
+    MCURtspSubscriber *video_subscriber;
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -143,6 +179,77 @@ class MCURtspServer
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// One media of the RTSP viewer, own SSRC, sequence and timestamp over the shared packets
+class MCURtspSubscriber
+{
+  public:
+    MCURtspSubscriber(const PString & _name, int _payload, BOOL _video);
+
+    PString name;
+    int payload;
+    BOOL video;
+
+    MCUSIP_RTP_UDP *session;  // UDP, the session numbers the packets and sends RTCP
+    MCUListener *listener;    // TCP interleaved
+    int channel;
+
+    DWORD ssrc;
+    WORD sequence;
+    DWORD timestamp_offset;
+
+    BOOL started;             // the video starts from a keyframe
+    BOOL failed;
+    unsigned dropped;
+
+    MCURtspFanout *fanout;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// The encoded packets of the room cache are sent to all RTSP viewers of the same format
+// by one thread, a viewer costs a socket write per packet instead of the own encoder.
+class MCURtspFanout : public PObject
+{
+  PCLASSINFO(MCURtspFanout, PObject);
+
+  public:
+    static BOOL Subscribe(const PString & cacheName, unsigned clock, unsigned frameTime, MCURtspSubscriber *subscriber);
+    static void Unsubscribe(MCURtspSubscriber *subscriber);
+
+  protected:
+    MCURtspFanout(const PString & _cacheName, BOOL _video, unsigned _clock, unsigned _frameTime);
+    ~MCURtspFanout();
+
+    BOOL Start();
+    void Send(MCURtspSubscriber *subscriber, RTP_DataFrame & frame, PINDEX length, DWORD timestamp, unsigned flags);
+    void RequestKeyFrame(const PString & source);
+
+    PString cacheName;
+    PString trace_section;
+    BOOL video;
+    unsigned clock;           // RTP, Hz
+    unsigned frame_time;      // RTP, audio
+
+    CacheRTP *cache;
+    unsigned cache_seqn;
+    BOOL keyframe_requested;
+    PString keyframe_source;
+
+    std::list<MCURtspSubscriber *> subscribers;
+    PBYTEArray packet;
+    PMutex mutex;
+
+    BOOL running;
+    PThread *thread;
+    PDECLARE_NOTIFIER(PThread, MCURtspFanout, FanoutThread);
+
+    typedef std::map<PString, MCURtspFanout *> FanoutMap;
+    static FanoutMap fanoutList;
+    static PMutex fanoutListMutex;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 class ConferenceStreamMember : public ConferenceMember
 {
   PCLASSINFO(ConferenceStreamMember, ConferenceMember);
@@ -457,6 +457,8 @@ MCUSipConnection::MCUSipConnection(MCUH323EndPoint *_ep, const PString & _callTo
   audio_rtp_port = 0;
   video_rtp_port = 0;
   rtp_proto = "RTP";
+  video_nack = FALSE;
+  audio_dtx = FALSE;
   stun = NULL;
 
   c_sip_msg = NULL;
@@ -798,6 +800,14 @@ BOOL MCUSipConnection::CreateMediaChannel(MediaTypes mtype, int pt, int rtp_dir)
   if(session == NULL)
     return FALSE;
 
+  // RTCP на порту данных, порт RTCP закрывается
+  if(sc->rtcp_mux)
+    session->SetRtcpMux(TRUE);
+
+  // пропуск декодирования пакетов без голоса
+  if(sc->media == MEDIA_TYPE_AUDIO && rtp_dir == 0)
+    session->SetAudioLevelId(sc->audio_level_id);
+
   if(sc->secure_type == SECURE_TYPE_ZRTP)
   {
     // master zrtp session
@@ -848,12 +858,20 @@ BOOL MCUSipConnection::CreateMediaChannel(MediaTypes mtype, int pt, int rtp_dir)
     else             session->CreateSRTP(rtp_dir, sc->srtp_local_type, sc->srtp_local_key);
   }
 
+  // RTCP не расшифровывается, NACK только без шифрования
+  if(sc->media == MEDIA_TYPE_VIDEO && rtp_dir == 1)
+    session->SetNack(video_nack && sc->nack && sc->secure_type == SECURE_TYPE_NONE, sc->rtx_payload);
+
   MCUSIP_RTPChannel *channel =
     new MCUSIP_RTPChannel(*this, *cap, ((rtp_dir == 0) ? H323Channel::IsReceiver : H323Channel::IsTransmitter), *session);
 
   if(pt >= RTP_DataFrame::DynamicBase && pt <= RTP_DataFrame::MaxPayloadType)
     channel->SetDynamicRTPPayloadType(pt);
 
+  // комфортный шум в паузах передачи звука
+  if(sc->media == MEDIA_TYPE_AUDIO && rtp_dir == 1 && audio_dtx)
+    channel->SetComfortNoise(sc->cn_payload);
+
   if(rtp_dir == 0)
     sc->inpChan = channel;
   else
@@ -935,6 +953,8 @@ void MCUSipConnection::CreateLocalSipCaps()
   PString video_fmtp = GetEndpointParam(VideoFmtpKey);
   unsigned frame_rate = GetEndpointParam(FrameRateFromKey, "0").AsInteger();
   unsigned bandwidth = GetEndpointParam(BandwidthFromKey, "0").AsInteger();
+  video_nack = (GetEndpointParam(VideoNackKey, DisableKey) == EnableKey);
+  audio_dtx = (GetEndpointParam(AudioDtxKey, DisableKey) == EnableKey);
 
   LocalSipCaps.clear();
   for(SipCapMapType::iterator it = sep->GetBaseSipCaps().begin(); it != sep->GetBaseSipCaps().end(); it++)
@@ -951,6 +971,11 @@ void MCUSipConnection::CreateLocalSipCaps()
 
     // create new SipCapability()
     SipCapability *local_sc = new SipCapability(*base_sc);
+    local_sc->rtcp_mux = TRUE;
+    if(base_sc->media == MEDIA_TYPE_AUDIO)
+      local_sc->audio_level_id = 1;
+    if(base_sc->media == MEDIA_TYPE_AUDIO && audio_dtx && base_sc->clock == 8000)
+      local_sc->cn_payload = RTP_DataFrame::CN;
 
     if(base_sc->media == MEDIA_TYPE_AUDIO && audio_capname != "")
     {
@@ -971,6 +996,7 @@ void MCUSipConnection::CreateLocalSipCaps()
       }
       local_sc->video_frame_rate = frame_rate;
       local_sc->bandwidth = bandwidth;
+      local_sc->nack = video_nack;
     }
 
     LocalSipCaps.insert(SipCapMapType::value_type(LocalSipCaps.size(), local_sc));
@@ -994,6 +1020,8 @@ int MCUSipConnection::CreateSdpOk()
         // send back the received fmtp
         if(local_sc->fmtp != "") sc->fmtp = local_sc->fmtp;
       }
+      // CN в ответе только если предложен терминалом
+      if(!audio_dtx) sc->cn_payload = -1;
       SipCaps.insert(SipCapMapType::value_type(SipCaps.size(), sc));
     }
   }
@@ -1009,6 +1037,10 @@ int MCUSipConnection::CreateSdpOk()
         // send back the received fmtp
         if(local_sc->fmtp != "") sc->fmtp = local_sc->fmtp;
       }
+      // NACK и RTX в ответе только если предложены терминалом
+      if(!video_nack) sc->nack = FALSE;
+      if(!sc->nack) sc->rtx_payload = -1;
+      // goog-remb остаётся в ответе только если предложен терминалом (sc->remb из RemoteSipCaps)
       SipCaps.insert(SipCapMapType::value_type(SipCaps.size(), sc));
     }
   }
@@ -1120,11 +1152,129 @@ sdp_media_t * MCUSipConnection::CreateSdpMedia(SipCapMapType & LocalCaps, su_hom
   }
   if(!m->m_rtpmaps)
     return NULL;
+
+  if(m_type == sdp_media_video)
+    CreateSdpFeedback(LocalCaps, sess_home, m);
+
+  // комфортный шум, один раз для аудио
+  for(SipCapMapType::iterator it = LocalCaps.begin(); m_type == sdp_media_audio && it != LocalCaps.end(); it++)
+  {
+    SipCapability *sc = it->second;
+    if(sc->media != MEDIA_TYPE_AUDIO || sc->cn_payload < 0)
+      continue;
+    sdp_rtpmap_t *r = m->m_rtpmaps;
+    while(r && (int)r->rm_pt != sc->cn_payload) r = r->rm_next;
+    if(r != NULL)
+      break;
+    sdp_rtpmap_t *rm_new = (sdp_rtpmap_t *)su_salloc(sess_home, sizeof(*rm_new));
+    rm_new->rm_predef = 0;
+    rm_new->rm_pt = sc->cn_payload;
+    rm_new->rm_encoding = PStringToChar("CN");
+    rm_new->rm_rate = sc->clock;
+    rm = rm->rm_next = rm_new;
+    break;
+  }
+
+  // уровень звука от терминала, в ответе с id из предложения
+  for(SipCapMapType::iterator it = LocalCaps.begin(); m_type == sdp_media_audio && it != LocalCaps.end(); it++)
+  {
+    SipCapability *sc = it->second;
+    if(sc->media != MEDIA_TYPE_AUDIO || sc->audio_level_id <= 0)
+      continue;
+    sdp_attribute_t *a = m->m_attributes;
+    while(a && a->a_next) a = a->a_next;
+    sdp_attribute_t *a_new = CreateSdpAttr(sess_home, "extmap", PString(sc->audio_level_id)+" "+RTP_AUDIO_LEVEL_URN);
+    if(!a) m->m_attributes = a_new;
+    else   a->a_next = a_new;
+    break;
+  }
+
+  // rtcp-mux в ответе только если предложен терминалом
+  for(SipCapMapType::iterator it = LocalCaps.begin(); it != LocalCaps.end(); it++)
+  {
+    SipCapability *sc = it->second;
+    if(!sc->rtcp_mux || sc->media != ((m_type == sdp_media_audio) ? MEDIA_TYPE_AUDIO : MEDIA_TYPE_VIDEO))
+      continue;
+    sdp_attribute_t *a = m->m_attributes;
+    while(a && a->a_next) a = a->a_next;
+    sdp_attribute_t *a_new = CreateSdpAttr(sess_home, "rtcp-mux", "");
+    if(!a) m->m_attributes = a_new;
+    else   a->a_next = a_new;
+    break;
+  }
+
   return m;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void MCUSipConnection::CreateSdpFeedback(SipCapMapType & LocalCaps, su_home_t *sess_home, sdp_media_t *m)
+{
+  sdp_attribute_t *a = m->m_attributes;
+  while(a && a->a_next) a = a->a_next;
+  sdp_rtpmap_t *rm = m->m_rtpmaps;
+  while(rm && rm->rm_next) rm = rm->rm_next;
+
+  for(SipCapMapType::iterator it = LocalCaps.begin(); it != LocalCaps.end(); it++)
+  {
+    SipCapability *sc = it->second;
+    if(sc->media != MEDIA_TYPE_VIDEO || (!sc->nack && !sc->remb))
+      continue;
+
+    // only for payload types present in media, once per payload type
+    PStringArray fbs;
+    if(sc->remb) fbs.AppendString(PString(sc->payload)+" goog-remb");
+    if(sc->nack) fbs.AppendString(PString(sc->payload)+" nack");
+    bool found = false, done = false;
+    for(sdp_rtpmap_t *r = m->m_rtpmaps; r != NULL; r = r->rm_next)
+    {
+      if((int)r->rm_pt == sc->payload) found = true;
+    }
+    for(sdp_attribute_t *r = m->m_attributes; r != NULL; r = r->a_next)
+    {
+      if(r->a_value && PString(r->a_name) == "rtcp-fb" && fbs.GetStringsIndex(r->a_value) != P_MAX_INDEX) done = true;
+    }
+    if(!found || done)
+      continue;
+
+    for(PINDEX i = 0; i < fbs.GetSize(); i++)
+    {
+      sdp_attribute_t *a_new = CreateSdpAttr(sess_home, "rtcp-fb", fbs[i]);
+      if(!m->m_attributes) a = m->m_attributes = a_new;
+      else                 a = a->a_next = a_new;
+    }
+    if(!sc->nack)
+      continue;
+
+    // PLI вместо H.245/INFO fast update
+    a = a->a_next = CreateSdpAttr(sess_home, "rtcp-fb", PString(sc->payload)+" nack pli");
+
+    // RTX payload type for offer
+    if(sc->rtx_payload < 0 && direction == DIRECTION_OUTBOUND)
+    {
+      for(int pt = RTP_DataFrame::DynamicBase; pt <= RTP_DataFrame::MaxPayloadType && sc->rtx_payload < 0; ++pt)
+      {
+        sdp_rtpmap_t *r = m->m_rtpmaps;
+        while(r && (int)r->rm_pt != pt) r = r->rm_next;
+        if(r == NULL && !FindSipCap(LocalCaps, MEDIA_TYPE_VIDEO, pt))
+          sc->rtx_payload = pt;
+      }
+    }
+    if(sc->rtx_payload < 0)
+      continue;
+
+    sdp_rtpmap_t *rm_new = (sdp_rtpmap_t *)su_salloc(sess_home, sizeof(*rm_new));
+    rm_new->rm_predef = 0;
+    rm_new->rm_pt = sc->rtx_payload;
+    rm_new->rm_encoding = PStringToChar("rtx");
+    rm_new->rm_rate = sc->clock;
+    rm_new->rm_fmtp = PStringToChar("apt="+PString(sc->payload));
+    rm = rm->rm_next = rm_new;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 sdp_attribute_t * MCUSipConnection::CreateSdpAttr(su_home_t *sess_home, PString m_name, PString m_value)
 {
   sdp_attribute_t *a = (sdp_attribute_t *)su_salloc(sess_home, sizeof(*a));
@@ -1194,9 +1344,10 @@ PString MCUSipConnection::CreateSdpStr(SipCapMapType & LocalCaps)
       m_audio_srtp->m_proto = sdp_proto_srtp;
       key_audio80 = srtp_get_random_keysalt();
       key_audio32 = srtp_get_random_keysalt();
-      sdp_attribute_t *a = NULL;
+      sdp_attribute_t *a = NULL, *attrs = m_audio_srtp->m_attributes;
       a = m_audio_srtp->m_attributes = CreateSdpAttr(sess_home, "crypto", "1 AES_CM_128_HMAC_SHA1_80 inline:"+key_audio80);
       a = a->a_next = CreateSdpAttr(sess_home, "crypto", "2 AES_CM_128_HMAC_SHA1_32 inline:"+key_audio32);
+      a->a_next = attrs;
       //a = a->a_next = CreateSdpAttr(sess_home, "encryption", "optional");
     }
     if(m_video_srtp)
@@ -1204,9 +1355,10 @@ PString MCUSipConnection::CreateSdpStr(SipCapMapType & LocalCaps)
       m_video_srtp->m_proto = sdp_proto_srtp;
       key_video80 = srtp_get_random_keysalt();
       key_video32 = srtp_get_random_keysalt();
-      sdp_attribute_t *a = NULL;
+      sdp_attribute_t *a = NULL, *attrs = m_video_srtp->m_attributes;
       a = m_video_srtp->m_attributes = CreateSdpAttr(sess_home, "crypto", "1 AES_CM_128_HMAC_SHA1_80 inline:"+key_video80);
       a = a->a_next = CreateSdpAttr(sess_home, "crypto", "2 AES_CM_128_HMAC_SHA1_32 inline:"+key_video32);
+      a->a_next = attrs;
       //a = a->a_next = CreateSdpAttr(sess_home, "encryption", "optional");
     }
   }
@@ -1882,7 +2034,29 @@ int MCUSipConnection::ProcessSDP(SipCapMapType & LocalCaps, SipCapMapType & Remo
         // attributes
         for(sdp_attribute_t *a = m->m_attributes; a != NULL; a = a->a_next)
         {
+          if(PString(a->a_name) == "rtcp-mux")
+            sc->rtcp_mux = TRUE;
+          // a=extmap:<id>[/direction] <uri> [attributes]
+          if(PString(a->a_name) == "extmap" && a->a_value && media_type == MEDIA_TYPE_AUDIO)
+          {
+            PStringArray ext = PString(a->a_value).Tokenise(" ", FALSE);
+            if(ext.GetSize() >= 2 && ext[1] == RTP_AUDIO_LEVEL_URN)
+            {
+              int id = ext[0].Tokenise("/")[0].AsInteger();
+              if(id > 0 && id < 15)
+                sc->audio_level_id = id;
+            }
+          }
           sc->attr.SetAt(a->a_name, a->a_value);
+          // generic NACK без уточнения типа, REMB
+          if(PString(a->a_name) == "rtcp-fb" && a->a_value)
+          {
+            PStringArray fb = PString(a->a_value).Tokenise(" ", FALSE);
+            if(fb.GetSize() == 2 && fb[1] == "nack" && (fb[0] == "*" || fb[0] == PString(sc->payload)))
+              sc->nack = TRUE;
+            if(fb.GetSize() == 2 && fb[1] == "goog-remb" && (fb[0] == "*" || fb[0] == PString(sc->payload)))
+              sc->remb = TRUE;
+          }
         }
         RemoteCaps.insert(SipCapMapType::value_type(RemoteCaps.size(), sc));
       }
@@ -1892,6 +2066,36 @@ int MCUSipConnection::ProcessSDP(SipCapMapType & LocalCaps, SipCapMapType & Remo
 
   MergeSipCaps(LocalCaps, RemoteCaps);
 
+  // RTX for selected video capability
+  if(vcap >= 0)
+  {
+    SipCapability *sc = FindSipCap(RemoteCaps, MEDIA_TYPE_VIDEO, vcap);
+    for(SipCapMapType::iterator it = RemoteCaps.begin(); sc && it != RemoteCaps.end(); it++)
+    {
+      SipCapability *rtx_sc = it->second;
+      if(rtx_sc->media != MEDIA_TYPE_VIDEO || rtx_sc->format != "rtx")
+        continue;
+      PStringArray keys = rtx_sc->fmtp.Tokenise(";", FALSE);
+      for(PINDEX kn = 0; kn < keys.GetSize(); kn++)
+      {
+        if(keys[kn] == "apt="+PString(sc->payload))
+          sc->rtx_payload = rtx_sc->payload;
+      }
+    }
+  }
+
+  // CN for selected audio capability
+  if(scap >= 0)
+  {
+    SipCapability *sc = FindSipCap(RemoteCaps, MEDIA_TYPE_AUDIO, scap);
+    for(SipCapMapType::iterator it = RemoteCaps.begin(); sc && it != RemoteCaps.end(); it++)
+    {
+      SipCapability *cn_sc = it->second;
+      if(cn_sc->media == MEDIA_TYPE_AUDIO && cn_sc->format == "cn" && cn_sc->clock == sc->clock)
+        sc->cn_payload = cn_sc->payload;
+    }
+  }
+
   if(scap < 0 && vcap < 0)
   {
     PTRACE(1, trace_section << "SDP parsing error: compatible codecs not found");
@@ -2197,7 +2401,7 @@ void MCUSipConnection::OnReceivedVFU()
 
   PWaitAndSignal m(channelsMutex);
   if(videoTransmitChannel)
-    videoTransmitChannel->OnFastUpdatePicture();
+    videoTransmitChannel->OnFastUpdatePicture(memberName);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -3134,6 +3338,9 @@ int MCUSipEndPoint::ProcessSipEvent_cb(nta_agent_t *agent, msg_t *msg, sip_t *si
     PString callToken = GetSipCallToken(msg);
     if(ep->HasConnection(callToken))
       return 0;
+    // overload, new calls are rejected
+    if(OpenMCU::Current().GetOverloadController().RejectCalls())
+      return SipReqReply(msg, NULL, SIP_503_SERVICE_UNAVAILABLE);
     // redirect to the registrar
     return registrar->OnReceivedSipInvite(msg);
   }
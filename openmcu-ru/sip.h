@@ -173,6 +173,12 @@ class SipCapability
       video_width = 0;
       video_height = 0;
       video_frame_rate = 0;
+      nack = FALSE;
+      rtx_payload = -1;
+      remb = FALSE;
+      rtcp_mux = FALSE;
+      audio_level_id = -1;
+      cn_payload = -1;
     }
     void Print();
     int CmpSipCaps(SipCapability &c)
@@ -192,6 +198,12 @@ class SipCapability
       if(srtp_remote_type != c.srtp_remote_type) return 1;
       if(srtp_remote_key != c.srtp_remote_key) return 1;
       if(srtp_remote_param != c.srtp_remote_param) return 1;
+      if(nack != c.nack) return 1;
+      if(rtx_payload != c.rtx_payload) return 1;
+      if(remb != c.remb) return 1;
+      if(rtcp_mux != c.rtcp_mux) return 1;
+      if(audio_level_id != c.audio_level_id) return 1;
+      if(cn_payload != c.cn_payload) return 1;
       inpChan = c.inpChan;
       outChan = c.outChan;
       return 0;
@@ -211,6 +223,12 @@ class SipCapability
     unsigned video_width;
     unsigned video_height;
     unsigned video_frame_rate;
+    BOOL nack; // a=rtcp-fb:<pt> nack
+    int rtx_payload; // RTX payload type (apt=<payload>), -1 - нет
+    BOOL remb; // a=rtcp-fb:<pt> goog-remb
+    BOOL rtcp_mux; // a=rtcp-mux, RTP и RTCP на одном порту
+    int audio_level_id; // a=extmap:<id> ssrc-audio-level (RFC 6464), -1 - нет
+    int cn_payload; // comfort noise payload type (RFC 3389), -1 - нет
     PString params;
     PStringToString attr;
     MCUCapability *cap;
@@ -311,6 +329,7 @@ class MCUSipConnection : public MCUH323Connection
     sdp_rtpmap_t *CreateSdpRtpmap(su_home_t *sess_home, SipCapability *sc);
     sdp_media_t *CreateSdpMedia(SipCapMapType & LocalCaps, su_home_t *sess_home, sdp_media_e m_type, sdp_proto_e m_proto);
     sdp_attribute_t *CreateSdpAttr(su_home_t *sess_home, PString m_name, PString m_value);
+    void CreateSdpFeedback(SipCapMapType & LocalCaps, su_home_t *sess_home, sdp_media_t *m);
     sdp_parser_t *SdpParser(PString sdp_str);
 
     PString CreateSdpStr(SipCapMapType & LocalCaps);
@@ -338,6 +357,8 @@ class MCUSipConnection : public MCUH323Connection
 
     PString rtp_proto;
     unsigned remote_bw; // bandwidth to MCU
+    BOOL video_nack; // повторная передача видео по NACK
+    BOOL audio_dtx; // паузы в передаче звука с комфортным шумом
 
     PString key_audio80;
     PString key_audio32;
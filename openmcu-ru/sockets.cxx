@@ -226,6 +226,17 @@ MCUSocket::MCUSocket(int fd, int proto, const PString & host, int port)
   socket_timeout_sec = 0;
   socket_timeout_usec = 250000;
 
+  interleaved = FALSE;
+  interleaved_line_start = TRUE;
+  interleaved_skip = 0;
+  interleaved_header_size = 0;
+  interleaved_callback = NULL;
+  interleaved_context = NULL;
+  interleaved_data_size = 0;
+
+  send_pending_size = 0;
+  send_pending_time = 0;
+
   if(socket_proto == SOCK_STREAM)
     socket_address += "tcp:";
   else
@@ -476,16 +487,201 @@ BOOL MCUSocket::GetSocketAddress(int fd, int & proto, PString & host, int & port
 BOOL MCUSocket::SendData(const char *buffer)
 {
   int len = strlen(buffer);
-  if(send(socket_fd, buffer, len, 0) == -1)
-  {
-    MCUTRACE(1, trace_section << "send error: " << errno << " " << strerror(errno));
+  if(SendData(buffer, len) != len)
     return FALSE;
-  }
   return TRUE;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+int MCUSocket::SendData(const char *buffer, int len, BOOL wait)
+{
+  // without wait the other sender is not waited for either
+  if(wait)
+    send_mutex.Wait();
+  else if(!send_mutex.Wait(0))
+    return 0;
+  int ret = SendBuffer(buffer, len, wait);
+  send_mutex.Signal();
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int MCUSocket::SendBuffer(const char *buffer, int len, BOOL wait)
+{
+  // the rest of the previous data goes first, otherwise the stream is broken
+  if(send_pending_size > 0)
+  {
+    if(SendPending(wait) < 0)
+      return -1;
+    if(send_pending_size > 0)
+    {
+      if(MCUTime::GetMonoTimestampUsec() - send_pending_time > (uint64_t)MCU_SOCKET_SEND_TIMEOUT * 1000)
+      {
+        MCUTRACE(1, trace_section << "send timeout, " << send_pending_size << " bytes pending");
+        return -1;
+      }
+      // the whole data is dropped
+      return 0;
+    }
+  }
+
+  int sent = 0;
+  while(sent < len)
+  {
+    int flags = 0;
+#ifdef MSG_DONTWAIT
+    if(!wait)
+      flags |= MSG_DONTWAIT;
+#endif
+    int ret = send(socket_fd, buffer + sent, len - sent, flags);
+    if(ret > 0)
+    {
+      sent += ret;
+      continue;
+    }
+    int error = errno;
+    if(ret < 0 && error == EINTR)
+      continue;
+    if(ret < 0 && (error == EAGAIN || error == EWOULDBLOCK))
+    {
+      // nothing is sent, the data can be dropped
+      if(sent == 0)
+        return 0;
+      if(wait)
+      {
+        if(WaitWritable(MCU_SOCKET_SEND_TIMEOUT))
+          continue;
+        MCUTRACE(1, trace_section << "send timeout");
+        return -1;
+      }
+      // the rest is sent with the next call, the caller does not wait
+      send_pending_size = len - sent;
+      memcpy(send_pending.GetPointer(send_pending_size), buffer + sent, send_pending_size);
+      send_pending_time = MCUTime::GetMonoTimestampUsec();
+      return len;
+    }
+    MCUTRACE(1, trace_section << "send error: " << error << " " << strerror(error));
+    return -1;
+  }
+  return sent;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int MCUSocket::SendPending(BOOL wait)
+{
+  int sent = 0;
+  while(sent < send_pending_size)
+  {
+    int flags = 0;
+#ifdef MSG_DONTWAIT
+    if(!wait)
+      flags |= MSG_DONTWAIT;
+#endif
+    int ret = send(socket_fd, (const char *)(const BYTE *)send_pending + sent, send_pending_size - sent, flags);
+    if(ret > 0)
+    {
+      sent += ret;
+      continue;
+    }
+    int error = errno;
+    if(ret < 0 && error == EINTR)
+      continue;
+    if(ret < 0 && (error == EAGAIN || error == EWOULDBLOCK))
+    {
+      if(wait && WaitWritable(MCU_SOCKET_SEND_TIMEOUT))
+        continue;
+      if(wait)
+      {
+        MCUTRACE(1, trace_section << "send timeout");
+        return -1;
+      }
+      break;
+    }
+    MCUTRACE(1, trace_section << "send error: " << error << " " << strerror(error));
+    return -1;
+  }
+  if(sent > 0)
+  {
+    send_pending_size -= sent;
+    memmove(send_pending.GetPointer(), send_pending.GetPointer() + sent, send_pending_size);
+  }
+  return send_pending_size;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUSocket::Shutdown()
+{
+  if(socket_fd == -1)
+    return;
+#ifdef _WIN32
+  shutdown(socket_fd, SD_BOTH);
+#else
+  shutdown(socket_fd, SHUT_RDWR);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL MCUSocket::WaitWritable(int timeout_ms)
+{
+  struct timeval tv;
+  fd_set fdset;
+  tv.tv_sec = timeout_ms / 1000;
+  tv.tv_usec = (timeout_ms % 1000) * 1000;
+  FD_ZERO(&fdset);
+  FD_SET(socket_fd, &fdset);
+  return (select(socket_fd+1, NULL, &fdset, NULL, &tv) > 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int MCUSocket::SkipInterleaved(char *buffer, int len)
+{
+  // $, channel, 2 bytes length, data - at the start of a line only,
+  // the header and the data can be split between reads
+  int out = 0;
+  for(int i = 0; i < len; )
+  {
+    if(interleaved_skip > 0)
+    {
+      int skip = PMIN(interleaved_skip, len - i);
+      if(interleaved_callback)
+      {
+        memcpy(interleaved_data.GetPointer(interleaved_data_size + skip) + interleaved_data_size, buffer + i, skip);
+        interleaved_data_size += skip;
+      }
+      interleaved_skip -= skip;
+      i += skip;
+      if(interleaved_skip == 0 && interleaved_callback)
+      {
+        interleaved_callback(interleaved_context, interleaved_header[1], interleaved_data, interleaved_data_size);
+        interleaved_data_size = 0;
+      }
+      continue;
+    }
+    if(interleaved_header_size > 0 || (interleaved_line_start && buffer[i] == '$'))
+    {
+      interleaved_header[interleaved_header_size++] = buffer[i++];
+      if(interleaved_header_size == 4)
+      {
+        interleaved_skip = (interleaved_header[2] << 8) | interleaved_header[3];
+        interleaved_header_size = 0;
+        interleaved_data_size = 0;
+      }
+      continue;
+    }
+    interleaved_line_start = (buffer[i] == '\n');
+    buffer[out++] = buffer[i++];
+  }
+  return out;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 BOOL MCUSocket::RecvData(PString & data)
 {
   char buffer[16384];
@@ -498,10 +694,19 @@ BOOL MCUSocket::RecvData(PString & data)
     int error = errno;
     if(len > 0)
     {
+      if(interleaved)
+      {
+        len = SkipInterleaved(buffer, len);
+        if(len == 0)
+          continue;
+      }
       buffer[len] = 0;
       data += buffer;
       if(data.GetLength() >= 65535)
         return TRUE;
+      // the media stream has no pauses, the message is returned as soon as the headers are received
+      if(interleaved && data.Find("\r\n\r\n") != P_MAX_INDEX)
+        return TRUE;
     }
     else if(len < 0)
     {
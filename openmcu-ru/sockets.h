@@ -28,6 +28,8 @@
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+#define MCU_SOCKET_SEND_TIMEOUT   1000 // msec, the rest of the partially sent data
+
 enum MCUListenerType
 {
   NONE = 0,
@@ -37,6 +39,11 @@ enum MCUListenerType
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// RTSP interleaved binary data: channel, RTP or RTCP packet
+typedef void mcu_interleaved_cb(void *callback_context, int channel, const BYTE *data, int size);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 class MCUSocket
 {
   public:
@@ -53,6 +60,14 @@ class MCUSocket
     MCUSocket * Accept();
 
     BOOL SendData(const char *buffer);
+    // binary data, returns the size or -1 on error,
+    // without wait returns 0 when the send buffer is full and the data is dropped,
+    // the rest of the partially sent data is kept and goes first with the next call,
+    // -1 if it is not sent within MCU_SOCKET_SEND_TIMEOUT
+    int SendData(const char *buffer, int len, BOOL wait = TRUE);
+
+    // the reading thread gets the end of the connection
+    void Shutdown();
 
     BOOL RecvData(PString & data);
     BOOL ReadData(PString & data);
@@ -81,7 +96,19 @@ class MCUSocket
     int GetSocket()
     { return socket_fd; }
 
+    // RTSP interleaved binary data ($, channel, length) is removed from the received text
+    // and passed to the callback if set
+    void SetInterleaved(BOOL enable, mcu_interleaved_cb *callback = NULL, void *callback_context = NULL)
+    { interleaved = enable; interleaved_callback = callback; interleaved_context = callback_context; }
+
   protected:
+    int SkipInterleaved(char *buffer, int len);
+    BOOL WaitWritable(int timeout_ms);
+    // called with send_mutex
+    int SendBuffer(const char *buffer, int len, BOOL wait);
+    // returns the bytes still pending or -1 on error
+    int SendPending(BOOL wait);
+
     PString trace_section;
 
     PString socket_address;
@@ -92,6 +119,20 @@ class MCUSocket
     int socket_timeout_usec;
 
     int socket_fd;
+    PMutex send_mutex;
+    PBYTEArray send_pending;        // the rest of the partially sent data
+    int send_pending_size;
+    uint64_t send_pending_time;     // usec, when the rest was kept
+
+    BOOL interleaved;
+    BOOL interleaved_line_start;
+    int interleaved_skip;           // bytes of the binary data left
+    BYTE interleaved_header[4];
+    int interleaved_header_size;
+    mcu_interleaved_cb *interleaved_callback;
+    void *interleaved_context;
+    PBYTEArray interleaved_data;
+    int interleaved_data_size;
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -108,6 +149,14 @@ class MCUListener
     static MCUListener * Create(MCUListenerType type, MCUSocket *socket, mcu_listener_cb *callback, void *callback_context);
 
     BOOL Send(const char *buffer);
+    int Send(const char *buffer, int len, BOOL wait)
+    { return socket->SendData(buffer, len, wait); }
+
+    void Shutdown()
+    { socket->Shutdown(); }
+
+    void SetInterleaved(BOOL enable, mcu_interleaved_cb *callback = NULL, void *callback_context = NULL)
+    { socket->SetInterleaved(enable, callback, callback_context); }
 
     BOOL IsRunning()
     { return running; }
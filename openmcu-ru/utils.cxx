@@ -18,6 +18,14 @@ PString GetPluginName(const PString & formatName)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+static PString GetConfigString(const PString & section, const PString & param)
+{
+  const MCUConfigSnapshot * snapshot = MCUConfigSnapshot::Current();
+  if(snapshot)
+    return snapshot->GetString(section, param);
+  return MCUConfig(section).GetString(param);
+}
+
 PString GetSectionParam(PString section_prefix, PString param, PString addr, bool asterisk)
 {
   PString user, host;
@@ -36,13 +44,13 @@ PString GetSectionParam(PString section_prefix, PString param, PString addr, boo
   }
 
   if(value == "")
-    value = MCUConfig(section_prefix+addr).GetString(param);
+    value = GetConfigString(section_prefix+addr, param);
   if(value == "")
-    value = MCUConfig(section_prefix+user).GetString(param);
+    value = GetConfigString(section_prefix+user, param);
   if(value == "")
-    value = MCUConfig(section_prefix+host).GetString(param);
+    value = GetConfigString(section_prefix+host, param);
   if(value == "" && asterisk == true)
-    value = MCUConfig(section_prefix+"*").GetString(param);
+    value = GetConfigString(section_prefix+"*", param);
 
   return value;
 }
@@ -81,6 +89,8 @@ void SetSectionParam(PString section_prefix, PString param, PString addr, PStrin
   else
     MCUConfig(section_prefix+user).SetString(param, value);
 
+  MCUConfigSnapshot::Reload();
+
   // refresh the settings page
   OpenMCU::Current().CreateHTTPResource(httpResource);
 }
@@ -141,9 +151,8 @@ PString GetSectionParamFromUrl(PString param, PString addr, PString defaultValue
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-int GetConferenceParam(PString room, PString param, int defaultValue)
+static int ParseConferenceParam(PString value, int defaultValue)
 {
-  PString value = GetConferenceParam(room, param, "");
   if(value.ToLower() == "enable" || value.ToLower() == "true")
     return 1;
   else if(value.ToLower() == "disable" || value.ToLower() == "false")
@@ -156,7 +165,15 @@ int GetConferenceParam(PString room, PString param, int defaultValue)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
-PString GetConferenceParam(PString room, PString param, PString defaultValue)
+int GetConferenceParam(PString room, PString param, int defaultValue)
+{
+  return ParseConferenceParam(GetConferenceParam(room, param, ""), defaultValue);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// built-in parameters of the service rooms, "" if the room is an ordinary one
+static PString GetConferenceParamOverride(const PString & room, const PString & param)
 {
 #if ENABLE_TEST_ROOMS
   if(room.Left(8) == "testroom")
@@ -202,9 +219,17 @@ PString GetConferenceParam(PString room, PString param, PString defaultValue)
     if(param == RoomAllowRecordKey)
       return "Enable";
   }
+  return "";
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PString GetConferenceParam(PString room, PString param, PString defaultValue)
+{
+  PString value = GetConferenceParamOverride(room, param);
+  if(value != "")
+    return value;
 
-  PString section;
-  PString value;
   PString sectionPrefix = "Conference ";
 
   value = MCUConfig(sectionPrefix+room).GetString(param);
@@ -229,6 +254,182 @@ PString GetConferenceParam(PString room, PString param, PString defaultValue)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+static int ParseAutoRecordParam(const PString & value)
+{
+  if(value == "Disable" || value == "")
+    return -1;
+  return value.AsInteger();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCUConferenceConfig::MCUConferenceConfig()
+{
+  autoCreate = FALSE;
+  autoCreateWhenConnecting = TRUE;
+  forceSplitVideo = TRUE;
+  autoDeleteEmpty = FALSE;
+  allowRecord = TRUE;
+  recallLastTemplate = FALSE;
+  lockTemplate = FALSE;
+  timeLimit = 0;
+  autoRecordStart = -1;
+  autoRecordStop = -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUConferenceConfig::Load(const PString & room)
+{
+  autoCreate               = GetConferenceParam(room, RoomAutoCreateKey, FALSE);
+  autoCreateWhenConnecting = GetConferenceParam(room, RoomAutoCreateWhenConnectingKey, TRUE);
+  forceSplitVideo          = GetConferenceParam(room, ForceSplitVideoKey, TRUE);
+  autoDeleteEmpty          = GetConferenceParam(room, RoomAutoDeleteEmptyKey, FALSE);
+  allowRecord              = GetConferenceParam(room, RoomAllowRecordKey, TRUE);
+  recallLastTemplate       = GetConferenceParam(room, RoomRecallLastTemplateKey, FALSE);
+  lockTemplate             = GetConferenceParam(room, LockTemplateKey, FALSE);
+  timeLimit                = GetConferenceParam(room, RoomTimeLimitKey, 0);
+  autoRecordStart          = ParseAutoRecordParam(GetConferenceParam(room, RoomAutoRecordStartKey, "Disable"));
+  autoRecordStop           = ParseAutoRecordParam(GetConferenceParam(room, RoomAutoRecordStopKey, "Disable"));
+  mediaPlayerFile          = GetConferenceParam(room, RoomMediaPlayerKey, "");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUConferenceConfig::ApplyOverrides(const PString & room)
+{
+  PString value;
+  if((value = GetConferenceParamOverride(room, ForceSplitVideoKey)) != "")
+    forceSplitVideo = ParseConferenceParam(value, forceSplitVideo);
+  if((value = GetConferenceParamOverride(room, RoomAutoDeleteEmptyKey)) != "")
+    autoDeleteEmpty = ParseConferenceParam(value, autoDeleteEmpty);
+  if((value = GetConferenceParamOverride(room, RoomAllowRecordKey)) != "")
+    allowRecord = ParseConferenceParam(value, allowRecord);
+  if((value = GetConferenceParamOverride(room, RoomAutoRecordStartKey)) != "")
+    autoRecordStart = ParseAutoRecordParam(value);
+  if((value = GetConferenceParamOverride(room, RoomAutoRecordStopKey)) != "")
+    autoRecordStop = ParseAutoRecordParam(value);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCUConfigSnapshot * volatile MCUConfigSnapshot::current = NULL;
+std::deque<MCUConfigSnapshot *> MCUConfigSnapshot::retired;
+PMutex MCUConfigSnapshot::reloadMutex;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCUConfigSnapshot::MCUConfigSnapshot()
+{
+  retireTime = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUConfigSnapshot::Reload()
+{
+  PWaitAndSignal m(reloadMutex);
+
+  MCUConfigSnapshot * snapshot = new MCUConfigSnapshot();
+
+  PString conferencePrefix = "Conference ";
+  PStringList sect = MCUConfig().GetSections();
+  for(PINDEX i = 0; i < sect.GetSize(); ++i)
+  {
+    MCUConfig cfg(sect[i]);
+    KeyMap & keyMap = snapshot->sections[sect[i]];
+    PStringList keys = cfg.GetKeys();
+    for(PINDEX j = 0; j < keys.GetSize(); ++j)
+      keyMap[keys[j]] = cfg.GetString(keys[j]);
+
+    if(sect[i].Left(conferencePrefix.GetLength()) == conferencePrefix)
+    {
+      PString room = sect[i].Mid(conferencePrefix.GetLength());
+      if(room != "*")
+        snapshot->conferences[room].Load(room);
+    }
+  }
+  snapshot->conferenceDefault.Load("*");
+
+  // publish the new snapshot, readers see either the old or the new one
+  MCUConfigSnapshot * old = current;
+#ifdef _WIN32
+  MemoryBarrier();
+#else
+  __sync_synchronize();
+#endif
+  current = snapshot;
+
+  uint64_t now = MCUTime::GetMonoTimestampUsec();
+  if(old)
+  {
+    old->retireTime = now;
+    retired.push_back(old);
+  }
+  while(retired.size() && now - retired.front()->retireTime > (uint64_t)MCU_CONFIG_SNAPSHOT_GRACE * 1000000)
+  {
+    delete retired.front();
+    retired.pop_front();
+  }
+
+  MCUTRACE(3, "Configuration snapshot: " << snapshot->sections.size() << " sections, " << snapshot->conferences.size() << " rooms");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUConfigSnapshot::Clear()
+{
+  PWaitAndSignal m(reloadMutex);
+  delete current;
+  current = NULL;
+  while(retired.size())
+  {
+    delete retired.front();
+    retired.pop_front();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCUConferenceConfig MCUConfigSnapshot::GetConferenceConfig(const PString & room)
+{
+  MCUConferenceConfig config;
+  const MCUConfigSnapshot * snapshot = current;
+  if(snapshot == NULL)
+  {
+    config.Load(room);
+    return config;
+  }
+  ConferenceMap::const_iterator it = snapshot->conferences.find(PCaselessString(room));
+  if(it != snapshot->conferences.end())
+    return it->second;
+  config = snapshot->conferenceDefault;
+  config.ApplyOverrides(room);
+  return config;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+PString MCUConfigSnapshot::GetString(const PString & section, const PString & key) const
+{
+  SectionMap::const_iterator s = sections.find(PCaselessString(section));
+  if(s == sections.end())
+    return "";
+  KeyMap::const_iterator k = s->second.find(PCaselessString(key));
+  if(k == s->second.end())
+    return "";
+  return k->second;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL MCUConfigSnapshot::HasSection(const PString & section) const
+{
+  return sections.find(PCaselessString(section)) != sections.end();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 PString convert_cp1251_to_utf8(PString str)
 {
   static const int table[128] = { // cp1251 -> utf8 translation based on http://www.linux.org.ru/forum/development/3968525
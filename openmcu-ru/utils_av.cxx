@@ -491,3 +491,379 @@ BOOL MCU_AVDecodeFrameFromFile(PString & filename, void *dst, int & dst_size, in
 }
 
 ///////////////////////////////////////////////////////////////////////////
+
+BOOL MCU_AVConcatFiles(const PString & list, const PString & filename)
+{
+  PString trace_section = "MCU_AVConcatFiles: ";
+  AVFormatContext *in_ctx = NULL;
+  AVFormatContext *out_ctx = NULL;
+  AVInputFormat *concat = NULL;
+  AVDictionary *options = NULL;
+  AVPacket pkt = { 0 };
+  int ret = 0;
+  BOOL result = FALSE;
+
+  av_register_all();
+
+  concat = av_find_input_format("concat");
+  if(concat == NULL)
+  {
+    MCUTRACE(1, trace_section << "Could not find concat demuxer");
+    goto end;
+  }
+
+  // the list contains paths relative to its directory
+  av_dict_set(&options, "safe", "0", 0);
+  if((ret = avformat_open_input(&in_ctx, list, concat, &options)) < 0)
+  {
+    MCUTRACE(1, trace_section << "Could not open list " << list << " " << ret << " " << AVErrorToString(ret));
+    goto end;
+  }
+
+  if((ret = avformat_find_stream_info(in_ctx, 0)) < 0)
+  {
+    MCUTRACE(1, trace_section << "Failed to retrieve input stream information from list " << list << " " << ret << " " << AVErrorToString(ret));
+    goto end;
+  }
+
+  out_ctx = avformat_alloc_context();
+  out_ctx->oformat = av_guess_format(NULL, filename, NULL);
+  if(out_ctx->oformat == NULL)
+  {
+    MCUTRACE(1, trace_section << "Could not find output format for " << filename);
+    goto end;
+  }
+
+  // streams are copied, no decoding
+  for(unsigned i = 0; i < in_ctx->nb_streams; ++i)
+  {
+    AVStream *out_st = avformat_new_stream(out_ctx, NULL);
+    if(out_st == NULL || avcodec_copy_context(out_st->codec, in_ctx->streams[i]->codec) < 0)
+    {
+      MCUTRACE(1, trace_section << "Could not allocate stream " << i);
+      goto end;
+    }
+    out_st->codec->codec_tag = 0;
+    out_st->time_base = in_ctx->streams[i]->time_base;
+    if(out_ctx->oformat->flags & AVFMT_GLOBALHEADER)
+      out_st->codec->flags |= CODEC_FLAG_GLOBAL_HEADER;
+  }
+
+  if((ret = avio_open(&out_ctx->pb, filename, AVIO_FLAG_WRITE)) < 0)
+  {
+    MCUTRACE(1, trace_section << "Could not open " << filename << " " << ret << " " << AVErrorToString(ret));
+    goto end;
+  }
+
+  if((ret = avformat_write_header(out_ctx, NULL)) < 0)
+  {
+    MCUTRACE(1, trace_section << "Error occurred when opening output file " << filename << " " << ret << " " << AVErrorToString(ret));
+    goto end;
+  }
+
+  av_init_packet(&pkt);
+  while(av_read_frame(in_ctx, &pkt) >= 0)
+  {
+    AVRational in_tb = in_ctx->streams[pkt.stream_index]->time_base;
+    AVRational out_tb = out_ctx->streams[pkt.stream_index]->time_base;
+    if(pkt.pts != AV_NOPTS_VALUE)
+      pkt.pts = av_rescale_q(pkt.pts, in_tb, out_tb);
+    if(pkt.dts != AV_NOPTS_VALUE)
+      pkt.dts = av_rescale_q(pkt.dts, in_tb, out_tb);
+    pkt.duration = av_rescale_q(pkt.duration, in_tb, out_tb);
+    ret = av_interleaved_write_frame(out_ctx, &pkt);
+    av_free_packet(&pkt);
+    if(ret < 0)
+    {
+      MCUTRACE(1, trace_section << "Error while writing frame to " << filename << " " << ret << " " << AVErrorToString(ret));
+      goto end;
+    }
+  }
+
+  av_write_trailer(out_ctx);
+  result = TRUE;
+
+  end:
+    av_dict_free(&options);
+    if(in_ctx)
+      avformat_close_input(&in_ctx);
+    if(out_ctx)
+    {
+      if(out_ctx->pb)
+        avio_close(out_ctx->pb);
+      avformat_free_context(out_ctx);
+    }
+
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static BOOL MCU_AVOpenDecoder(AVCodecContext *context, const PString & trace_section)
+{
+  context->codec = avcodec_find_decoder(context->codec_id);
+  if(context->codec == NULL)
+  {
+    MCUTRACE(1, trace_section << "Could not find decoder " << AVCodecGetName(context->codec_id));
+    return FALSE;
+  }
+
+  avcodecMutex.Wait();
+#if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(53,8,0)
+  int ret = avcodec_open(context, context->codec);
+#else
+  int ret = avcodec_open2(context, context->codec, NULL);
+#endif
+  avcodecMutex.Signal();
+  if(ret < 0)
+  {
+    MCUTRACE(1, trace_section << "Could not open codec: " << AVCodecGetName(context->codec_id) << " " << ret << " " << AVErrorToString(ret));
+    return FALSE;
+  }
+  return TRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static inline short MCU_AVSampleToS16(const uint8_t *src, AVSampleFormat fmt)
+{
+  double value;
+  switch(fmt)
+  {
+    case AV_SAMPLE_FMT_U8:
+    case AV_SAMPLE_FMT_U8P:
+      return (short)((*src - 128) << 8);
+    case AV_SAMPLE_FMT_S16:
+    case AV_SAMPLE_FMT_S16P:
+      return *(const short *)src;
+    case AV_SAMPLE_FMT_S32:
+    case AV_SAMPLE_FMT_S32P:
+      return (short)(*(const int32_t *)src >> 16);
+    case AV_SAMPLE_FMT_FLT:
+    case AV_SAMPLE_FMT_FLTP:
+      value = *(const float *)src;
+      break;
+    case AV_SAMPLE_FMT_DBL:
+    case AV_SAMPLE_FMT_DBLP:
+      value = *(const double *)src;
+      break;
+    default:
+      return 0;
+  }
+  if(value > 1.0) value = 1.0;
+  if(value < -1.0) value = -1.0;
+  return (short)(value * 32767);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+BOOL MCU_AVDecodeMediaFile(const PString & filename, MCUAVMediaData & data, int max_width, int max_height, int max_frame_rate, PINDEX max_size)
+{
+  PString trace_section = "MCU_AVDecodeMediaFile: ";
+  AVFormatContext *fmt_ctx = NULL;
+  AVCodecContext *audio_context = NULL;
+  AVCodecContext *video_context = NULL;
+  AVStream *video_stream = NULL;
+  struct SwsContext *sws_ctx = NULL;
+  AVFrame *frame = NULL;
+  AVPacket pkt = { 0 };
+  int audio_index = -1, video_index = -1;
+  int64_t video_start = 0;
+  int64_t last_video_time = -1;
+  PINDEX size = 0;
+  int ret = 0;
+  BOOL result = FALSE;
+
+  av_register_all();
+
+  frame = AVFrameAlloc();
+  if(frame == NULL)
+  {
+    PTRACE(1, trace_section << "Failed to allocate frame");
+    goto end;
+  }
+
+  if((ret = avformat_open_input(&fmt_ctx, filename, 0, 0)) < 0)
+  {
+    MCUTRACE(1, trace_section << "Could not open input file " << filename << " " << ret << " " << AVErrorToString(ret));
+    goto end;
+  }
+
+  if((ret = avformat_find_stream_info(fmt_ctx, 0)) < 0)
+  {
+    MCUTRACE(1, trace_section << "Failed to retrieve input stream information from file " << filename << " " << ret << " " << AVErrorToString(ret));
+    goto end;
+  }
+
+  // the first audio and the first video stream
+  for(unsigned i = 0; i < fmt_ctx->nb_streams; ++i)
+  {
+    AVCodecContext *context = fmt_ctx->streams[i]->codec;
+    if(context->codec_type == AVMEDIA_TYPE_AUDIO && audio_index == -1 && context->channels > 0 && context->sample_rate > 0)
+    {
+      if(MCU_AVOpenDecoder(context, trace_section))
+      {
+        audio_context = context;
+        audio_index = i;
+      }
+    }
+    else if(context->codec_type == AVMEDIA_TYPE_VIDEO && video_index == -1 && max_frame_rate > 0)
+    {
+      if(MCU_AVOpenDecoder(context, trace_section))
+      {
+        video_context = context;
+        video_stream = fmt_ctx->streams[i];
+        video_index = i;
+      }
+    }
+  }
+
+  if(audio_context == NULL && video_context == NULL)
+  {
+    MCUTRACE(1, trace_section << "Could not find audio or video in file " << filename);
+    goto end;
+  }
+
+  if(audio_context)
+  {
+    data.sample_rate = audio_context->sample_rate;
+    data.channels = PMIN(audio_context->channels, 2);
+  }
+  if(video_stream && video_stream->start_time != (int64_t)AV_NOPTS_VALUE)
+    video_start = video_stream->start_time;
+
+  av_init_packet(&pkt);
+  while(size < max_size && av_read_frame(fmt_ctx, &pkt) >= 0)
+  {
+    if(pkt.stream_index == audio_index)
+    {
+      // the packet can contain several frames
+      AVPacket dec_pkt = pkt;
+      while(dec_pkt.size > 0)
+      {
+        int got_frame = 0;
+        ret = avcodec_decode_audio4(audio_context, frame, &got_frame, &dec_pkt);
+        if(ret < 0)
+          break;
+        dec_pkt.data += ret;
+        dec_pkt.size -= ret;
+        if(got_frame == 0)
+          continue;
+
+        AVSampleFormat fmt = (AVSampleFormat)frame->format;
+        int sample_size = av_get_bytes_per_sample(fmt);
+        BOOL planar = av_sample_fmt_is_planar(fmt);
+        for(int s = 0; s < frame->nb_samples; ++s)
+        {
+          for(int c = 0; c < data.channels; ++c)
+          {
+            const uint8_t *src = planar ? frame->extended_data[c] + s*sample_size
+                                        : frame->extended_data[0] + (s*audio_context->channels + c)*sample_size;
+            data.audio.push_back(MCU_AVSampleToS16(src, fmt));
+          }
+        }
+        size += frame->nb_samples * data.channels * 2;
+      }
+    }
+    else if(pkt.stream_index == video_index)
+    {
+      int got_picture = 0;
+      ret = avcodec_decode_video2(video_context, frame, &got_picture, &pkt);
+      if(ret >= 0 && got_picture)
+      {
+        int64_t pts = (frame->pkt_pts != (int64_t)AV_NOPTS_VALUE ? frame->pkt_pts : frame->pkt_dts);
+        int64_t time;
+        if(pts != (int64_t)AV_NOPTS_VALUE)
+          time = av_rescale(pts - video_start, 1000 * video_stream->time_base.num, video_stream->time_base.den);
+        else
+          time = (last_video_time < 0 ? 0 : last_video_time + 1000 / max_frame_rate);
+        if(time < 0)
+          time = 0;
+
+        // frames above the frame rate are skipped
+        if(last_video_time < 0 || time >= last_video_time + 1000 / max_frame_rate)
+        {
+          if(data.width == 0)
+          {
+            // the picture fits into max_width x max_height with the same aspect
+            data.width = frame->width;
+            data.height = frame->height;
+            if(data.width > max_width)
+            {
+              data.height = data.height * max_width / data.width;
+              data.width = max_width;
+            }
+            if(data.height > max_height)
+            {
+              data.width = data.width * max_height / data.height;
+              data.height = max_height;
+            }
+            data.width &= ~1;
+            data.height &= ~1;
+          }
+
+          sws_ctx = sws_getCachedContext(sws_ctx, frame->width, frame->height, (PixelFormat)frame->format,
+                                         data.width, data.height, AV_PIX_FMT_YUV420P,
+                                         SWS_BILINEAR, NULL, NULL, NULL);
+          if(sws_ctx == NULL || data.width == 0 || data.height == 0)
+          {
+            MCUTRACE(1, trace_section << "Impossible to create scale context for the conversion "
+                        << frame->width << "x" << frame->height << "->" << data.width << "x" << data.height);
+            av_free_packet(&pkt);
+            goto end;
+          }
+
+          int picture_size = avpicture_get_size(AV_PIX_FMT_YUV420P, data.width, data.height);
+          PBYTEArray picture(picture_size);
+          AVPicture dst_picture;
+          avpicture_fill(&dst_picture, picture.GetPointer(), AV_PIX_FMT_YUV420P, data.width, data.height);
+          sws_scale(sws_ctx, frame->data, frame->linesize, 0, frame->height,
+                             dst_picture.data, dst_picture.linesize);
+
+          data.video.push_back(picture);
+          data.video_time.push_back((unsigned)time);
+          last_video_time = time;
+          size += picture_size;
+        }
+      }
+    }
+    av_free_packet(&pkt);
+  }
+
+  if(size >= max_size)
+    MCUTRACE(1, trace_section << "File " << filename << " is truncated to " << max_size << " bytes of the decoded media");
+
+  if(data.sample_rate)
+    data.duration = (unsigned)((uint64_t)data.audio.size() / data.channels * 1000 / data.sample_rate);
+  if(data.video.size())
+    data.duration = PMAX(data.duration, data.video_time.back() + 1000 / max_frame_rate);
+
+  if(data.duration == 0)
+  {
+    MCUTRACE(1, trace_section << "Nothing decoded from file " << filename);
+    goto end;
+  }
+
+  MCUTRACE(1, trace_section << "Decoded file " << filename << " duration " << data.duration << " ms"
+              << ", audio " << data.sample_rate << "x" << data.channels
+              << ", video " << data.width << "x" << data.height << " frames " << data.video.size());
+  result = TRUE;
+
+  end:
+    if(sws_ctx)
+      sws_freeContext(sws_ctx);
+    avcodecMutex.Wait();
+    if(audio_context)
+      avcodec_close(audio_context);
+    if(video_context)
+      avcodec_close(video_context);
+    avcodecMutex.Signal();
+    if(fmt_ctx)
+      avformat_close_input(&fmt_ctx);
+    if(frame)
+      AVFrameFree(&frame);
+
+    return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
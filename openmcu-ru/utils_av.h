@@ -18,6 +18,12 @@
   #define AV_CODEC_ID_MSMPEG4V3   CODEC_ID_MSMPEG4V3
   #define AV_CODEC_ID_VP8         CODEC_ID_VP8
   #define AV_CODEC_ID_MJPEG       CODEC_ID_MJPEG
+  #define AV_CODEC_ID_OPUS        CODEC_ID_OPUS
+  #define AV_CODEC_ID_ADPCM_G722  CODEC_ID_ADPCM_G722
+#endif
+
+#ifndef AV_INPUT_BUFFER_PADDING_SIZE
+  #define AV_INPUT_BUFFER_PADDING_SIZE FF_INPUT_BUFFER_PADDING_SIZE
 #endif
 
 #if LIBAVUTILS_VERSION_INT < AV_VERSION_INT(51,42,0)
@@ -95,6 +101,30 @@ extern PMutex avcodecMutex;
 
 BOOL MCU_AVEncodeFrame(AVCodecID codec_id, const void * src, int src_size, void * dst, int & dst_size, int src_width, int src_height);
 BOOL MCU_AVDecodeFrameFromFile(PString & filename, void *dst, int & dst_size, int & dst_width, int & dst_height);
+BOOL MCU_AVConcatFiles(const PString & list, const PString & filename);
+
+// media file decoded for the playback: audio S16 interleaved at the file sample rate
+// (not more than 2 channels), video YUV420P frames with the time from the file start
+class MCUAVMediaData
+{
+  public:
+    MCUAVMediaData()
+      : sample_rate(0), channels(0), width(0), height(0), duration(0)
+    { }
+
+    int sample_rate;
+    int channels;
+    std::vector<short> audio;
+
+    int width;
+    int height;
+    std::vector<PBYTEArray> video;
+    std::vector<unsigned> video_time; // ms
+
+    unsigned duration; // ms
+};
+
+BOOL MCU_AVDecodeMediaFile(const PString & filename, MCUAVMediaData & data, int max_width, int max_height, int max_frame_rate, PINDEX max_size);
 
 unsigned GetVideoMacroBlocks(unsigned width, unsigned height);
 BOOL GetParamsH263(PString & mpiname, unsigned & width, unsigned & height);
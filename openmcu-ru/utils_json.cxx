@@ -601,3 +601,318 @@ void MCUJSON::PrintEsc(std::string &str, bool print_esc, int esc_level)
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCUJSONWriter::MCUJSONWriter(bool _print_keys, bool _print_esc)
+  : print_keys(_print_keys), print_esc(_print_esc)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUJSONWriter::PrintEsc(int esc_level)
+{
+  if(print_esc)
+  {
+    str.push_back('\r');
+    str.push_back('\n');
+    for(int i = 0; i < esc_level; ++i)
+      str.push_back(' ');
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUJSONWriter::BeginValue(const std::string &key)
+{
+  if(stack.size())
+  {
+    Frame &frame = stack.back();
+    if(frame.count > 0)
+      str.push_back(',');
+    PrintEsc(frame.esc_level+1);
+    frame.count++;
+  }
+  if(print_keys && !key.empty())
+  {
+    JsQuoteScreen(key, str);
+    str.push_back(':');
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUJSONWriter::Begin(const std::string &key, char bracket)
+{
+  BeginValue(key);
+  int esc_level = stack.size() ? stack.back().esc_level+1 : 0;
+  if(print_keys && !key.empty())
+    PrintEsc(esc_level);
+  str.push_back(bracket);
+  stack.push_back(Frame(bracket, esc_level));
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCUJSONWriter & MCUJSONWriter::BeginArray(const std::string &key)
+{
+  Begin(key, '[');
+  return *this;
+}
+
+MCUJSONWriter & MCUJSONWriter::BeginObject(const std::string &key)
+{
+  Begin(key, '{');
+  return *this;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCUJSONWriter & MCUJSONWriter::End()
+{
+  if(stack.size() == 0)
+    return *this;
+  Frame &frame = stack.back();
+  PrintEsc(frame.esc_level);
+  str.push_back(frame.bracket == '{' ? '}' : ']');
+  stack.pop_back();
+  return *this;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCUJSONWriter & MCUJSONWriter::Null(const std::string &key)
+{
+  BeginValue(key);
+  str.append("null", 4);
+  return *this;
+}
+
+MCUJSONWriter & MCUJSONWriter::Value(const std::string &key, bool value)
+{
+  BeginValue(key);
+  str.push_back(value ? '1' : '0');
+  return *this;
+}
+
+MCUJSONWriter & MCUJSONWriter::Value(const std::string &key, long long value)
+{
+  BeginValue(key);
+  char buffer[32];
+  int digits = snprintf(buffer, 32, "%lld", value);
+  str.append(buffer, digits);
+  return *this;
+}
+
+MCUJSONWriter & MCUJSONWriter::Value(const std::string &key, double value)
+{
+  BeginValue(key);
+  char buffer[32];
+  int digits = snprintf(buffer, 32, "%f", value);
+  str.append(buffer, digits);
+  return *this;
+}
+
+MCUJSONWriter & MCUJSONWriter::Value(const std::string &key, const std::string &value)
+{
+  BeginValue(key);
+  JsQuoteScreen(value, str);
+  return *this;
+}
+
+MCUJSONWriter & MCUJSONWriter::Raw(const std::string &key, const std::string &json)
+{
+  BeginValue(key);
+  str.append(json);
+  return *this;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCUJSONDocument::MCUJSONDocument(MCUJSON::JsonTypes root_type, int reserve_nodes)
+{
+  nodes.reserve(reserve_nodes);
+  AddNode(NONE, root_type, "");
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int MCUJSONDocument::AddString(const std::string &s)
+{
+  int offset = strings.size();
+  strings.append(s);
+  return offset;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string MCUJSONDocument::GetKey(Node node) const
+{
+  const NodeData &data = nodes[node];
+  if(data.key < 0)
+    return "";
+  return strings.substr(data.key, data.key_size);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCUJSONDocument::Node MCUJSONDocument::AddNode(Node parent, MCUJSON::JsonTypes type, const std::string &key)
+{
+  if(parent != NONE)
+  {
+    if(parent < 0 || parent >= (int)nodes.size())
+      return NONE;
+    if(nodes[parent].type != MCUJSON::JSON_ARRAY && nodes[parent].type != MCUJSON::JSON_OBJECT)
+      return NONE;
+  }
+
+  NodeData data;
+  data.type = type;
+  data.key = key.empty() ? -1 : AddString(key);
+  data.key_size = key.size();
+  data.first = NONE;
+  data.last = NONE;
+  data.next = NONE;
+  data.count = 0;
+  data.value_int = 0;
+  data.value_double = 0;
+  data.value_str = -1;
+  data.value_str_size = 0;
+
+  Node node = nodes.size();
+  nodes.push_back(data);
+
+  if(parent != NONE)
+  {
+    NodeData &p = nodes[parent];
+    if(p.last == NONE)
+      p.first = node;
+    else
+      nodes[p.last].next = node;
+    p.last = node;
+    p.count++;
+  }
+  return node;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCUJSONDocument::Node MCUJSONDocument::Add(Node parent, const std::string &key, bool value)
+{
+  Node node = AddNode(parent, MCUJSON::JSON_BOOL, key);
+  if(node != NONE)
+    nodes[node].value_int = value;
+  return node;
+}
+
+MCUJSONDocument::Node MCUJSONDocument::Add(Node parent, const std::string &key, long long value)
+{
+  Node node = AddNode(parent, MCUJSON::JSON_INT, key);
+  if(node != NONE)
+    nodes[node].value_int = value;
+  return node;
+}
+
+MCUJSONDocument::Node MCUJSONDocument::Add(Node parent, const std::string &key, double value)
+{
+  Node node = AddNode(parent, MCUJSON::JSON_DOUBLE, key);
+  if(node != NONE)
+    nodes[node].value_double = value;
+  return node;
+}
+
+MCUJSONDocument::Node MCUJSONDocument::Add(Node parent, const std::string &key, const std::string &value)
+{
+  Node node = AddNode(parent, MCUJSON::JSON_STRING, key);
+  if(node != NONE)
+  {
+    nodes[node].value_str = AddString(value);
+    nodes[node].value_str_size = value.size();
+  }
+  return node;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MCUJSONDocument::Node MCUJSONDocument::Find(Node parent, const std::string &key) const
+{
+  if(parent < 0 || parent >= (int)nodes.size())
+    return NONE;
+  for(Node node = nodes[parent].first; node != NONE; node = nodes[node].next)
+  {
+    const NodeData &data = nodes[node];
+    if(data.key >= 0 && strings.compare(data.key, data.key_size, key) == 0)
+      return node;
+  }
+  return NONE;
+}
+
+MCUJSONDocument::Node MCUJSONDocument::GetChild(Node parent, int number) const
+{
+  if(parent < 0 || parent >= (int)nodes.size())
+    return NONE;
+  Node node = nodes[parent].first;
+  for(; node != NONE && number > 0; --number)
+    node = nodes[node].next;
+  return node;
+}
+
+int MCUJSONDocument::GetSize(Node parent) const
+{
+  if(parent < 0 || parent >= (int)nodes.size())
+    return 0;
+  return nodes[parent].count;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void MCUJSONDocument::Write(MCUJSONWriter &writer, Node node) const
+{
+  if(node < 0 || node >= (int)nodes.size())
+    return;
+  const NodeData &data = nodes[node];
+  std::string key = GetKey(node);
+  switch(data.type)
+  {
+    case(MCUJSON::JSON_NULL):
+      writer.Null(key);
+      break;
+    case(MCUJSON::JSON_BOOL):
+      writer.Value(key, data.value_int != 0);
+      break;
+    case(MCUJSON::JSON_INT):
+      writer.Value(key, data.value_int);
+      break;
+    case(MCUJSON::JSON_DOUBLE):
+      writer.Value(key, data.value_double);
+      break;
+    case(MCUJSON::JSON_STRING):
+      writer.Value(key, strings.substr(data.value_str, data.value_str_size));
+      break;
+    case(MCUJSON::JSON_ARRAY):
+    case(MCUJSON::JSON_OBJECT):
+    {
+      if(data.type == MCUJSON::JSON_OBJECT)
+        writer.BeginObject(key);
+      else
+        writer.BeginArray(key);
+      for(Node child = data.first; child != NONE; child = nodes[child].next)
+        Write(writer, child);
+      writer.End();
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+std::string MCUJSONDocument::AsString(bool print_keys, bool print_esc) const
+{
+  MCUJSONWriter writer(print_keys, print_esc);
+  Write(writer);
+  return writer.GetString();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
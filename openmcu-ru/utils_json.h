@@ -142,4 +142,135 @@ class MCUJSON
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Потоковая запись JSON в одну строку, без промежуточных узлов
+// Формат вывода совпадает с MCUJSON::ToString()
+class MCUJSONWriter
+{
+  public:
+    MCUJSONWriter(bool _print_keys = true, bool _print_esc = false);
+
+    MCUJSONWriter & BeginArray(const std::string &key = "");
+    MCUJSONWriter & BeginObject(const std::string &key = "");
+    MCUJSONWriter & End();
+
+    MCUJSONWriter & Null(const std::string &key = "");
+    MCUJSONWriter & Value(const std::string &key, bool value);
+    MCUJSONWriter & Value(const std::string &key, int value)
+    { return Value(key, (long long)value); }
+    MCUJSONWriter & Value(const std::string &key, unsigned int value)
+    { return Value(key, (long long)value); }
+    MCUJSONWriter & Value(const std::string &key, long value)
+    { return Value(key, (long long)value); }
+    MCUJSONWriter & Value(const std::string &key, unsigned long value)
+    { return Value(key, (long long)value); }
+    MCUJSONWriter & Value(const std::string &key, long long value);
+    MCUJSONWriter & Value(const std::string &key, double value);
+    MCUJSONWriter & Value(const std::string &key, const char *value)
+    { return Value(key, std::string(value)); }
+    MCUJSONWriter & Value(const std::string &key, const std::string &value);
+    MCUJSONWriter & Value(const std::string &key, const PString &value)
+    { return Value(key, std::string((const char *)value)); }
+
+    // элемент массива без ключа
+    template <class T>
+    MCUJSONWriter & Value(const T &value)
+    { return Value("", value); }
+
+    // готовый JSON как элемент
+    MCUJSONWriter & Raw(const std::string &key, const std::string &json);
+
+    const std::string & GetString() const
+    { return str; }
+    std::string & GetString()
+    { return str; }
+
+    void Reserve(size_t size)
+    { str.reserve(size); }
+
+  protected:
+    void BeginValue(const std::string &key);
+    void Begin(const std::string &key, char bracket);
+    void PrintEsc(int esc_level);
+
+    struct Frame
+    {
+      Frame(char _bracket, int _esc_level) : bracket(_bracket), esc_level(_esc_level), count(0) { }
+      char bracket;
+      int esc_level;
+      int count;
+    };
+
+    bool print_keys;
+    bool print_esc;
+    std::string str;
+    std::vector<Frame> stack;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Компактный DOM для случаев, когда нужен произвольный доступ до вывода
+// Узлы и строки хранятся в общих буферах документа, узел - индекс в буфере
+class MCUJSONDocument
+{
+  public:
+    typedef int Node;
+    enum { NONE = -1 };
+
+    MCUJSONDocument(MCUJSON::JsonTypes root_type = MCUJSON::JSON_OBJECT, int reserve_nodes = 32);
+
+    Node Root() const
+    { return 0; }
+
+    Node AddArray(Node parent, const std::string &key = "")
+    { return AddNode(parent, MCUJSON::JSON_ARRAY, key); }
+    Node AddObject(Node parent, const std::string &key = "")
+    { return AddNode(parent, MCUJSON::JSON_OBJECT, key); }
+    Node AddNull(Node parent, const std::string &key = "")
+    { return AddNode(parent, MCUJSON::JSON_NULL, key); }
+    Node Add(Node parent, const std::string &key, bool value);
+    Node Add(Node parent, const std::string &key, int value)
+    { return Add(parent, key, (long long)value); }
+    Node Add(Node parent, const std::string &key, long value)
+    { return Add(parent, key, (long long)value); }
+    Node Add(Node parent, const std::string &key, long long value);
+    Node Add(Node parent, const std::string &key, double value);
+    Node Add(Node parent, const std::string &key, const std::string &value);
+    Node Add(Node parent, const std::string &key, const PString &value)
+    { return Add(parent, key, std::string((const char *)value)); }
+
+    // NONE если нет
+    Node Find(Node parent, const std::string &key) const;
+    Node GetChild(Node parent, int number) const;
+    int GetSize(Node parent) const;
+
+    // записать узел со всеми дочерними
+    void Write(MCUJSONWriter &writer, Node node = 0) const;
+    std::string AsString(bool print_keys = true, bool print_esc = false) const;
+
+  protected:
+    Node AddNode(Node parent, MCUJSON::JsonTypes type, const std::string &key);
+    int AddString(const std::string &s);
+    std::string GetKey(Node node) const;
+
+    struct NodeData
+    {
+      char type;
+      int key;       // смещение в strings, -1 если нет
+      int key_size;
+      int first;     // первый дочерний
+      int last;      // последний дочерний
+      int next;      // следующий в родителе
+      int count;
+      long long value_int;
+      double value_double;
+      int value_str;  // смещение строкового значения в strings
+      int value_str_size;
+    };
+
+    std::vector<NodeData> nodes;
+    std::string strings;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 #endif // _MCU_UTILS_JSON_H
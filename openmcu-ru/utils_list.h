@@ -28,6 +28,10 @@
 
 #include "utils_type.h"
 
+#ifdef _WIN32
+#include <intrin.h> // _BitScanForward
+#endif
+
 #define MCU_SHARED_LIST_SIZE 1024
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -39,6 +43,30 @@
 //
 template <class _T_obj, long list_size> class MCUSharedList;
 
+// Счетчик захватов и блокировка записи позиции
+// Каждая позиция в своей строке кэша, захват одной позиции не мешает соседним
+#define MCU_CACHE_LINE_SIZE 64
+struct MCUSharedListSlot
+{
+  long volatile captures;
+  sync_bool lock;
+  char padding[MCU_CACHE_LINE_SIZE - sizeof(long) - sizeof(sync_bool)];
+};
+
+// Битовая карта занятых позиций, для итератора
+#define MCU_SHARED_LIST_BITS ((long)sizeof(unsigned long) * 8)
+
+inline long MCUSharedListFirstBit(unsigned long word)
+{
+#ifdef _WIN32
+  unsigned long bit;
+  _BitScanForward(&bit, word);
+  return (long)bit;
+#else
+  return __builtin_ctzl(word);
+#endif
+}
+
 template <class T_list, class T_obj>
 class MCUSharedListSharedIterator
 {
@@ -180,17 +208,27 @@ class MCUSharedListSharedIterator
       else
         ++index;
 
-      for(sync_bool *it = find(list->states + index, list->states_end, true); it != list->states_end; it = find(++it, list->states_end, true), --number)
+      for(long word = index / MCU_SHARED_LIST_BITS; word < list->bitmap_words; ++word)
       {
-        if(number > 0)
-          continue;
-        index = it - list->states;
-        Capture();
-        // повторная проверка после захвата
-        if(list->states[index] == true)
-          return true;
-        // освободить если нет объекта
-        Release();
+        unsigned long mask = list->bitmap[word];
+        // позиции до index пропустить
+        if(word == index / MCU_SHARED_LIST_BITS)
+          mask &= ~0UL << (index % MCU_SHARED_LIST_BITS);
+        for(; mask != 0; mask &= mask - 1)
+        {
+          if(number > 0)
+          {
+            --number;
+            continue;
+          }
+          index = word * MCU_SHARED_LIST_BITS + MCUSharedListFirstBit(mask);
+          Capture();
+          // повторная проверка после захвата
+          if(list->states[index] == true)
+            return true;
+          // освободить если нет объекта
+          Release();
+        }
       }
 
       end:
@@ -205,6 +243,174 @@ class MCUSharedListSharedIterator
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Хеш-индекс позиций списка по имени или id
+// Открытая адресация, в ячейке хранится индекс позиции списка
+// Индекс только подсказка - найденная позиция проверяется после захвата
+class MCUSharedListIndex
+{
+  public:
+    enum
+    {
+      EMPTY = -1,
+      DELETED = -2
+    };
+
+    MCUSharedListIndex(long _list_size)
+      : list_size(_list_size), deleted(0), version(0)
+    {
+      // не меньше четырех ячеек на позицию, размер степень двойки
+      mask = 1;
+      while(mask < list_size * 4)
+        mask <<= 1;
+      buckets = new long [mask];
+      mask--;
+      for(long i = 0; i <= mask; ++i)
+        buckets[i] = EMPTY;
+      // хеши позиций для перестроения
+      hashes = new unsigned long [list_size];
+      used = new bool [list_size];
+      for(long i = 0; i < list_size; ++i)
+        used[i] = false;
+    }
+
+    ~MCUSharedListIndex()
+    {
+      delete [] buckets;
+      delete [] hashes;
+      delete [] used;
+    }
+
+    static unsigned long Hash(const std::string & name)
+    {
+      // FNV-1a
+      unsigned long hash = 2166136261UL;
+      for(std::string::const_iterator it = name.begin(); it != name.end(); ++it)
+      {
+        hash ^= (unsigned char)*it;
+        hash *= 16777619UL;
+      }
+      return hash;
+    }
+
+    static unsigned long Hash(long id)
+    {
+      unsigned long hash = (unsigned long)id;
+      hash ^= hash >> 16;
+      hash *= 0x45d9f3bUL;
+      hash ^= hash >> 16;
+      return hash;
+    }
+
+    // занимает первую свободную или удаленную ячейку
+    // изменения индекса последовательны, поиск выполняется без блокировки
+    void Insert(unsigned long hash, long index)
+    {
+      PWaitAndSignal m(mutex);
+      hashes[index] = hash;
+      used[index] = true;
+      if(InsertBucket(hash, index))
+        return;
+      // позиций в четыре раза меньше, чем ячеек - после перестроения место есть
+      Rebuild();
+      if(!InsertBucket(hash, index))
+        PAssertAlways("MCUSharedListIndex: no free bucket");
+    }
+
+    // ячейка не освобождается(EMPTY), иначе прервется цепочка поиска других позиций;
+    // удаленные ячейки удлиняют поиск отсутствующих ключей, индекс перестраивается
+    // когда их больше четверти
+    void Erase(unsigned long hash, long index)
+    {
+      PWaitAndSignal m(mutex);
+      used[index] = false;
+      for(long i = 0; i <= mask; ++i)
+      {
+        long volatile *bucket = &buckets[(hash + i) & mask];
+        if(*bucket == EMPTY)
+          break;
+        if(*bucket == index)
+        {
+          *bucket = DELETED;
+          deleted++;
+          break;
+        }
+      }
+      if(deleted > (mask + 1) / 4)
+        Rebuild();
+    }
+
+    // перебор позиций с одинаковым хешем, pos начинать с 0
+    // возвращает LONG_MAX в конце цепочки
+    long Next(unsigned long hash, long & pos)
+    {
+      for(; pos <= mask; )
+      {
+        long value = buckets[(hash + pos++) & mask];
+        if(value == EMPTY)
+          break;
+        if(value != DELETED)
+          return value;
+      }
+      return LONG_MAX;
+    }
+
+    // поиск без блокировки: ReadBegin() перед перебором Next(),
+    // если позиция не найдена и ReadRetry() == true, индекс перестраивался - повторить поиск
+    long ReadBegin()
+    {
+      long v;
+      while((v = sync_val_compare_and_swap(&version, 0, 0)) & 1)
+        sync_pause();
+      return v;
+    }
+
+    bool ReadRetry(long v)
+    { return sync_val_compare_and_swap(&version, 0, 0) != v; }
+
+  protected:
+    bool InsertBucket(unsigned long hash, long index)
+    {
+      for(long i = 0; i <= mask; ++i)
+      {
+        long volatile *bucket = &buckets[(hash + i) & mask];
+        if(*bucket == EMPTY || *bucket == DELETED)
+        {
+          if(*bucket == DELETED)
+            deleted--;
+          *bucket = index;
+          return true;
+        }
+      }
+      return false;
+    }
+
+    // на месте, нечетная версия - идет перестроение
+    void Rebuild()
+    {
+      sync_increment(&version);
+      for(long i = 0; i <= mask; ++i)
+        buckets[i] = EMPTY;
+      deleted = 0;
+      for(long index = 0; index < list_size; ++index)
+      {
+        if(used[index])
+          InsertBucket(hashes[index], index);
+      }
+      sync_increment(&version);
+    }
+
+    long mask;
+    long list_size;
+    long deleted;
+    long volatile version;
+    long volatile * buckets;
+    unsigned long * hashes;
+    bool * used;
+    PMutex mutex;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 template <class T_obj, long list_size = MCU_SHARED_LIST_SIZE>
 class MCUSharedList
 {
@@ -235,6 +441,10 @@ class MCUSharedList
     long GetNextID()
     { return sync_increment(&id_counter); }
 
+    // Хеш-индекс по имени и id для Find/Release/Erase/operator()
+    // Включать до первого добавления объекта
+    void EnableIndex();
+
     // Insert добавляет в первую свободную позицию с начала списка
     // Возвращает false(end) если нет свободного места, после добавления объект захвачен(в итераторе)
     bool Insert(long index, T_obj * obj, long id, const std::string &name = "");
@@ -294,8 +504,11 @@ class MCUSharedList
     std::string ** names_end;
     T_obj ** objs;
     T_obj ** objs_end;
-    long * volatile captures;
-    sync_bool * volatile locks;
+    MCUSharedListSlot * slots;
+    unsigned long volatile * bitmap;
+    long bitmap_words;
+    MCUSharedListIndex * name_index;
+    MCUSharedListIndex * id_index;
     const shared_iterator iterator_end;
 };
 
@@ -303,7 +516,7 @@ class MCUSharedList
 
 template <class T_obj, long list_size>
 MCUSharedList<T_obj, list_size>::MCUSharedList(long _size)
-  : size(_size), current_size(0), id_counter(0), pushback_index(0)
+  : size(_size), current_size(0), id_counter(0), pushback_index(0), name_index(NULL), id_index(NULL)
 {
   states = new sync_bool [size];
   states_end = states + size;
@@ -313,17 +526,20 @@ MCUSharedList<T_obj, list_size>::MCUSharedList(long _size)
   names_end = names + size;
   objs = new T_obj * [size];
   objs_end = objs + size;
-  captures = new long [size];
-  locks = new sync_bool [size];
+  slots = (MCUSharedListSlot *)MCUBuffer::aligned_malloc(size * sizeof(MCUSharedListSlot));
+  bitmap_words = (size + MCU_SHARED_LIST_BITS - 1) / MCU_SHARED_LIST_BITS;
+  bitmap = new unsigned long [bitmap_words];
   for(long i = 0; i < size; ++i)
   {
     states[i] = false;
     ids[i] = LONG_MAX;
     names[i] = NULL;
     objs[i] = NULL;
-    captures[i] = 0;
-    locks[i] = false;
+    slots[i].captures = 0;
+    slots[i].lock = false;
   }
+  for(long i = 0; i < bitmap_words; ++i)
+    bitmap[i] = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -347,11 +563,28 @@ MCUSharedList<T_obj, list_size>::~MCUSharedList()
   delete [] objs;
   objs = NULL;
 
-  delete [] captures;
-  captures = NULL;
+  MCUBuffer::aligned_free(slots);
+  slots = NULL;
+
+  delete [] bitmap;
+  bitmap = NULL;
+
+  delete name_index;
+  name_index = NULL;
+
+  delete id_index;
+  id_index = NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
 
-  delete [] locks;
-  locks = NULL;
+template <class T_obj, long list_size>
+void MCUSharedList<T_obj, list_size>::EnableIndex()
+{
+  if(name_index || current_size != 0)
+    return;
+  name_index = new MCUSharedListIndex(size);
+  id_index = new MCUSharedListIndex(size);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -374,7 +607,7 @@ bool MCUSharedList<T_obj, list_size>::Insert(long index, T_obj * obj, long id, c
 {
   bool insert = false;
   // блокировка записи
-  if(sync_bool_compare_and_swap(&locks[index], false, true) == true)
+  if(sync_bool_compare_and_swap(&slots[index].lock, false, true) == true)
   {
     // повторная проверка после блокировки
     if(states[index] == false)
@@ -393,13 +626,20 @@ bool MCUSharedList<T_obj, list_size>::Insert(long index, T_obj * obj, long id, c
         else
           names[index] = new std::string(name);
       }
+      if(id_index)
+      {
+        id_index->Insert(MCUSharedListIndex::Hash(id), index);
+        if(!name.empty())
+          name_index->Insert(MCUSharedListIndex::Hash(name), index);
+      }
       // разрешить получение объекта
       states[index] = true;
+      sync_fetch_and_or(&bitmap[index / MCU_SHARED_LIST_BITS], 1UL << (index % MCU_SHARED_LIST_BITS));
       sync_increment(&current_size);
       insert = true;
     }
     // разблокировка записи
-    sync_bool_compare_and_swap(&locks[index], true, false);
+    sync_bool_compare_and_swap(&slots[index].lock, true, false);
   }
   return insert;
 }
@@ -490,20 +730,27 @@ template <class T_obj, long list_size>
 bool MCUSharedList<T_obj, list_size>::EraseInternal(long index)
 {
   // блокировка записи
-  if(sync_bool_compare_and_swap(&locks[index], false, true) == true)
+  if(sync_bool_compare_and_swap(&slots[index].lock, false, true) == true)
   {
     // запретить получение объекта
     states[index] = false;
+    sync_fetch_and_and(&bitmap[index / MCU_SHARED_LIST_BITS], ~(1UL << (index % MCU_SHARED_LIST_BITS)));
     sync_decrement(&current_size);
     // ждать освобождения объекта
     ReleaseWait(index, 1);
     // запись объекта
+    if(id_index)
+    {
+      id_index->Erase(MCUSharedListIndex::Hash(ids[index]), index);
+      if(names[index] && !names[index]->empty())
+        name_index->Erase(MCUSharedListIndex::Hash(*names[index]), index);
+    }
     ids[index] = LONG_MAX;
     if(names[index])
       names[index]->clear();
     objs[index] = NULL;
     // разблокировка записи
-    sync_bool_compare_and_swap(&locks[index], true, false);
+    sync_bool_compare_and_swap(&slots[index].lock, true, false);
     return true;
   }
   return false;
@@ -514,22 +761,25 @@ bool MCUSharedList<T_obj, list_size>::EraseInternal(long index)
 template <class T_obj, long list_size>
 void MCUSharedList<T_obj, list_size>::ReleaseWait(long index, long threshold)
 {
-  for(long i = 0; captures[index] != threshold; ++i)
+  // ожидание с ограниченным нарастанием: pause 1,2,4..64 раза, затем sleep 10,20,40..1000 мксек
+  long spins = 1;
+  uint32_t sleep_usec = 10;
+  for(long i = 0; slots[index].captures != threshold; ++i)
   {
-    if(i < 4000)
-#   ifdef _WIN32
-      YieldProcessor();
-#   else
-      __asm__ __volatile__("pause":::"memory");
-#   endif
-    else if(i < 9000) // +50msec
-      MCUTime::SleepUsec(10);
+    if(spins <= 64)
+    {
+      for(long j = 0; j < spins; ++j)
+        sync_pause();
+      spins <<= 1;
+    }
     else
     {
-      MCUTRACE_IF(1, (i % 5000 == 0), "ReleaseWait: " << typeid(*this).name() << " index=" << index <<
+      MCUTRACE_IF(1, (sleep_usec == 1000 && i % 5000 == 0), "ReleaseWait: " << typeid(*this).name() << " index=" << index <<
                   " obj=" << objs[index] << " id=" << ids[index] << " name=" << (names[index] ? *names[index] : "") <<
-                  " captures=" << captures[index]);
-      MCUTime::SleepUsec(1000);
+                  " captures=" << slots[index].captures);
+      MCUTime::SleepUsec(sleep_usec);
+      if(sleep_usec < 1000)
+        sleep_usec = PMIN(sleep_usec * 2, 1000);
     }
   }
 }
@@ -539,6 +789,25 @@ void MCUSharedList<T_obj, list_size>::ReleaseWait(long index, long threshold)
 template <class T_obj, long list_size>
 void MCUSharedList<T_obj, list_size>::Release(long id)
 {
+  if(id_index)
+  {
+    unsigned long hash = MCUSharedListIndex::Hash(id);
+    long version;
+    do
+    {
+      version = id_index->ReadBegin();
+      long pos = 0;
+      for(long index = id_index->Next(hash, pos); index != LONG_MAX; index = id_index->Next(hash, pos))
+      {
+        if(ids[index] == id)
+        {
+          ReleaseInternal(index);
+          return;
+        }
+      }
+    } while(id_index->ReadRetry(version));
+    return;
+  }
   long *it = find(ids, ids_end, id);
   if(it != ids_end)
   {
@@ -575,8 +844,8 @@ void MCUSharedList<T_obj, list_size>::Release(shared_iterator & it)
 template <class T_obj, long list_size>
 void MCUSharedList<T_obj, list_size>::ReleaseInternal(long index)
 {
-  //PTRACE(6, "release index=" << index << " captures=" << captures[index] << " id=" << ids[index] << " obj=" << (objs[index] == NULL ? 0 : objs[index]) << " thread=" << PThread::Current() << " " << PThread::Current()->GetThreadName()<< "\ttype=" << typeid(objs[index]).name());
-  sync_decrement(&captures[index]);
+  //PTRACE(6, "release index=" << index << " captures=" << slots[index].captures << " id=" << ids[index] << " obj=" << (objs[index] == NULL ? 0 : objs[index]) << " thread=" << PThread::Current() << " " << PThread::Current()->GetThreadName()<< "\ttype=" << typeid(objs[index]).name());
+  sync_decrement(&slots[index].captures);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -584,8 +853,8 @@ void MCUSharedList<T_obj, list_size>::ReleaseInternal(long index)
 template <class T_obj, long list_size>
 void MCUSharedList<T_obj, list_size>::CaptureInternal(long index)
 {
-  //PTRACE(6, "capture index=" << index << " captures=" << captures[index] << " id=" << ids[index] << " obj=" << (objs[index] == NULL ? 0 : objs[index]) << " thread=" << PThread::Current() << " " << PThread::Current()->GetThreadName()<< "\ttype=" << typeid(objs[index]).name());
-  sync_increment(&captures[index]);
+  //PTRACE(6, "capture index=" << index << " captures=" << slots[index].captures << " id=" << ids[index] << " obj=" << (objs[index] == NULL ? 0 : objs[index]) << " thread=" << PThread::Current() << " " << PThread::Current()->GetThreadName()<< "\ttype=" << typeid(objs[index]).name());
+  sync_increment(&slots[index].captures);
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -593,6 +862,28 @@ void MCUSharedList<T_obj, list_size>::CaptureInternal(long index)
 template <class T_obj, long list_size>
 long MCUSharedList<T_obj, list_size>::GetIndex(const long id)
 {
+  if(id_index)
+  {
+    unsigned long hash = MCUSharedListIndex::Hash(id);
+    long version;
+    do
+    {
+      version = id_index->ReadBegin();
+      long pos = 0;
+      for(long index = id_index->Next(hash, pos); index != LONG_MAX; index = id_index->Next(hash, pos))
+      {
+        if(ids[index] != id)
+          continue;
+        CaptureInternal(index);
+        // повторная проверка после захвата
+        if(ids[index] == id && states[index] == true)
+          return index;
+        // освободить если нет объекта
+        ReleaseInternal(index);
+      }
+    } while(id_index->ReadRetry(version));
+    return LONG_MAX;
+  }
   long *it = find(ids, ids_end, id);
   if(it != ids_end)
   {
@@ -620,6 +911,28 @@ struct string_equal_pointers
 template <class T_obj, long list_size>
 long MCUSharedList<T_obj, list_size>::GetIndex(const std::string &name)
 {
+  if(name_index)
+  {
+    unsigned long hash = MCUSharedListIndex::Hash(name);
+    long version;
+    do
+    {
+      version = name_index->ReadBegin();
+      long pos = 0;
+      for(long index = name_index->Next(hash, pos); index != LONG_MAX; index = name_index->Next(hash, pos))
+      {
+        if(names[index] == NULL || *names[index] != name)
+          continue;
+        CaptureInternal(index);
+        // повторная проверка после захвата
+        if(*names[index] == name && states[index] == true)
+          return index;
+        // освободить если нет объекта
+        ReleaseInternal(index);
+      }
+    } while(name_index->ReadRetry(version));
+    return LONG_MAX;
+  }
   std::string **it = find_if(names, names_end, string_equal_pointers(&name));
   if(it != names_end)
   {
@@ -875,6 +1188,7 @@ typedef MCUSharedList<MCUH323Connection> MCUConnectionList;
 typedef MCUSharedList<AbookAccount> MCUAbookList;
 
 typedef MCUSharedList<MCUListener, 64> MCUListenerList;
+typedef MCUSharedList<MCUHttpSubscriber, 256> MCUHttpSubscriberList;
 typedef MCUSharedList<MCUTelnetSession, 64> MCUTelnetSessionList;
 
 typedef MCUSharedList<VideoMixPosition, 256> MCUVMPList;
@@ -28,6 +28,7 @@ class ConferenceAudioConnection;
 class ConferenceProfile;
 class ConferenceMember;
 class ConferenceRecorder;
+class ConferenceStreamer;
 class Conference;
 class ConferenceManager;
 
@@ -55,6 +56,7 @@ class MCUSocket;
 class MCUListener;
 class MCUTelnetSession;
 class MCUJSON;
+class MCUHttpSubscriber;
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -98,6 +100,9 @@ inline bool sync_bool_compare_and_swap(volatile long *ptr, long oldval, long new
 #define sync_fetch_and_sub(value, subvalue) InterlockedExchangeAdd(value, subvalue*(-1))
 #define sync_increment(value) InterlockedIncrement(value)
 #define sync_decrement(value) InterlockedDecrement(value)
+#define sync_fetch_and_or(value, mask) InterlockedOr((volatile long *)(value), mask)
+#define sync_fetch_and_and(value, mask) InterlockedAnd((volatile long *)(value), mask)
+#define sync_pause() YieldProcessor()
 #else
 #define sync_bool bool
 // returns the contents of *ptr before the operation
@@ -108,6 +113,9 @@ inline bool sync_bool_compare_and_swap(volatile long *ptr, long oldval, long new
 #define sync_fetch_and_sub(value, subvalue) __sync_fetch_and_sub(value, subvalue)
 #define sync_increment(value) __sync_fetch_and_add(value, 1)
 #define sync_decrement(value) __sync_fetch_and_sub(value, 1)
+#define sync_fetch_and_or(value, mask) __sync_fetch_and_or(value, mask)
+#define sync_fetch_and_and(value, mask) __sync_fetch_and_and(value, mask)
+#define sync_pause() __asm__ __volatile__("pause":::"memory")
 #endif
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -309,6 +317,7 @@ class MCUDelay
     void Restart()
     {
       delay_time = MCUTime::GetMonoTimestampUsec();
+      late = 0;
       PTRACE(6, "MCUDelay " << this << " now " << delay_time);
     }
 
@@ -325,7 +334,10 @@ class MCUDelay
       {
         uint32_t interval = (uint32_t)(delay_time - now);
         MCUTime::SleepUsec(interval);
+        late = 0;
       }
+      else
+        late = now - delay_time;
       //else // restart
       //  delay_time = now;
     }
@@ -346,9 +358,104 @@ class MCUDelay
     const uint64_t GetDelayTimestampUsec()
     { return delay_time; }
 
+    // Опоздание последнего такта DelayUsec
+    const uint64_t GetLateUsec()
+    { return late; }
+
   protected:
     uint64_t delay_time;
     uint64_t now;
+    uint64_t late;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Равномерная отправка пакетов, token bucket в байтах.
+// Пакеты с приоритетом отправляются без ожидания, уводя баланс в минус,
+// обычные пакеты ждут восстановления баланса.
+class MCUPacer
+{
+  public:
+    MCUPacer()
+    {
+      rate = 0;
+      burst = 0;
+      maxDelay = 0;
+      tokens = 0;
+      refill_time = 0;
+    }
+
+    // bitRate - скорость отправки, 0 - без ограничения,
+    // burstUsec - объем пачки, maxDelayUsec - предельная задержка пакета
+    void SetRate(uint32_t bitRate, uint32_t burstUsec, uint32_t maxDelayUsec)
+    {
+      Refill();
+      rate = bitRate / 8;
+      burst = (int64_t)rate * burstUsec / 1000000;
+      maxDelay = maxDelayUsec;
+      if(tokens > burst)
+        tokens = burst;
+      Limit();
+    }
+
+    uint32_t GetBitRate() const
+    { return rate * 8; }
+
+    // ожидание перед отправкой обычного пакета
+    void Wait(uint32_t size)
+    {
+      if(rate == 0)
+        return;
+      Refill();
+      // долг ограничен maxDelay (Limit), задержка не накапливается
+      if(tokens < 0)
+      {
+        MCUTime::SleepUsec((uint32_t)((uint64_t)(-tokens) * 1000000 / rate));
+        Refill();
+      }
+      tokens -= size;
+      Limit();
+    }
+
+    // отправка пакета с приоритетом
+    void Consume(uint32_t size)
+    {
+      if(rate == 0)
+        return;
+      Refill();
+      tokens -= size;
+      Limit();
+    }
+
+  protected:
+    void Refill()
+    {
+      uint64_t now = MCUTime::GetMonoTimestampUsec();
+      if(refill_time != 0 && now > refill_time)
+      {
+        tokens += (int64_t)((now - refill_time) * rate / 1000000);
+        if(tokens > burst)
+          tokens = burst;
+      }
+      refill_time = now;
+    }
+
+    // кодер превышает скорость: долг сверх maxDelay списывается, остаток уходит пачкой
+    void Limit()
+    {
+      int64_t min_tokens = -(int64_t)((uint64_t)rate * maxDelay / 1000000);
+      if(tokens < min_tokens)
+      {
+        PTRACE(6, "MCUPacer " << this << " backlog " << (uint64_t)(-tokens) * 1000000 / rate << " usec, limited to " << maxDelay);
+        tokens = min_tokens;
+      }
+    }
+
+    uint32_t rate; // байт/с
+    int64_t burst;
+    uint32_t maxDelay;
+    int64_t tokens;
+    uint64_t refill_time;
 };
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -448,6 +555,72 @@ class MCUConfig: public PConfig
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// room parameters, resolved from "Conference <room>", "Conference *" and built-in defaults
+class MCUConferenceConfig
+{
+  public:
+    MCUConferenceConfig();
+
+    void Load(const PString & room);
+    void ApplyOverrides(const PString & room);
+
+    BOOL autoCreate;
+    BOOL autoCreateWhenConnecting;
+    BOOL forceSplitVideo;
+    BOOL autoDeleteEmpty;
+    BOOL allowRecord;
+    BOOL recallLastTemplate;
+    BOOL lockTemplate;
+    int timeLimit;
+    int autoRecordStart; // -1 disabled
+    int autoRecordStop;  // -1 disabled
+    PString mediaPlayerFile;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Immutable copy of the configuration file, built by Reload() on start and
+// after every settings page post. Readers take Current() without locking;
+// a replaced snapshot is kept for MCU_CONFIG_SNAPSHOT_GRACE seconds before
+// it is deleted, so the reader must not hold the pointer longer than that.
+#define MCU_CONFIG_SNAPSHOT_GRACE 60
+
+class MCUConfigSnapshot
+{
+  public:
+    static void Reload();
+    static void Clear();
+
+    static const MCUConfigSnapshot * Current()
+    { return current; }
+
+    static MCUConferenceConfig GetConferenceConfig(const PString & room);
+
+    // "" if the key or section is absent
+    PString GetString(const PString & section, const PString & key) const;
+    BOOL HasSection(const PString & section) const;
+
+  protected:
+    MCUConfigSnapshot();
+
+    // PConfig keys and sections are case insensitive
+    typedef std::map<PCaselessString, PString> KeyMap;
+    typedef std::map<PCaselessString, KeyMap> SectionMap;
+    SectionMap sections;
+
+    typedef std::map<PCaselessString, MCUConferenceConfig> ConferenceMap;
+    ConferenceMap conferences;
+    MCUConferenceConfig conferenceDefault;
+
+    uint64_t retireTime;
+
+    static MCUConfigSnapshot * volatile current;
+    static std::deque<MCUConfigSnapshot *> retired;
+    static PMutex reloadMutex;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
 class MCUURL : public PURL
 {
   public:
@@ -41,6 +41,7 @@ MCUPVideoInputDevice::MCUPVideoInputDevice(MCUH323Connection & _mcuConnection)
   SetColourFormat("YUV420P");
   channelNumber = 0; 
   grabCount = 0;
+  grabTime = 0;
   SetFrameRate(25);
 }
 
@@ -167,7 +168,16 @@ PINDEX MCUPVideoInputDevice::GetMaxFrameBytes()
 
 BOOL MCUPVideoInputDevice::GetFrameData(BYTE * buffer, PINDEX * bytesReturned)
 {    
-  grabDelay.Delay(1000/GetFrameRate());
+  MCUOverloadController & overload = OpenMCU::Current().GetOverloadController();
+  unsigned interval = 1000*overload.GetFrameRateDivisor()/GetFrameRate();
+
+  // tick is late when the previous frame took longer than the interval
+  uint64_t now = MCUTime::GetMonoTimestampUsec();
+  if(grabTime != 0 && now > grabTime + interval*1000)
+    overload.OnVideoTick(now - grabTime - interval*1000);
+
+  grabDelay.Delay(interval);
+  grabTime = MCUTime::GetMonoTimestampUsec();
   return GetFrameDataNoDelay(buffer, bytesReturned);
 }
 
@@ -266,21 +266,21 @@ class MCUVideoMixer
       return vmpList.Insert(vmp, vmp->id);
     }
 
-    MCUJSON * VMPListScanJS() // returns associative javascript "{0:id1, 1:-1, 2:id2, ...}"
+    void VMPListScanJS(MCUJSONWriter & writer) // writes associative javascript "{0:id1, 1:-1, 2:id2, ...}" for ids and types
     {
-      MCUJSON *r=new MCUJSON(MCUJSON::JSON_OBJECT);
-      MCUJSON *q=new MCUJSON(MCUJSON::JSON_OBJECT);
+      // оба объекта заполняются за один проход по списку
+      MCUJSONDocument doc(MCUJSON::JSON_ARRAY, 2+2*MAX_SUBFRAMES);
+      MCUJSONDocument::Node r = doc.AddObject(doc.Root());
+      MCUJSONDocument::Node q = doc.AddObject(doc.Root());
       for(MCUVMPList::shared_iterator it = vmpList.begin(); it != vmpList.end(); ++it)
       {
         VideoMixPosition *vmp = *it;
         const PString idx = PString(vmp->n);
-        r->Insert(idx, vmp->id);
-        q->Insert(idx, vmp->type);
+        doc.Add(r, idx, vmp->id);
+        doc.Add(q, idx, (int)vmp->type);
       }
-      MCUJSON* a=new MCUJSON(MCUJSON::JSON_ARRAY);
-      a->Insert(r);
-      a->Insert(q);
-      return a;
+      doc.Write(writer, r);
+      doc.Write(writer, q);
     }
 
     void VMPListClear()
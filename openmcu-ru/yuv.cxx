@@ -496,7 +496,7 @@ extern __inline__ uint64_t rdtsc()
 void ResizeYUV420P(const void * _src, void * _dst, unsigned int sw, unsigned int sh, unsigned int dw, unsigned int dh)
 {
   uint64_t TSC0=rdtsc();
-  int scaleFilterType = OpenMCU::Current().GetScaleFilterType();
+  int scaleFilterType = OpenMCU::Current().GetOverloadController().GetScaleFilterType(OpenMCU::Current().GetScaleFilterType());
 
   if(sw==dw && sh==dh) // same size
     memcpy(_dst,_src,dw*dh*3/2);
@@ -250,6 +250,21 @@ void X264EncoderContext::ApplyOptions()
   }
 }
 
+// rate control only, the encoder is not reopened and no IDR is forced
+bool X264EncoderContext::ReconfigBitrate(unsigned rate, unsigned maxBr)
+{
+  if (_codec == NULL)
+    return false;
+  _context.rc.i_bitrate = rate;
+  _context.rc.i_vbv_max_bitrate = maxBr;
+  if (X264_ENCODER_RECONFIG(_codec, &_context) < 0) {
+    TRACE(1, "H264\tEncoder\tCouldn't reconfigure x264 encoder bitrate " << rate);
+    return false;
+  }
+  TRACE(4, "H264\tEncoder\tBitrate " << rate << "/" << maxBr << " kbit/s");
+  return true;
+}
+
 int X264EncoderContext::EncodeFrames(const unsigned char * src, unsigned & srcLen, unsigned char * dst, unsigned & dstLen, unsigned int & flags)
 {
 
@@ -109,6 +109,7 @@ class X264EncoderContext
     void SetQuality (unsigned quality);
     void SetThreads (unsigned threads);
     void ApplyOptions ();
+    bool ReconfigBitrate (unsigned rate, unsigned maxBr);
 
 
   protected:
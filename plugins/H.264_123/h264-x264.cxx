@@ -119,6 +119,13 @@ void H264EncoderContext::ApplyOptions()
   x264->ApplyOptions ();
 }
 
+bool H264EncoderContext::SetBitrate(unsigned bitRate)
+{
+  maxBr = bitRate;
+  targetBitrate = maxBr * 90 / 100;
+  return x264->ReconfigBitrate(targetBitrate/1024, maxBr/1024);
+}
+
 void H264EncoderContext::SetMaxRTPFrameSize(unsigned size)
 {
   x264->SetMaxRTPFrameSize (size);
@@ -322,6 +329,63 @@ void H264DecoderContext::SetSpropParameter(const char *value)
 #endif
 }
 
+void H264DecoderContext::SetThreads(unsigned threads)
+{
+  if(_context == NULL || threads == 0 || (int)threads == _context->thread_count)
+    return;
+
+  // open a new context next to the old one, swap only on success
+#if LIBAVCODEC_VERSION_INT > AV_VERSION_INT(53,8,0)
+  AVCodecContext *context = avcodec_alloc_context3(_codec);
+#else
+  AVCodecContext *context = avcodec_alloc_context();
+#endif
+  if(context == NULL)
+  {
+    cout << "H264\tDecoder\tFailed to allocate context for " << threads << " threads, keep " << _context->thread_count << "\n";
+    return;
+  }
+
+  // slice threads, without frame threading delay
+  context->thread_count = threads;
+#ifdef FF_THREAD_SLICE
+  context->thread_type = FF_THREAD_SLICE;
+#endif
+
+  // sprop-parameter-sets
+  if(_context->extradata_size > 0)
+  {
+    context->extradata = (uint8_t *)av_mallocz(_context->extradata_size + FF_INPUT_BUFFER_PADDING_SIZE);
+    if(context->extradata)
+    {
+      memcpy(context->extradata, _context->extradata, _context->extradata_size);
+      context->extradata_size = _context->extradata_size;
+    }
+  }
+
+#if LIBAVCODEC_VERSION_INT > AV_VERSION_INT(53,8,0)
+  if(avcodec_open2(context, _codec, NULL) < 0)
+#else
+  if(avcodec_open(context, _codec) < 0)
+#endif
+  {
+    cout << "H264\tDecoder\tFailed to open decoder with " << threads << " threads, keep " << _context->thread_count << "\n";
+    av_freep(&context->extradata);
+    av_free(context);
+    return;
+  }
+
+  if(_context->codec != NULL)
+    avcodec_close(_context);
+  av_freep(&_context->extradata);
+  av_free(_context);
+  _context = context;
+
+  // the new decoder has no reference frames, wait for an I-Frame
+  _gotIFrame = false;
+  _rxH264Frame->BeginNewFrame();
+}
+
 int H264DecoderContext::DecodeFrames(const u_char * src, unsigned & srcLen, u_char * dst, unsigned & dstLen, unsigned int & flags)
 {
   // create RTP frame from source buffer
@@ -855,6 +919,24 @@ static int encoder_get_output_data_size(const PluginCodec_Definition *, void *,
 {
   return 1400; //FIXME
 }
+
+// MCU bandwidth adaptation: bit/s in parm, the encoder is reconfigured without reopening
+static int encoder_set_bit_rate(const struct PluginCodec_Definition *, void * _context, const char *, void * parm, unsigned * parmLen)
+{
+  H264EncoderContext * context = (H264EncoderContext *)_context;
+
+  if (parm == NULL || parmLen == NULL || *parmLen != sizeof(unsigned))
+    return 0;
+
+  unsigned bitRate = *(unsigned *)parm;
+  if (bitRate == 0)
+    return 0;
+
+  context->Lock();
+  bool ret = context->SetBitrate(bitRate);
+  context->Unlock();
+  return ret ? 1 : 0;
+}
 /////////////////////////////////////////////////////////////////////////////
 
 static int decoder_set_options(const struct PluginCodec_Definition *, void * _context, const char *, void * parm, unsigned * parmLen)
@@ -877,6 +959,8 @@ static int decoder_set_options(const struct PluginCodec_Definition *, void * _co
       if(strcasecmp(s.c_str(), "") != 0)
         context->SetSpropParameter(s.c_str());
     }
+    if(STRCMPI(options[i], "Decoding Threads") == 0)
+      context->SetThreads(atoi(options[i+1]));
   }
 
   context->Unlock();
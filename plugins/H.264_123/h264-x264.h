@@ -113,6 +113,7 @@ class H264EncoderContext
     void SetQuality (unsigned quality);
     void SetThreads (unsigned threads);
     void ApplyOptions ();
+    bool SetBitrate (unsigned bitRate);
     void Lock ();
     void Unlock ();
 
@@ -132,6 +133,7 @@ class H264DecoderContext
     int DecodeFrames(const u_char * src, unsigned & srcLen, u_char * dst, unsigned & dstLen, unsigned int & flags);
 
     void SetSpropParameter(const char *value);
+    void SetThreads(unsigned threads);
 
     void Lock() { _mutex.Wait(); }
     void Unlock() { _mutex.Signal(); }
@@ -175,6 +177,8 @@ static int encoder_set_options   ( const struct PluginCodec_Definition *, void *
                                    void * parm, unsigned * parmLen);
 static int encoder_get_output_data_size ( const PluginCodec_Definition *, void *, const char *,
                                    void *, unsigned *);
+static int encoder_set_bit_rate  ( const struct PluginCodec_Definition *, void * _context, const char *,
+                                   void * parm, unsigned * parmLen);
 static int decoder_set_options   ( const struct PluginCodec_Definition *, void * _context, const char *, 
                                    void * parm, unsigned * parmLen);
 
@@ -227,6 +231,7 @@ static PluginCodec_ControlDefn EncoderControls[] = {
   { PLUGINCODEC_CONTROL_TO_CUSTOMISED_OPTIONS, to_customised_options },
   { PLUGINCODEC_CONTROL_SET_CODEC_OPTIONS,     encoder_set_options },
   { PLUGINCODEC_CONTROL_GET_OUTPUT_DATA_SIZE,  encoder_get_output_data_size },
+  { "set_bit_rate",                            encoder_set_bit_rate },
   { NULL }
 };
 
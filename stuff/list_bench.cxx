@@ -0,0 +1,221 @@
+/*
+ * list_bench.cxx
+ *
+ * Microbenchmark of MCUSharedList (openmcu-ru/utils_list.h):
+ *   - contended capture/release: threads find the same few objects by id and release them
+ *   - lookup by id and by name, with and without the hash index
+ *   - iteration over a sparse and a full list
+ *
+ * Build in the configured source tree (openmcu-ru/config.h must exist):
+ *   g++ -O2 -I../openmcu-ru $(pkg-config --cflags ptlib h323plus sofia-sip-ua) -o list_bench list_bench.cxx \
+ *       $(pkg-config --libs ptlib)
+ *
+ * Usage: list_bench [threads] [iterations]
+ */
+
+#include "precompile.h"
+#include "utils_list.h"
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class BenchObject
+{
+  public:
+    BenchObject(long _id) : id(_id) { }
+    long id;
+};
+
+typedef MCUSharedList<BenchObject> BenchList;
+
+// ids 1..count, names "object<id>"
+static void FillList(BenchList & list, long count)
+{
+  for(long id = 1; id <= count; ++id)
+  {
+    PString name = "object" + PString(id);
+    BenchList::shared_iterator it = list.Insert(new BenchObject(id), id, (const char *)name);
+  }
+}
+
+static void ClearList(BenchList & list)
+{
+  for(BenchList::shared_iterator it = list.begin(); it != list.end(); ++it)
+  {
+    BenchObject *obj = it.GetObject();
+    if(list.Erase(it))
+      delete obj;
+  }
+}
+
+static void Report(const char * name, uint64_t usec, uint64_t ops)
+{
+  cout << setw(40) << left << name << " " << setw(10) << right << (ops ? usec * 1000 / ops : 0) << " ns/op" << endl;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class CaptureThread : public PThread
+{
+  PCLASSINFO(CaptureThread, PThread);
+
+  public:
+    CaptureThread(BenchList & _list, long _ids, long _iterations, PSyncPoint & _start)
+      : PThread(1000, NoAutoDeleteThread), list(_list), ids(_ids), iterations(_iterations), start(_start)
+    { Resume(); }
+
+    void Main()
+    {
+      start.Wait();
+      start.Signal();
+      for(long i = 0; i < iterations; ++i)
+      {
+        BenchList::shared_iterator it = list.Find((i % ids) + 1);
+        if(it == list.end())
+          cout << "object not found" << endl;
+      }
+    }
+
+  protected:
+    BenchList & list;
+    long ids;
+    long iterations;
+    PSyncPoint & start;
+};
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+class ListBench : public PProcess
+{
+  PCLASSINFO(ListBench, PProcess);
+
+  public:
+    ListBench()
+      : PProcess(MANUFACTURER_TEXT, "list_bench")
+    { }
+
+    void Main();
+
+  protected:
+    void Contended(long threads, long iterations, long ids);
+    void Lookup(BOOL index, long objects, long iterations);
+    void Iterate(long objects, long iterations);
+};
+
+PCREATE_PROCESS(ListBench);
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ListBench::Main()
+{
+  PArgList & args = GetArguments();
+  long threads = (args.GetCount() > 0 ? args[0].AsInteger() : 4);
+  long iterations = (args.GetCount() > 1 ? args[1].AsInteger() : 1000000);
+  if(threads < 1)
+    threads = 1;
+  if(iterations < 1)
+    iterations = 1;
+
+  cout << "threads " << threads << ", iterations " << iterations << ", list size " << MCU_SHARED_LIST_SIZE << endl;
+
+  Contended(1, iterations, 1);
+  Contended(threads, iterations, 1);
+  Contended(threads, iterations, threads);
+
+  Lookup(FALSE, 200, iterations / 10);
+  Lookup(TRUE, 200, iterations / 10);
+
+  Iterate(8, iterations / 10);
+  Iterate(MCU_SHARED_LIST_SIZE, iterations / 100);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ListBench::Contended(long threads, long iterations, long ids)
+{
+  BenchList list;
+  FillList(list, ids);
+
+  PSyncPoint start;
+  std::vector<CaptureThread *> list_threads;
+  for(long i = 0; i < threads; ++i)
+    list_threads.push_back(new CaptureThread(list, ids, iterations, start));
+
+  uint64_t begin = MCUTime::GetMonoTimestampUsec();
+  start.Signal();
+  for(long i = 0; i < threads; ++i)
+  {
+    list_threads[i]->WaitForTermination();
+    delete list_threads[i];
+  }
+  uint64_t usec = MCUTime::GetMonoTimestampUsec() - begin;
+
+  PStringStream name;
+  name << "capture/release " << threads << " threads, " << ids << " objects";
+  Report(name, usec, (uint64_t)threads * iterations);
+
+  ClearList(list);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ListBench::Lookup(BOOL index, long objects, long iterations)
+{
+  BenchList list;
+  if(index)
+    list.EnableIndex();
+  FillList(list, objects);
+
+  // the last objects, the linear search is the longest
+  uint64_t begin = MCUTime::GetMonoTimestampUsec();
+  for(long i = 0; i < iterations; ++i)
+  {
+    BenchList::shared_iterator it = list.Find(objects - (i % 8));
+  }
+  uint64_t usec = MCUTime::GetMonoTimestampUsec() - begin;
+  Report(index ? "find by id, index" : "find by id, no index", usec, iterations);
+
+  begin = MCUTime::GetMonoTimestampUsec();
+  for(long i = 0; i < iterations; ++i)
+  {
+    PString name = "object" + PString(objects - (i % 8));
+    BenchList::shared_iterator it = list.Find((const char *)name);
+  }
+  usec = MCUTime::GetMonoTimestampUsec() - begin;
+  Report(index ? "find by name, index" : "find by name, no index", usec, iterations);
+
+  // the missing id, the whole chain or the whole list
+  begin = MCUTime::GetMonoTimestampUsec();
+  for(long i = 0; i < iterations; ++i)
+  {
+    BenchList::shared_iterator it = list.Find(objects * 2 + i);
+  }
+  usec = MCUTime::GetMonoTimestampUsec() - begin;
+  Report(index ? "find missing id, index" : "find missing id, no index", usec, iterations);
+
+  ClearList(list);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void ListBench::Iterate(long objects, long iterations)
+{
+  BenchList list;
+  FillList(list, objects);
+
+  uint64_t begin = MCUTime::GetMonoTimestampUsec();
+  long count = 0;
+  for(long i = 0; i < iterations; ++i)
+  {
+    for(BenchList::shared_iterator it = list.begin(); it != list.end(); ++it)
+      count++;
+  }
+  uint64_t usec = MCUTime::GetMonoTimestampUsec() - begin;
+  if(count != objects * iterations)
+    cout << "iteration error " << count << endl;
+
+  PStringStream name;
+  name << "iterate " << objects << " of " << MCU_SHARED_LIST_SIZE;
+  Report(name, usec, iterations);
+
+  ClearList(list);
+}
@@ -0,0 +1,81 @@
+/*
+ * shm_reader.cxx
+ *
+ * Reference reader of the shared memory export (Export Parameters -> Export mode -> Shared memory).
+ * Writes the raw frames to stdout, the format and the lost frames to stderr.
+ *
+ * Build: g++ -O2 -I../openmcu-ru -o shm_reader shm_reader.cxx -lrt
+ *
+ * Examples:
+ *   shm_reader openmcu_audio_101 | ffmpeg -f s16le -ar 16000 -ac 1 -i - out.wav
+ *   shm_reader openmcu_video_101 | ffmpeg -f rawvideo -pix_fmt yuv420p -s 704x576 -r 10 -i - out.mp4
+ *   shm_reader "openmcu_video_room 2" | ...   (the room name as is, the ring name is made by mcu_shm_make_name)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include "mcu_shm.h"
+
+static volatile int running = 1;
+
+static void on_signal(int)
+{
+  running = 0;
+}
+
+int main(int argc, char *argv[])
+{
+  if(argc < 2)
+  {
+    fprintf(stderr, "usage: %s <openmcu_audio_ROOM|openmcu_video_ROOM>\n", argv[0]);
+    return 1;
+  }
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  signal(SIGPIPE, on_signal);
+
+  MCUShmReader reader;
+  while(running && mcu_shm_reader_open(&reader, argv[1]) != 0)
+    usleep(500000);
+  if(!running)
+    return 0;
+
+  MCUShmHeader *header = reader.header;
+  if(header->media == MCU_SHM_MEDIA_VIDEO)
+    fprintf(stderr, "video I420 %ux%u %u fps\n", header->width, header->height, header->frame_rate);
+  else
+    fprintf(stderr, "audio S16LE %u Hz %u channels\n", header->sample_rate, header->channels);
+
+  uint32_t buffer_size = header->slot_size;
+  uint8_t *buffer = (uint8_t *)malloc(buffer_size);
+  uint64_t lost = 0;
+
+  while(running)
+  {
+    uint64_t timestamp = 0;
+    int size = mcu_shm_reader_read(&reader, buffer, buffer_size, &timestamp);
+    if(size < 0)
+    {
+      fprintf(stderr, "the ring is closed\n");
+      break;
+    }
+    if(size == 0)
+    {
+      usleep(2000);
+      continue;
+    }
+    if(fwrite(buffer, 1, size, stdout) != (size_t)size)
+      break;
+    if(reader.lost != lost)
+    {
+      fprintf(stderr, "lost %llu frames\n", (unsigned long long)(reader.lost - lost));
+      lost = reader.lost;
+    }
+  }
+
+  free(buffer);
+  mcu_shm_reader_close(&reader);
+  return 0;
+}